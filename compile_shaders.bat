@@ -4,5 +4,8 @@ cd src/client/shaders
 
 glslc simple.vert -o simple.vert.spv
 glslc simple.frag -o simple.frag.spv
+glslc bindless.frag -o bindless.frag.spv
+glslc cull.comp -o cull.comp.spv
+glslc meshlet_cull.comp -o meshlet_cull.comp.spv
 
 PAUSE
\ No newline at end of file
@@ -3,4 +3,7 @@
 cd src/client/shaders
 
 glslc simple.vert -o simple.vert.spv
-glslc simple.frag -o simple.frag.spv
\ No newline at end of file
+glslc simple.frag -o simple.frag.spv
+glslc bindless.frag -o bindless.frag.spv
+glslc cull.comp -o cull.comp.spv
+glslc meshlet_cull.comp -o meshlet_cull.comp.spv
\ No newline at end of file
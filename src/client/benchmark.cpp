@@ -0,0 +1,202 @@
+#include "benchmark.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+
+#include "renderer/camera.h"
+#include "renderer/frustum.h"
+#include "renderer/model.h"
+#include "renderer/mesh_optimizer.h"
+
+namespace yib {
+	bool Benchmark::Run(const std::string& name) {
+		if (name == "culling") {
+			return RunCulling();
+		}
+
+		if (name == "mesh") {
+			return RunMesh();
+		}
+
+		printf("Unknown benchmark %s\n", name.c_str());
+
+		return false;
+	}
+
+
+	bool Benchmark::RunCulling() {
+		const uint32_t object_count = 100000;
+		const uint32_t iterations = 100;
+
+		std::mt19937 random = std::mt19937(1);
+		std::uniform_real_distribution<float> position = std::uniform_real_distribution<float>(-50.0f, 50.0f);
+		std::uniform_real_distribution<float> radius = std::uniform_real_distribution<float>(0.1f, 1.0f);
+
+		BoundingSpheres spheres = {};
+		spheres.Reserve(object_count);
+
+		for (uint32_t i = 0; i < object_count; i++) {
+			spheres.Add(
+				glm::vec3(position(random), position(random), position(random)),
+				radius(random)
+			);
+		}
+
+		Camera camera = Camera();
+		camera.SetViewYXZ(glm::vec3(), glm::vec3(0.0f, 0.0f, 0.0f));
+		camera.SetPerspectiveProjection(glm::radians(50.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+
+		Frustum frustum = Frustum(camera.GetProjectionMatrix() * camera.GetViewMatrix());
+
+		std::vector<uint32_t> scalar_visible = {};
+		std::vector<uint32_t> simd_visible = {};
+		scalar_visible.reserve(object_count);
+		simd_visible.reserve(object_count);
+
+		std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+		for (uint32_t i = 0; i < iterations; i++) {
+			frustum.CullScalar(spheres, scalar_visible);
+		}
+
+		std::chrono::duration<double, std::milli> scalar_elapsed = std::chrono::steady_clock::now() - start_time;
+
+		start_time = std::chrono::steady_clock::now();
+
+		for (uint32_t i = 0; i < iterations; i++) {
+			frustum.Cull(spheres, simd_visible);
+		}
+
+		std::chrono::duration<double, std::milli> simd_elapsed = std::chrono::steady_clock::now() - start_time;
+
+		printf(
+			"Culled %u spheres, %zu visible\n",
+			object_count,
+			simd_visible.size()
+		);
+		printf(
+			"Scalar: %.3f ms per pass\n",
+			scalar_elapsed.count() / iterations
+		);
+		printf(
+			"Simd (%u wide): %.3f ms per pass\n",
+			Frustum::GetSimdWidth(),
+			simd_elapsed.count() / iterations
+		);
+
+		if (scalar_visible != simd_visible) {
+			printf("Scalar and simd results differ\n");
+			return false;
+		}
+
+		return true;
+	}
+
+
+	// Optimizes every .obj in the working directory, which is also where
+	// the client loads its models from.
+	bool Benchmark::RunMesh() {
+		std::vector<std::string> files = {};
+		std::error_code error = {};
+
+		for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(".", error)) {
+			if (entry.is_regular_file() && entry.path().extension() == ".obj") {
+				files.push_back(entry.path().string());
+			}
+		}
+
+		if (files.empty()) {
+			printf("No .obj files in the working directory\n");
+			return false;
+		}
+
+		std::sort(files.begin(), files.end());
+
+		for (const std::string& file : files) {
+			std::optional<ModelData> data = ModelData::LoadModel(file);
+			if (!data.has_value()) {
+				printf("Failed to load %s\n", file.c_str());
+				return false;
+			}
+
+			VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(
+				data.value().indices,
+				data.value().vertices.size()
+			);
+
+			std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+			MeshOptimizer::Optimize(data.value());
+
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start_time;
+
+			VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache(
+				data.value().indices,
+				data.value().vertices.size()
+			);
+
+			printf(
+				"%s: %zu triangles, %zu vertices, optimized in %.2f ms\n",
+				file.c_str(),
+				data.value().indices.size() / 3,
+				data.value().vertices.size(),
+				elapsed.count()
+			);
+			printf(
+				"ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (%u entry cache)\n",
+				before.acmr,
+				after.acmr,
+				before.atvr,
+				after.atvr,
+				MeshOptimizer::CACHE_SIZE
+			);
+
+			start_time = std::chrono::steady_clock::now();
+
+			MeshOptimizer::GenerateLods(data.value());
+
+			elapsed = std::chrono::steady_clock::now() - start_time;
+
+			printf(
+				"Generated %zu lods in %.2f ms\n",
+				data.value().lods.size(),
+				elapsed.count()
+			);
+
+			for (const MeshLod& lod : data.value().lods) {
+				printf(
+					"  %u triangles, error %.5f\n",
+					lod.index_count / 3,
+					lod.error
+				);
+			}
+
+			MeshOptimizer::BuildMeshlets(data.value());
+
+			uint32_t cone_count = 0;
+			for (const Meshlet& meshlet : data.value().meshlets) {
+				if (meshlet.cone_cutoff < 1.0f) {
+					cone_count++;
+				}
+			}
+
+			if (data.value().meshlets.empty()) {
+				printf("Built no meshlets\n");
+				continue;
+			}
+
+			printf(
+				"Built %zu meshlets, %.1f triangles each, %u can be cone culled\n",
+				data.value().meshlets.size(),
+				data.value().lods.at(0).index_count / 3.0 / data.value().meshlets.size(),
+				cone_count
+			);
+		}
+
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+
+namespace yib {
+	class Benchmark {
+	public:
+		static bool Run(const std::string& name);
+	private:
+		static bool RunCulling();
+		static bool RunMesh();
+	};
+}
\ No newline at end of file
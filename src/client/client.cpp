@@ -1,34 +1,47 @@
 #include "client.h"
 
+#include <cstdio>
+
+#include "../shared/profiler.h"
+
 namespace yib {
 	Client::Client(
 		const std::string name,
 		const uint32_t width,
-		const uint32_t height
+		const uint32_t height,
+		const bool headless,
+		const uint32_t frame_count,
+		const uint32_t record_threads,
+		const FramePacing& pacing
 	) :
 		name(name),
 		width(width),
 		height(height),
-		window(
+		headless(headless),
+		frame_count(frame_count),
+		window(headless ? nullptr : std::make_unique<Window>(
 			name,
 			width,
 			height
-		),
+		)),
 		device(
 			name,
-			&window
+			window.get()
 		),
 		renderer(
 			name,
 			width,
 			height,
-			window,
-			device
+			window.get(),
+			device,
+			record_threads,
+			pacing
 		),
+		pipeline_registry(device),
 		running(true),
 		success(false)
 	{
-		if (!this->window.success) {
+		if (this->window != nullptr && !this->window->success) {
 			return;
 		}
 
@@ -45,7 +58,7 @@ namespace yib {
 			return;
 		}
 
-		if (!CreateDescriptorPool()) {
+		if (!CreateDescriptorCache()) {
 			return;
 		}
 
@@ -53,42 +66,31 @@ namespace yib {
 	}
 
 	void Client::Run() {
-		Texture texture = Texture(
+		std::shared_ptr<Texture> texture = std::make_shared<Texture>(
 			this->device,
 			"icon.png"
 		);
-		if (!texture.success) {
+		if (!texture->success) {
 			this->running = false;
 			return;
 		}
 
-		VkDescriptorImageInfo texture_info = texture.GetDescriptorInfo();
+		// Bindless rendering samples the object's texture, binding 1 only
+		// serves devices without descriptor indexing.
+		for (std::shared_ptr<Object>& object : this->objects) {
+			object->texture = texture;
+		}
+
+		VkDescriptorImageInfo texture_info = texture->GetDescriptorInfo();
 		
 		Camera camera = Camera();
 		camera.SetViewYXZ(glm::vec3(), glm::vec3(0.0f, 0.0f, 0.0f));
 
-		std::vector<std::unique_ptr<Buffer>> uniform_buffers(SwapChain::MAX_FRAMES_IN_FLIGHT);
-		for (int i = 0; i < uniform_buffers.size(); i++) {
-			uniform_buffers.at(i) = std::make_unique<Buffer>(
-				this->device,
-				sizeof(GlobalUBO),
-				1,
-				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-				this->device.GetPhysicalDeviceProperties().limits.minUniformBufferOffsetAlignment
-			);
-
-			if (!uniform_buffers.at(i)->Map()) {
-				this->running = false;
-				return;
-			}
-		}
-
 		DescriptorSetLayout::Builder set_layout_builder = DescriptorSetLayout::Builder(this->device);
 
 		set_layout_builder.AddBinding(
 			0,
-			VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+			VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
 			VK_SHADER_STAGE_VERTEX_BIT
 		);
 		set_layout_builder.AddBinding(
@@ -99,45 +101,39 @@ namespace yib {
 
 		std::unique_ptr<DescriptorSetLayout> set_layout = set_layout_builder.Build();
 
-		std::vector<VkDescriptorSet> descriptor_sets(SwapChain::MAX_FRAMES_IN_FLIGHT);
-		for (int i = 0; i < descriptor_sets.size(); i++) {
-			VkDescriptorBufferInfo buffer_info = uniform_buffers.at(i)->DescriptorInfo();
-
-			DescriptorWriter writer = DescriptorWriter(
-				*set_layout,
-				*this->descriptor_pool
-			);
-			
-			if (!writer.WriteBuffer(0, &buffer_info)) {
-				this->running = false;
-				return;
-			}
-
-			if (!writer.WriteImage(1, &texture_info)) {
-				this->running = false;
-				return;
-			}
-
-			if (!writer.Build(descriptor_sets.at(i))) {
-				this->running = false;
-				return;
-			}
-		}
+		VkDescriptorBufferInfo buffer_info = this->renderer.GetUniformRing().GetDescriptorInfo(sizeof(GlobalUBO));
 
 		RenderSystem render_system = RenderSystem(
 			this->device,
+			this->pipeline_registry,
 			this->width,
 			this->height,
 			this->renderer.GetRenderPass(),
-			set_layout->GetDescriptorSetLayout()
+			set_layout->GetDescriptorSetLayout(),
+			this->vertex_layout
 		);
 		if (!render_system.success) {
 			this->running = false;
 			return;
 		}
 
-		while (this->window.Running() && this->running) {
-			this->window.Run();
+		uint32_t frames_rendered = 0;
+		std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+		while (this->running) {
+			YIB_PROFILE_FRAME();
+
+			if (this->window != nullptr) {
+				if (!this->window->Running()) {
+					break;
+				}
+
+				this->window->Run();
+			}
+
+			if (this->frame_count != 0 && frames_rendered >= this->frame_count) {
+				break;
+			}
 
 			VkExtent2D extent = this->renderer.GetExtent();
 			float aspect_ratio = extent.width / extent.height;
@@ -161,34 +157,195 @@ namespace yib {
 			}
 
 			// Update
-			GlobalUBO UBO = GlobalUBO();
-			UBO.projection_view_matrix = camera.GetProjectionMatrix() * camera.GetViewMatrix();
+			std::optional<UniformSlice> global_slice = std::nullopt;
+			{
+				YIB_PROFILE_ZONE("UpdateUBO");
 
-			uniform_buffers.at(frame_index.value())->Write(&UBO);
-			uniform_buffers.at(frame_index.value())->Flush();
+				GlobalUBO UBO = GlobalUBO();
+				UBO.projection_view_matrix = camera.GetProjectionMatrix() * camera.GetViewMatrix();
+
+				global_slice = this->renderer.GetUniformRing().Write(&UBO, sizeof(GlobalUBO));
+			}
+
+			if (!global_slice.has_value()) {
+				this->running = false;
+				break;
+			}
+
+			uint32_t global_offset = global_slice.value().offset;
+
+			// Every frame binds the same ring buffer at a dynamic offset, so
+			// only the first build misses the cache.
+			VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+
+			DescriptorWriter writer = DescriptorWriter(
+				*set_layout,
+				*this->descriptor_cache
+			);
 
-			if (!this->renderer.BeginRenderPass(command_buffer.value())) {
+			if (
+				!writer.WriteBuffer(0, &buffer_info) ||
+				!writer.WriteImage(1, &texture_info) ||
+				!writer.Build(descriptor_set)
+			) {
 				this->running = false;
 				break;
 			}
-			
-			render_system.RenderModels(
-				command_buffer.value(),
+
+			if (!render_system.CullModels(
+				frame_index.value(),
 				objects,
 				camera,
-				descriptor_sets.at(frame_index.value())
+				extent
+			)) {
+				this->running = false;
+				break;
+			}
+
+			RenderGraph& graph = this->renderer.GetRenderGraph();
+
+			RenderGraph::Resource draws = graph.ImportBuffer(
+				"draws",
+				render_system.GetDrawBuffer(frame_index.value())
+			);
+			RenderGraph::Resource instances = graph.ImportBuffer(
+				"instances",
+				render_system.GetInstanceBuffer(frame_index.value())
+			);
+			RenderGraph::Resource meshlet_draws = graph.ImportBuffer(
+				"meshlet draws",
+				render_system.GetMeshletDrawBuffer(frame_index.value())
+			);
+			RenderGraph::Resource meshlet_indices = graph.ImportBuffer(
+				"meshlet indices",
+				render_system.GetMeshletIndexBuffer(frame_index.value())
+			);
+
+			RenderGraph::PassBuilder cull_pass = graph.AddPass(
+				"cull",
+				VK_PIPELINE_BIND_POINT_COMPUTE
 			);
 
-			if (!this->renderer.EndRenderPass(command_buffer.value())) {
+			if (
+				!cull_pass.WriteBuffer(draws, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT) ||
+				!cull_pass.WriteBuffer(instances, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT) ||
+				!cull_pass.WriteBuffer(meshlet_draws, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT) ||
+				!cull_pass.WriteBuffer(meshlet_indices, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT)
+			) {
 				this->running = false;
 				break;
 			}
 
+			cull_pass.SetRecord([&render_system, &frame_index](const RenderGraph::PassContext& context) {
+				render_system.RecordCulling(
+					context.command_buffer,
+					frame_index.value()
+				);
+
+				return true;
+			});
+
+			RenderGraph::PassBuilder models_pass = graph.AddPass(
+				"models",
+				VK_PIPELINE_BIND_POINT_GRAPHICS
+			);
+
+			if (
+				!models_pass.ReadBuffer(draws, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT) ||
+				!models_pass.ReadBuffer(instances, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT) ||
+				!models_pass.ReadBuffer(meshlet_draws, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT) ||
+				!models_pass.ReadBuffer(meshlet_indices, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT) ||
+				!models_pass.WriteColor(this->renderer.GetBackBuffer(), VkClearColorValue{ { 0.1f, 0.1f, 0.1f, 1.0f } }) ||
+				!models_pass.WriteDepth(this->renderer.GetDepthBuffer(), VkClearDepthStencilValue{ 1.0f, 0 })
+			) {
+				this->running = false;
+				break;
+			}
+
+			if (this->renderer.IsRecordingInParallel()) {
+				models_pass.UseSecondaryCommandBuffers();
+				models_pass.SetRecord([this, &render_system, &frame_index, descriptor_set, global_offset](const RenderGraph::PassContext& context) {
+					return this->renderer.RecordInParallel(
+						context,
+						render_system.GetDrawCount(),
+						[&render_system, &frame_index, descriptor_set, global_offset](VkCommandBuffer secondary_command_buffer, uint32_t first, uint32_t last) {
+							render_system.RenderModels(
+								secondary_command_buffer,
+								frame_index.value(),
+								descriptor_set,
+								global_offset,
+								first,
+								last
+							);
+						}
+					);
+				});
+			} else {
+				models_pass.SetRecord([&render_system, &frame_index, descriptor_set, global_offset](const RenderGraph::PassContext& context) {
+					render_system.RenderModels(
+						context.command_buffer,
+						frame_index.value(),
+						descriptor_set,
+						global_offset
+					);
+
+					return true;
+				});
+			}
+
 			if (!this->renderer.EndFrame()) {
 				this->running = false;
 				break;
 			}
+
+			frames_rendered++;
 		}
+
+		if (this->headless && frames_rendered != 0) {
+			vkDeviceWaitIdle(this->device.GetDevice());
+
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start_time;
+
+			printf(
+				"Rendered %u frames in %.2f ms (%.3f ms per frame)\n",
+				frames_rendered,
+				elapsed.count(),
+				elapsed.count() / frames_rendered
+			);
+		}
+
+		std::optional<double> latency = this->renderer.GetFramePacer().GetAverageLatency();
+		if (latency.has_value()) {
+			printf(
+				"Average cpu to present latency %.2f ms\n",
+				latency.value()
+			);
+		}
+
+		printf(
+			"Last frame drew %llu triangles in %u draws\n",
+			(unsigned long long)render_system.GetTriangleCount(),
+			render_system.GetDrawCount()
+		);
+
+		printf(
+			"Render graph culled %u passes, transient images take %.2f of %.2f MB\n",
+			this->renderer.GetRenderGraph().GetCulledPassCount(),
+			this->renderer.GetRenderGraph().GetTransientMemorySize() / (1024.0 * 1024.0),
+			this->renderer.GetRenderGraph().GetTransientImageSize() / (1024.0 * 1024.0)
+		);
+
+		PipelineCacheStats pipeline_stats = this->device.GetPipelineCacheStats();
+
+		printf(
+			"Created %u pipelines in %.2f ms, pipeline cache went from %zu to %zu bytes\n",
+			pipeline_stats.pipeline_count,
+			pipeline_stats.creation_time,
+			pipeline_stats.loaded_size,
+			pipeline_stats.size
+		);
+
+		this->renderer.GetGpuProfiler().Print();
 	}
 
 	bool Client::Running() const {
@@ -202,7 +359,15 @@ namespace yib {
 			return false;
 		}
 
-		std::shared_ptr<Model> model = std::make_shared<Model>(this->device, data.value());
+		MeshOptimizer::Optimize(data.value());
+		MeshOptimizer::GenerateLods(data.value());
+		MeshOptimizer::BuildMeshlets(data.value());
+
+		std::shared_ptr<Model> model = std::make_shared<Model>(
+			this->device,
+			data.value(),
+			this->vertex_layout
+		);
 		if (!model->success) {
 			return false;
 		}
@@ -221,15 +386,9 @@ namespace yib {
 		return true;
 	}
 
-	bool Client::CreateDescriptorPool() {
-		DescriptorPool::Builder builder = DescriptorPool::Builder(this->device);
-
-		builder.SetMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT);
-		builder.AddPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT);
-		builder.AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, SwapChain::MAX_FRAMES_IN_FLIGHT);
-
-		this->descriptor_pool = builder.Build();
-		if (!this->descriptor_pool->success) {
+	bool Client::CreateDescriptorCache() {
+		this->descriptor_cache = std::make_unique<DescriptorCache>(this->device);
+		if (!this->descriptor_cache->success) {
 			return false;
 		}
 
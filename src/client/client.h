@@ -12,12 +12,14 @@
 
 #include "object.h"
 #include "renderer/model.h"
+#include "renderer/mesh_optimizer.h"
 #include "renderer/buffer.h"
 #include "renderer/camera.h"
 #include "renderer/device.h"
 #include "renderer/window.h"
 #include "renderer/texture.h"
 #include "renderer/renderer.h"
+#include "renderer/pipeline_registry.h"
 #include "renderer/descriptors.h"
 #include "renderer/render_system.h"
 
@@ -31,7 +33,11 @@ namespace yib {
 		Client(
 			const std::string name,
 			const uint32_t width,
-			const uint32_t height
+			const uint32_t height,
+			const bool headless = false,
+			const uint32_t frame_count = 0,
+			const uint32_t record_threads = 0,
+			const FramePacing& pacing = {}
 		);
 
 		Client(const Client&) = delete;
@@ -44,18 +50,24 @@ namespace yib {
 	private:
 		// TODO: Remove this
 		bool CreateObjects();
-		bool CreateDescriptorPool();
+		bool CreateDescriptorCache();
 
 		bool running;
 		const std::string name;
 		const uint32_t width;
 		const uint32_t height;
+		const bool headless;
+		const uint32_t frame_count;
 
-		Window window;
+		std::unique_ptr<Window> window;
 		Device device;
 		Renderer renderer;
+		PipelineRegistry pipeline_registry;
 
-		std::unique_ptr<DescriptorPool> descriptor_pool;
+		// Shared by every model and the pipelines that draw them.
+		const VertexLayout vertex_layout = VertexLayout::Compact();
+
+		std::unique_ptr<DescriptorCache> descriptor_cache;
 
 		// TODO: Remove this
 		std::vector<std::shared_ptr<Object>> objects;
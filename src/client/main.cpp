@@ -1,12 +1,76 @@
 #include "client.h"
+#include "benchmark.h"
+#include "../shared/profiler.h"
 
-int main() {
-	yib::Client client = yib::Client("Yibengine", 1280, 720);
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+int main(int argc, char** argv) {
+	bool headless = false;
+	uint32_t frame_count = 0;
+	uint32_t record_threads = 0;
+	const char* trace_path = nullptr;
+	yib::FramePacing pacing = {};
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--headless")) {
+			headless = true;
+		} else if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+			frame_count = std::strtoul(argv[++i], nullptr, 10);
+		} else if (!strcmp(argv[i], "--record-threads") && i + 1 < argc) {
+			record_threads = std::strtoul(argv[++i], nullptr, 10);
+		} else if (!strcmp(argv[i], "--frames-in-flight") && i + 1 < argc) {
+			pacing.frames_in_flight = std::strtoul(argv[++i], nullptr, 10);
+		} else if (!strcmp(argv[i], "--swap-images") && i + 1 < argc) {
+			pacing.image_count = std::strtoul(argv[++i], nullptr, 10);
+		} else if (!strcmp(argv[i], "--fps-limit") && i + 1 < argc) {
+			pacing.frame_limit = std::strtod(argv[++i], nullptr);
+		} else if (!strcmp(argv[i], "--present-mode") && i + 1 < argc) {
+			std::optional<VkPresentModeKHR> present_mode = yib::FramePacing::ParsePresentMode(argv[++i]);
+			if (!present_mode.has_value()) {
+				printf("Unknown present mode %s\n", argv[i]);
+				return 1;
+			}
+
+			pacing.present_mode = present_mode.value();
+		} else if (!strcmp(argv[i], "--trace") && i + 1 < argc) {
+			trace_path = argv[++i];
+		} else if (!strcmp(argv[i], "--benchmark") && i + 1 < argc) {
+			return yib::Benchmark::Run(argv[++i]) ? 0 : 1;
+		}
+	}
+
+	if (headless && frame_count == 0) {
+		frame_count = 1000;
+	}
+
+	if (trace_path != nullptr) {
+		if (!yib::Profiler::IsCompiledIn()) {
+			printf("Tracing needs a build with YIB_ENABLE_PROFILER\n");
+			return 1;
+		}
+
+		yib::Profiler::Start();
+	}
+
+	yib::Client client = yib::Client("Yibengine", 1280, 720, headless, frame_count, record_threads, pacing);
 	if (!client.success) {
 		return 1;
 	}
 
 	client.Run();
 
+	if (trace_path != nullptr) {
+		yib::Profiler::Stop();
+
+		if (!yib::Profiler::WriteTrace(trace_path)) {
+			printf("Failed to write trace %s\n", trace_path);
+			return 1;
+		}
+
+		printf("Wrote trace %s\n", trace_path);
+	}
+
 	return 0;
 }
\ No newline at end of file
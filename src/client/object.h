@@ -5,6 +5,7 @@
 #include <memory>
 
 #include "renderer/model.h"
+#include "renderer/texture.h"
 
 namespace yib {
 	class Transform {
@@ -21,6 +22,10 @@ namespace yib {
 	class Object {
 	public:
 		std::shared_ptr<Model> model;
+		// Only sampled through the bindless texture array.
+		std::shared_ptr<Texture> texture;
 		Transform transform;
+		// Picked by RenderSystem, kept between frames for hysteresis.
+		uint32_t lod = 0;
 	};
 }
\ No newline at end of file
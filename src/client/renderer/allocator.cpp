@@ -0,0 +1,461 @@
+#include "allocator.h"
+
+#include <algorithm>
+
+namespace yib {
+	Allocator::Block::Block(
+		VkDeviceMemory memory,
+		void* mapped,
+		VkDeviceSize size
+	) :
+		memory(memory),
+		mapped(mapped),
+		size(size),
+		used(0)
+	{
+		this->max_order = GetOrder(size);
+
+		this->free_lists.resize(this->max_order + 1);
+		this->free_lists.at(this->max_order).insert(0);
+	}
+
+	bool Allocator::Block::Allocate(
+		VkDeviceSize size,
+		VkDeviceSize& offset
+	) {
+		uint32_t order = GetOrder(size);
+		if (order > this->max_order) {
+			return false;
+		}
+
+		uint32_t free_order = order;
+		while (free_order <= this->max_order && this->free_lists.at(free_order).empty()) {
+			free_order++;
+		}
+
+		if (free_order > this->max_order) {
+			return false;
+		}
+
+		std::set<VkDeviceSize>& free_list = this->free_lists.at(free_order);
+
+		offset = *free_list.begin();
+		free_list.erase(free_list.begin());
+
+		while (free_order > order) {
+			free_order--;
+			this->free_lists.at(free_order).insert(offset + GetOrderSize(free_order));
+		}
+
+		this->allocated[offset] = order;
+		this->used += GetOrderSize(order);
+
+		return true;
+	}
+
+	void Allocator::Block::Free(VkDeviceSize offset) {
+		std::unordered_map<VkDeviceSize, uint32_t>::iterator it = this->allocated.find(offset);
+		if (it == this->allocated.end()) {
+			return;
+		}
+
+		uint32_t order = it->second;
+		this->allocated.erase(it);
+		this->used -= GetOrderSize(order);
+
+		while (order < this->max_order) {
+			VkDeviceSize buddy = offset ^ GetOrderSize(order);
+
+			std::set<VkDeviceSize>& free_list = this->free_lists.at(order);
+			std::set<VkDeviceSize>::iterator buddy_it = free_list.find(buddy);
+			if (buddy_it == free_list.end()) {
+				break;
+			}
+
+			free_list.erase(buddy_it);
+			offset = std::min(offset, buddy);
+			order++;
+		}
+
+		this->free_lists.at(order).insert(offset);
+	}
+
+	bool Allocator::Block::Empty() const {
+		return this->allocated.empty();
+	}
+
+	bool Allocator::Block::Owns(VkDeviceMemory memory) const {
+		return this->memory == memory;
+	}
+
+	uint32_t Allocator::Block::GetOrder(VkDeviceSize size) const {
+		uint32_t order = 0;
+		while (GetOrderSize(order) < size) {
+			order++;
+		}
+
+		return order;
+	}
+
+	VkDeviceSize Allocator::Block::GetOrderSize(uint32_t order) const {
+		return MIN_ALLOCATION_SIZE << order;
+	}
+
+
+	Allocator::Allocator(
+		VkDevice device,
+		VkPhysicalDevice physical_device,
+		VkDeviceSize block_size
+	) :
+		device(device),
+		block_size(block_size)
+	{
+		vkGetPhysicalDeviceMemoryProperties(
+			physical_device,
+			&this->memory_properties
+		);
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physical_device, &properties);
+
+		this->buffer_image_granularity = properties.limits.bufferImageGranularity;
+		this->non_coherent_atom_size = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+
+		this->stats.resize(this->memory_properties.memoryTypeCount);
+	}
+
+	Allocator::~Allocator() {
+		for (Pool& pool : this->pools) {
+			for (std::unique_ptr<Block>& block : pool.blocks) {
+				FreeMemory(block->memory);
+			}
+		}
+	}
+
+
+	bool Allocator::Allocate(
+		const VkMemoryRequirements& requirements,
+		uint32_t memory_type,
+		bool linear,
+		Allocation& allocation
+	) {
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		allocation = {};
+		allocation.memory_type = memory_type;
+		allocation.size = requirements.size;
+
+		AllocatorStats& type_stats = this->stats.at(memory_type);
+
+		VkDeviceSize size = std::max(requirements.size, requirements.alignment);
+		VkDeviceSize block_size = GetBlockSize(memory_type);
+
+		if (size > block_size / 2) {
+			VkDeviceSize dedicated_size = (requirements.size + this->non_coherent_atom_size - 1) / this->non_coherent_atom_size * this->non_coherent_atom_size;
+
+			if (!AllocateMemory(
+				dedicated_size,
+				memory_type,
+				allocation.memory,
+				allocation.mapped
+			)) {
+				return false;
+			}
+
+			type_stats.dedicated_count++;
+			type_stats.allocation_count++;
+			type_stats.reserved_bytes += dedicated_size;
+			type_stats.used_bytes += requirements.size;
+
+			return true;
+		}
+
+		uint32_t pool_index = GetPoolIndex(memory_type, linear);
+		Pool& pool = this->pools.at(pool_index);
+
+		Block* target = nullptr;
+		VkDeviceSize offset = 0;
+
+		for (std::unique_ptr<Block>& block : pool.blocks) {
+			if (block->Allocate(size, offset)) {
+				target = block.get();
+				break;
+			}
+		}
+
+		if (target == nullptr) {
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			void* mapped = nullptr;
+
+			if (!AllocateMemory(
+				block_size,
+				memory_type,
+				memory,
+				mapped
+			)) {
+				return false;
+			}
+
+			pool.blocks.push_back(std::make_unique<Block>(
+				memory,
+				mapped,
+				block_size
+			));
+
+			type_stats.block_count++;
+			type_stats.reserved_bytes += block_size;
+
+			target = pool.blocks.back().get();
+			if (!target->Allocate(size, offset)) {
+				return false;
+			}
+		}
+
+		allocation.memory = target->memory;
+		allocation.offset = offset;
+		allocation.pool = pool_index;
+
+		if (target->mapped != nullptr) {
+			allocation.mapped = static_cast<char*>(target->mapped) + offset;
+		}
+
+		type_stats.allocation_count++;
+		type_stats.used_bytes += requirements.size;
+
+		return true;
+	}
+
+	void Allocator::Free(Allocation& allocation) {
+		if (allocation.memory == VK_NULL_HANDLE) {
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		AllocatorStats& type_stats = this->stats.at(allocation.memory_type);
+
+		type_stats.allocation_count--;
+		type_stats.used_bytes -= allocation.size;
+
+		if (allocation.pool == UINT32_MAX) {
+			FreeMemory(allocation.memory);
+
+			type_stats.dedicated_count--;
+			type_stats.reserved_bytes -= (allocation.size + this->non_coherent_atom_size - 1) / this->non_coherent_atom_size * this->non_coherent_atom_size;
+
+			allocation = {};
+			return;
+		}
+
+		Pool& pool = this->pools.at(allocation.pool);
+
+		for (size_t i = 0; i < pool.blocks.size(); i++) {
+			Block& block = *pool.blocks.at(i);
+			if (!block.Owns(allocation.memory)) {
+				continue;
+			}
+
+			block.Free(allocation.offset);
+
+			if (block.Empty() && pool.blocks.size() > 1) {
+				type_stats.block_count--;
+				type_stats.reserved_bytes -= block.size;
+
+				FreeMemory(block.memory);
+				pool.blocks.erase(pool.blocks.begin() + i);
+			}
+
+			break;
+		}
+
+		allocation = {};
+	}
+
+
+	bool Allocator::Flush(
+		const Allocation& allocation,
+		VkDeviceSize size,
+		VkDeviceSize offset
+	) const {
+		if (allocation.mapped == nullptr) {
+			return false;
+		}
+
+		if (IsHostCoherent(allocation.memory_type)) {
+			return true;
+		}
+
+		VkDeviceSize begin = allocation.offset + offset;
+		VkDeviceSize end = size == VK_WHOLE_SIZE ? allocation.offset + allocation.size : begin + size;
+
+		VkMappedMemoryRange memory_range = { };
+
+		memory_range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		memory_range.memory = allocation.memory;
+		memory_range.offset = begin / this->non_coherent_atom_size * this->non_coherent_atom_size;
+		memory_range.size = (end + this->non_coherent_atom_size - 1) / this->non_coherent_atom_size * this->non_coherent_atom_size - memory_range.offset;
+
+		return vkFlushMappedMemoryRanges(
+			this->device,
+			1,
+			&memory_range
+		) == VK_SUCCESS;
+	}
+
+	bool Allocator::Invalidate(
+		const Allocation& allocation,
+		VkDeviceSize size,
+		VkDeviceSize offset
+	) const {
+		if (allocation.mapped == nullptr) {
+			return false;
+		}
+
+		if (IsHostCoherent(allocation.memory_type)) {
+			return true;
+		}
+
+		VkDeviceSize begin = allocation.offset + offset;
+		VkDeviceSize end = size == VK_WHOLE_SIZE ? allocation.offset + allocation.size : begin + size;
+
+		VkMappedMemoryRange memory_range = { };
+
+		memory_range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		memory_range.memory = allocation.memory;
+		memory_range.offset = begin / this->non_coherent_atom_size * this->non_coherent_atom_size;
+		memory_range.size = (end + this->non_coherent_atom_size - 1) / this->non_coherent_atom_size * this->non_coherent_atom_size - memory_range.offset;
+
+		return vkInvalidateMappedMemoryRanges(
+			this->device,
+			1,
+			&memory_range
+		) == VK_SUCCESS;
+	}
+
+
+	AllocatorStats Allocator::GetStats() const {
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		AllocatorStats total = {};
+
+		for (const AllocatorStats& type_stats : this->stats) {
+			total.block_count += type_stats.block_count;
+			total.dedicated_count += type_stats.dedicated_count;
+			total.allocation_count += type_stats.allocation_count;
+			total.reserved_bytes += type_stats.reserved_bytes;
+			total.used_bytes += type_stats.used_bytes;
+		}
+
+		return total;
+	}
+
+	AllocatorStats Allocator::GetStats(uint32_t memory_type) const {
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		if (memory_type >= this->stats.size()) {
+			return {};
+		}
+
+		return this->stats.at(memory_type);
+	}
+
+
+	bool Allocator::AllocateMemory(
+		VkDeviceSize size,
+		uint32_t memory_type,
+		VkDeviceMemory& memory,
+		void*& mapped
+	) {
+		VkMemoryAllocateInfo allocation_info = {};
+
+		allocation_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocation_info.allocationSize = size;
+		allocation_info.memoryTypeIndex = memory_type;
+
+		if (vkAllocateMemory(
+			this->device,
+			&allocation_info,
+			nullptr,
+			&memory
+		) != VK_SUCCESS) {
+			return false;
+		}
+
+		mapped = nullptr;
+
+		if (IsHostVisible(memory_type)) {
+			if (vkMapMemory(
+				this->device,
+				memory,
+				0,
+				VK_WHOLE_SIZE,
+				0,
+				&mapped
+			) != VK_SUCCESS) {
+				vkFreeMemory(
+					this->device,
+					memory,
+					nullptr
+				);
+
+				memory = VK_NULL_HANDLE;
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void Allocator::FreeMemory(VkDeviceMemory memory) {
+		vkFreeMemory(
+			this->device,
+			memory,
+			nullptr
+		);
+	}
+
+
+	bool Allocator::IsHostVisible(uint32_t memory_type) const {
+		return this->memory_properties.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+	}
+
+	bool Allocator::IsHostCoherent(uint32_t memory_type) const {
+		return this->memory_properties.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	}
+
+	uint32_t Allocator::GetPoolIndex(uint32_t memory_type, bool linear) {
+		// Linear and optimal resources only need to be kept apart when the
+		// device reports a bufferImageGranularity larger than one byte.
+		if (this->buffer_image_granularity <= 1) {
+			linear = true;
+		}
+
+		for (uint32_t i = 0; i < this->pools.size(); i++) {
+			const Pool& pool = this->pools.at(i);
+
+			if (pool.memory_type == memory_type && pool.linear == linear) {
+				return i;
+			}
+		}
+
+		Pool pool = {};
+		pool.memory_type = memory_type;
+		pool.linear = linear;
+
+		this->pools.push_back(std::move(pool));
+
+		return this->pools.size() - 1;
+	}
+
+	VkDeviceSize Allocator::GetBlockSize(uint32_t memory_type) const {
+		uint32_t heap_index = this->memory_properties.memoryTypes[memory_type].heapIndex;
+		VkDeviceSize heap_size = this->memory_properties.memoryHeaps[heap_index].size;
+
+		VkDeviceSize size = this->block_size;
+		while (size > heap_size / 8 && size > MIN_ALLOCATION_SIZE * 1024) {
+			size /= 2;
+		}
+
+		return size;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <set>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+#include <vulkan/vulkan.h>
+
+namespace yib {
+	struct Allocation {
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		void* mapped = nullptr;
+
+		uint32_t memory_type = 0;
+		uint32_t pool = UINT32_MAX;
+	};
+
+	struct AllocatorStats {
+		uint32_t block_count = 0;
+		uint32_t dedicated_count = 0;
+		uint32_t allocation_count = 0;
+		VkDeviceSize reserved_bytes = 0;
+		VkDeviceSize used_bytes = 0;
+	};
+
+	class Allocator {
+	public:
+		Allocator(
+			VkDevice device,
+			VkPhysicalDevice physical_device,
+			VkDeviceSize block_size = 64 * 1024 * 1024
+		);
+		~Allocator();
+
+		Allocator(const Allocator&) = delete;
+		Allocator& operator=(const Allocator&) = delete;
+
+		bool Allocate(
+			const VkMemoryRequirements& requirements,
+			uint32_t memory_type,
+			bool linear,
+			Allocation& allocation
+		);
+		void Free(Allocation& allocation);
+
+		bool Flush(
+			const Allocation& allocation,
+			VkDeviceSize size = VK_WHOLE_SIZE,
+			VkDeviceSize offset = 0
+		) const;
+		bool Invalidate(
+			const Allocation& allocation,
+			VkDeviceSize size = VK_WHOLE_SIZE,
+			VkDeviceSize offset = 0
+		) const;
+
+		AllocatorStats GetStats() const;
+		AllocatorStats GetStats(uint32_t memory_type) const;
+
+		static constexpr VkDeviceSize MIN_ALLOCATION_SIZE = 256;
+	private:
+		// Power of two sized VkDeviceMemory split with a binary buddy scheme.
+		// Every node is aligned to its own size, so any alignment up to the
+		// node size is satisfied for free.
+		class Block {
+		public:
+			Block(
+				VkDeviceMemory memory,
+				void* mapped,
+				VkDeviceSize size
+			);
+
+			bool Allocate(
+				VkDeviceSize size,
+				VkDeviceSize& offset
+			);
+			void Free(VkDeviceSize offset);
+
+			bool Empty() const;
+			bool Owns(VkDeviceMemory memory) const;
+
+			VkDeviceMemory memory;
+			void* mapped;
+			VkDeviceSize size;
+			VkDeviceSize used;
+		private:
+			uint32_t GetOrder(VkDeviceSize size) const;
+			VkDeviceSize GetOrderSize(uint32_t order) const;
+
+			uint32_t max_order;
+			std::vector<std::set<VkDeviceSize>> free_lists;
+			std::unordered_map<VkDeviceSize, uint32_t> allocated;
+		};
+
+		struct Pool {
+			uint32_t memory_type = 0;
+			bool linear = true;
+			std::vector<std::unique_ptr<Block>> blocks = {};
+		};
+
+		bool AllocateMemory(
+			VkDeviceSize size,
+			uint32_t memory_type,
+			VkDeviceMemory& memory,
+			void*& mapped
+		);
+		void FreeMemory(VkDeviceMemory memory);
+
+		bool IsHostVisible(uint32_t memory_type) const;
+		bool IsHostCoherent(uint32_t memory_type) const;
+		uint32_t GetPoolIndex(uint32_t memory_type, bool linear);
+		VkDeviceSize GetBlockSize(uint32_t memory_type) const;
+
+		VkDevice device;
+		VkDeviceSize block_size;
+		VkDeviceSize buffer_image_granularity;
+		VkDeviceSize non_coherent_atom_size;
+		VkPhysicalDeviceMemoryProperties memory_properties;
+
+		mutable std::mutex mutex;
+		std::vector<Pool> pools;
+		std::vector<AllocatorStats> stats;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,232 @@
+#include "bindless_textures.h"
+
+#include <algorithm>
+
+namespace yib {
+	BindlessTextures::BindlessTextures(
+		Device& device,
+		uint32_t capacity
+	) :
+		device(device),
+		success(false)
+	{
+		// The layout is update after bind, which has its own and usually
+		// lower limits than regular descriptor sets.
+		VkPhysicalDeviceDescriptorIndexingProperties indexing_properties = {};
+
+		indexing_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+		VkPhysicalDeviceProperties2 properties = {};
+
+		properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties.pNext = &indexing_properties;
+
+		vkGetPhysicalDeviceProperties2(
+			device.GetPhysicalDevice(),
+			&properties
+		);
+
+		this->capacity = std::min({
+			capacity,
+			indexing_properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+			indexing_properties.maxPerStageDescriptorUpdateAfterBindSamplers,
+			indexing_properties.maxDescriptorSetUpdateAfterBindSampledImages,
+			indexing_properties.maxDescriptorSetUpdateAfterBindSamplers
+		});
+
+		if (!CreateDescriptorSetLayout()) {
+			return;
+		}
+
+		if (!CreateDescriptorSet()) {
+			return;
+		}
+
+		this->success = true;
+	}
+
+	BindlessTextures::~BindlessTextures() {
+		vkDestroyDescriptorPool(
+			this->device.GetDevice(),
+			this->descriptor_pool,
+			nullptr
+		);
+
+		vkDestroyDescriptorSetLayout(
+			this->device.GetDevice(),
+			this->set_layout,
+			nullptr
+		);
+	}
+
+
+	std::optional<uint32_t> BindlessTextures::Register(const VkDescriptorImageInfo& image_info) {
+		uint32_t slot = 0;
+
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+
+			ReleaseRetiredSlots();
+
+			if (!this->free_slots.empty()) {
+				slot = this->free_slots.back();
+				this->free_slots.pop_back();
+			} else if (this->next_slot < this->capacity) {
+				slot = this->next_slot++;
+			} else {
+				return std::nullopt;
+			}
+		}
+
+		VkWriteDescriptorSet write = {};
+
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = this->descriptor_set;
+		write.dstBinding = BINDING;
+		write.dstArrayElement = slot;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		write.descriptorCount = 1;
+		write.pImageInfo = &image_info;
+
+		vkUpdateDescriptorSets(
+			this->device.GetDevice(),
+			1,
+			&write,
+			0,
+			nullptr
+		);
+
+		return slot;
+	}
+
+	void BindlessTextures::Unregister(uint32_t slot) {
+		std::unique_lock<std::mutex> lock(this->mutex);
+
+		// The stale descriptor stays behind, partially bound arrays only
+		// have to be valid where they are sampled. Frames already submitted
+		// may still sample it, so it is not overwritten before they finish.
+		RetiredSlot retired = {};
+
+		retired.slot = slot;
+		retired.frame = this->frame_sync != nullptr ? this->frame_sync->GetSubmittedFrame() : 0;
+
+		this->retired_slots.push_back(retired);
+	}
+
+	void BindlessTextures::SetFrameSync(FrameSync* frame_sync) {
+		std::unique_lock<std::mutex> lock(this->mutex);
+
+		this->frame_sync = frame_sync;
+
+		ReleaseRetiredSlots();
+	}
+
+	uint32_t BindlessTextures::GetCapacity() const {
+		return this->capacity;
+	}
+
+	VkDescriptorSetLayout BindlessTextures::GetDescriptorSetLayout() const {
+		return this->set_layout;
+	}
+
+	VkDescriptorSet BindlessTextures::GetDescriptorSet() const {
+		return this->descriptor_set;
+	}
+
+
+	bool BindlessTextures::CreateDescriptorSetLayout() {
+		VkDescriptorSetLayoutBinding binding = {};
+
+		binding.binding = BINDING;
+		binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		binding.descriptorCount = this->capacity;
+		binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+		VkDescriptorBindingFlags binding_flags =
+			VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+			VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+			VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+		VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info = {};
+
+		binding_flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+		binding_flags_info.bindingCount = 1;
+		binding_flags_info.pBindingFlags = &binding_flags;
+
+		VkDescriptorSetLayoutCreateInfo create_info = {};
+
+		create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		create_info.pNext = &binding_flags_info;
+		create_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+		create_info.bindingCount = 1;
+		create_info.pBindings = &binding;
+
+		if (vkCreateDescriptorSetLayout(
+			this->device.GetDevice(),
+			&create_info,
+			nullptr,
+			&this->set_layout
+		) != VK_SUCCESS) {
+			return false;
+		}
+
+		return true;
+	}
+
+	bool BindlessTextures::CreateDescriptorSet() {
+		VkDescriptorPoolSize pool_size = {};
+
+		pool_size.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		pool_size.descriptorCount = this->capacity;
+
+		VkDescriptorPoolCreateInfo pool_info = {};
+
+		pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+		pool_info.maxSets = 1;
+		pool_info.poolSizeCount = 1;
+		pool_info.pPoolSizes = &pool_size;
+
+		if (vkCreateDescriptorPool(
+			this->device.GetDevice(),
+			&pool_info,
+			nullptr,
+			&this->descriptor_pool
+		) != VK_SUCCESS) {
+			return false;
+		}
+
+		VkDescriptorSetAllocateInfo allocate_info = {};
+
+		allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocate_info.descriptorPool = this->descriptor_pool;
+		allocate_info.descriptorSetCount = 1;
+		allocate_info.pSetLayouts = &this->set_layout;
+
+		if (vkAllocateDescriptorSets(
+			this->device.GetDevice(),
+			&allocate_info,
+			&this->descriptor_set
+		) != VK_SUCCESS) {
+			return false;
+		}
+
+		return true;
+	}
+
+
+	void BindlessTextures::ReleaseRetiredSlots() {
+		std::vector<RetiredSlot>::iterator it = this->retired_slots.begin();
+
+		while (it != this->retired_slots.end()) {
+			if (this->frame_sync != nullptr && !this->frame_sync->IsFrameComplete(it->frame)) {
+				it++;
+				continue;
+			}
+
+			this->free_slots.push_back(it->slot);
+
+			it = this->retired_slots.erase(it);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <optional>
+
+#include <vulkan/vulkan.h>
+
+#include "device.h"
+#include "frame_sync.h"
+
+namespace yib {
+	// One descriptor set holding a large, partially bound array of every
+	// registered texture. Shaders index it with the texture's slot, so
+	// switching textures never switches descriptor sets.
+	class BindlessTextures {
+	public:
+		BindlessTextures(
+			Device& device,
+			uint32_t capacity = 4096
+		);
+		~BindlessTextures();
+
+		BindlessTextures(const BindlessTextures&) = delete;
+		BindlessTextures& operator=(const BindlessTextures&) = delete;
+
+		// The slot stays valid until it is unregistered. Writing it is
+		// allowed while the set is bound, as long as no frame in flight
+		// samples that slot.
+		std::optional<uint32_t> Register(const VkDescriptorImageInfo& image_info);
+		// The slot is only handed out again once every frame submitted
+		// before this call has completed.
+		void Unregister(uint32_t slot);
+
+		// Frames are tracked by the renderer, which is created after the
+		// device. Without a frame sync nothing can be in flight, so slots
+		// are reused right away and every retired slot is released.
+		void SetFrameSync(FrameSync* frame_sync);
+
+		uint32_t GetCapacity() const;
+		VkDescriptorSetLayout GetDescriptorSetLayout() const;
+		VkDescriptorSet GetDescriptorSet() const;
+
+		static constexpr uint32_t BINDING = 0;
+
+		bool success;
+	private:
+		bool CreateDescriptorSetLayout();
+		bool CreateDescriptorSet();
+
+		// Has to be called with the mutex held.
+		void ReleaseRetiredSlots();
+
+		struct RetiredSlot {
+			uint32_t slot;
+			uint64_t frame;
+		};
+
+		Device& device;
+		uint32_t capacity;
+
+		VkDescriptorSetLayout set_layout = VK_NULL_HANDLE;
+		VkDescriptorPool descriptor_pool = VK_NULL_HANDLE;
+		VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+
+		std::mutex mutex;
+		uint32_t next_slot = 0;
+		std::vector<uint32_t> free_slots = {};
+		std::vector<RetiredSlot> retired_slots = {};
+		FrameSync* frame_sync = nullptr;
+	};
+}
\ No newline at end of file
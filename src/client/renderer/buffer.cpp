@@ -27,7 +27,7 @@ namespace yib {
 			this->flags,
 			this->memory_flags,
 			this->buffer,
-			this->memory
+			this->allocation
 		)) {
 			return;
 		}
@@ -44,11 +44,7 @@ namespace yib {
 			nullptr
 		);
 
-		vkFreeMemory(
-			this->device.GetDevice(),
-			this->memory,
-			nullptr
-		);
+		this->device.GetAllocator().Free(this->allocation);
 	}
 
 
@@ -89,30 +85,20 @@ namespace yib {
 		VkDeviceSize size,
 		VkDeviceSize offset
 	) {
-		if (buffer == VK_NULL_HANDLE || memory == VK_NULL_HANDLE) {
+		if (this->buffer == VK_NULL_HANDLE || this->allocation.mapped == nullptr) {
 			return false;
 		}
 
-		return vkMapMemory(
-			this->device.GetDevice(),
-			this->memory,
-			offset,
-			size,
-			0,
-			&this->mapped
-		) == VK_SUCCESS;
-	}
-
-	void Buffer::Unmap() {
-		if (this->mapped == nullptr) {
-			return;
+		if (offset > this->buffer_size || (size != VK_WHOLE_SIZE && size > this->buffer_size - offset)) {
+			return false;
 		}
 
-		vkUnmapMemory(
-			this->device.GetDevice(),
-			this->memory
-		);
+		this->mapped = static_cast<char*>(this->allocation.mapped) + offset;
 
+		return true;
+	}
+
+	void Buffer::Unmap() {
 		this->mapped = nullptr;
 	}
 
@@ -152,17 +138,10 @@ namespace yib {
 		VkDeviceSize size,
 		VkDeviceSize offset
 	) {
-		VkMappedMemoryRange memory_range = { };
-
-		memory_range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-		memory_range.memory = this->memory;
-		memory_range.offset = offset;
-		memory_range.size = size;
-
-		return vkFlushMappedMemoryRanges(
-			this->device.GetDevice(),
-			1,
-			&memory_range
+		return this->device.GetAllocator().Flush(
+			this->allocation,
+			size,
+			offset
 		);
 	}
 
@@ -170,18 +149,11 @@ namespace yib {
 		VkDeviceSize size,
 		VkDeviceSize offset
 	) {
-		VkMappedMemoryRange memory_ranged = { };
-
-		memory_ranged.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-		memory_ranged.memory = this->memory;
-		memory_ranged.offset = offset;
-		memory_ranged.size = size;
-
-		return vkInvalidateMappedMemoryRanges(
-			this->device.GetDevice(),
-			1,
-			&memory_ranged
-		) == VK_SUCCESS;
+		return this->device.GetAllocator().Invalidate(
+			this->allocation,
+			size,
+			offset
+		);
 	}
 
 	VkDescriptorBufferInfo Buffer::DescriptorInfo(
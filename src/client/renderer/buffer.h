@@ -64,18 +64,21 @@ namespace yib {
 		bool InvalidateIndex(int index);
 		VkDescriptorBufferInfo DescriptorInfoForIndex(int index);
 
-		bool success;
-	private:
+		// Rounds the size up to a multiple of the alignment, which has to
+		// be a power of two.
 		static VkDeviceSize GetAlignment(
 			VkDeviceSize instance_size,
 			VkDeviceSize min_offset_alignment
 		);
 
+		bool success;
+	private:
+
 		Device& device;
 
 		void* mapped = nullptr;
 		VkBuffer buffer = VK_NULL_HANDLE;
-		VkDeviceMemory memory = VK_NULL_HANDLE;
+		Allocation allocation = {};
 
 		VkDeviceSize buffer_size;
 		uint32_t instance_count;
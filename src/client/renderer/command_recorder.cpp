@@ -0,0 +1,231 @@
+#include "command_recorder.h"
+
+#include <atomic>
+#include <algorithm>
+
+#include "swapchain.h"
+
+namespace yib {
+	CommandRecorder::CommandRecorder(
+		Device& device,
+		uint32_t thread_count
+	) :
+		device(device),
+		thread_pool(thread_count),
+		success(false)
+	{
+		if (!CreateCommandPools()) {
+			return;
+		}
+
+		this->success = true;
+	}
+
+	CommandRecorder::~CommandRecorder() {
+		this->thread_pool.Wait();
+
+		DestroyCommandPools();
+	}
+
+
+	std::optional<std::vector<VkCommandBuffer>> CommandRecorder::Record(
+		uint32_t frame_index,
+		VkRenderPass render_pass,
+		VkFramebuffer framebuffer,
+		VkExtent2D extent,
+		uint32_t count,
+		const RecordFunction& record
+	) {
+		std::vector<VkCommandPool>& command_pools = this->command_pools.at(frame_index);
+		std::vector<VkCommandBuffer>& command_buffers = this->command_buffers.at(frame_index);
+
+		for (VkCommandPool command_pool : command_pools) {
+			if (vkResetCommandPool(
+				this->device.GetDevice(),
+				command_pool,
+				0
+			) != VK_SUCCESS) {
+				return std::nullopt;
+			}
+		}
+
+		uint32_t range_count = std::min<uint32_t>(count, command_pools.size());
+		if (range_count == 0) {
+			return std::vector<VkCommandBuffer>();
+		}
+
+		VkCommandBufferInheritanceInfo inheritance_info = {};
+
+		inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritance_info.renderPass = render_pass;
+		inheritance_info.subpass = 0;
+		inheritance_info.framebuffer = framebuffer;
+
+		std::atomic<bool> failed = false;
+
+		for (uint32_t i = 0; i < range_count; i++) {
+			uint32_t first = count * i / range_count;
+			uint32_t last = count * (i + 1) / range_count;
+			VkCommandBuffer command_buffer = command_buffers.at(i);
+
+			this->thread_pool.Submit([this, command_buffer, &inheritance_info, extent, first, last, &record, &failed]() {
+				if (!RecordRange(
+					command_buffer,
+					inheritance_info,
+					extent,
+					first,
+					last,
+					record
+				)) {
+					failed = true;
+				}
+			});
+		}
+
+		this->thread_pool.Wait();
+
+		if (failed) {
+			return std::nullopt;
+		}
+
+		return std::vector<VkCommandBuffer>(
+			command_buffers.begin(),
+			command_buffers.begin() + range_count
+		);
+	}
+
+
+	uint32_t CommandRecorder::GetThreadCount() const {
+		return this->thread_pool.GetThreadCount();
+	}
+
+
+	bool CommandRecorder::CreateCommandPools() {
+		QueueFamiliyIndices indices = this->device.GetFamilyIndices(this->device.GetPhysicalDevice());
+		uint32_t thread_count = this->thread_pool.GetThreadCount();
+
+		this->command_pools.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+		this->command_buffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+
+		for (uint32_t frame = 0; frame < SwapChain::MAX_FRAMES_IN_FLIGHT; frame++) {
+			for (uint32_t thread = 0; thread < thread_count; thread++) {
+				VkCommandPoolCreateInfo pool_info = {};
+
+				pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+				pool_info.queueFamilyIndex = indices.graphics_index;
+				pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+				VkCommandPool command_pool = VK_NULL_HANDLE;
+
+				if (vkCreateCommandPool(
+					this->device.GetDevice(),
+					&pool_info,
+					nullptr,
+					&command_pool
+				) != VK_SUCCESS) {
+					return false;
+				}
+
+				this->command_pools.at(frame).push_back(command_pool);
+
+				VkCommandBufferAllocateInfo allocation_info = {};
+
+				allocation_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+				allocation_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+				allocation_info.commandPool = command_pool;
+				allocation_info.commandBufferCount = 1;
+
+				VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+
+				if (vkAllocateCommandBuffers(
+					this->device.GetDevice(),
+					&allocation_info,
+					&command_buffer
+				) != VK_SUCCESS) {
+					return false;
+				}
+
+				this->command_buffers.at(frame).push_back(command_buffer);
+			}
+		}
+
+		return true;
+	}
+
+	void CommandRecorder::DestroyCommandPools() {
+		for (std::vector<VkCommandPool>& command_pools : this->command_pools) {
+			for (VkCommandPool command_pool : command_pools) {
+				vkDestroyCommandPool(
+					this->device.GetDevice(),
+					command_pool,
+					nullptr
+				);
+			}
+		}
+
+		this->command_pools.clear();
+		this->command_buffers.clear();
+	}
+
+
+	bool CommandRecorder::RecordRange(
+		VkCommandBuffer command_buffer,
+		const VkCommandBufferInheritanceInfo& inheritance_info,
+		VkExtent2D extent,
+		uint32_t first,
+		uint32_t last,
+		const RecordFunction& record
+	) const {
+		VkCommandBufferBeginInfo begin_info = {};
+
+		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		begin_info.pInheritanceInfo = &inheritance_info;
+
+		if (vkBeginCommandBuffer(
+			command_buffer,
+			&begin_info
+		) != VK_SUCCESS) {
+			return false;
+		}
+
+		// Dynamic state is not inherited from the primary command buffer.
+		VkViewport viewport = {};
+
+		viewport.x = 0.0f;
+		viewport.y = 0.0f;
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+		viewport.width = extent.width;
+		viewport.height = extent.height;
+
+		vkCmdSetViewport(
+			command_buffer,
+			0,
+			1,
+			&viewport
+		);
+
+		VkRect2D scissor = {};
+
+		scissor.offset = { 0, 0 };
+		scissor.extent = extent;
+
+		vkCmdSetScissor(
+			command_buffer,
+			0,
+			1,
+			&scissor
+		);
+
+		record(command_buffer, first, last);
+
+		if (vkEndCommandBuffer(
+			command_buffer
+		) != VK_SUCCESS) {
+			return false;
+		}
+
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <functional>
+
+#include <vulkan/vulkan.h>
+
+#include "device.h"
+#include "../../shared/thread_pool.h"
+
+namespace yib {
+	class CommandRecorder {
+	public:
+		typedef std::function<void(
+			VkCommandBuffer command_buffer,
+			uint32_t first,
+			uint32_t last
+		)> RecordFunction;
+
+		CommandRecorder(
+			Device& device,
+			uint32_t thread_count = 0
+		);
+		~CommandRecorder();
+
+		CommandRecorder(const CommandRecorder&) = delete;
+		CommandRecorder& operator=(const CommandRecorder&) = delete;
+
+		// Splits [0, count) into one range per worker and records every range
+		// into its own secondary command buffer that continues the render
+		// pass. Resets the frame's pools, so it has to run at most once per
+		// frame and only after the frame's fence was waited on.
+		std::optional<std::vector<VkCommandBuffer>> Record(
+			uint32_t frame_index,
+			VkRenderPass render_pass,
+			VkFramebuffer framebuffer,
+			VkExtent2D extent,
+			uint32_t count,
+			const RecordFunction& record
+		);
+
+		uint32_t GetThreadCount() const;
+
+		bool success;
+	private:
+		bool CreateCommandPools();
+		void DestroyCommandPools();
+
+		bool RecordRange(
+			VkCommandBuffer command_buffer,
+			const VkCommandBufferInheritanceInfo& inheritance_info,
+			VkExtent2D extent,
+			uint32_t first,
+			uint32_t last,
+			const RecordFunction& record
+		) const;
+
+		Device& device;
+		ThreadPool thread_pool;
+
+		// Indexed by frame and then by worker. A command pool may only be
+		// used by one thread at a time, so every range gets its own.
+		std::vector<std::vector<VkCommandPool>> command_pools = {};
+		std::vector<std::vector<VkCommandBuffer>> command_buffers = {};
+	};
+}
\ No newline at end of file
@@ -0,0 +1,174 @@
+#include "compute_pipeline.h"
+
+#include <chrono>
+
+#include "../../shared/file.h"
+
+namespace yib {
+	ComputePipeline::ComputePipeline(
+		Device& device,
+		const std::string compute_shader,
+		std::vector<VkDescriptorSetLayout> set_layouts,
+		std::vector<VkPushConstantRange> push_constant_ranges
+	) :
+		device(device),
+		compute_shader(compute_shader),
+		set_layouts(set_layouts),
+		push_constant_ranges(push_constant_ranges),
+		success(false)
+	{
+		if (!CreateShaderModule()) {
+			return;
+		}
+
+		if (!CreatePipelineLayout()) {
+			return;
+		}
+
+		if (!CreatePipeline()) {
+			return;
+		}
+
+		this->success = true;
+	}
+
+	ComputePipeline::~ComputePipeline() {
+		DestoryPipeline();
+		DestroyPipelineLayout();
+		DestroyShaderModule();
+	}
+
+
+	VkPipelineLayout ComputePipeline::GetPipelineLayout() const {
+		return this->pipeline_layout;
+	}
+
+
+	void ComputePipeline::BindCommandBuffer(VkCommandBuffer command_buffer) const {
+		vkCmdBindPipeline(
+			command_buffer,
+			VK_PIPELINE_BIND_POINT_COMPUTE,
+			this->pipeline
+		);
+	}
+
+
+	bool ComputePipeline::CreateShaderModule() {
+		std::vector<char> shader_code = File::Read(this->compute_shader.c_str());
+		if (shader_code.empty()) {
+			return false;
+		}
+
+		VkShaderModuleCreateInfo create_info = {};
+
+		create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		create_info.pCode = reinterpret_cast<const uint32_t*>(shader_code.data());
+		create_info.codeSize = shader_code.size();
+
+		if (vkCreateShaderModule(
+			this->device.GetDevice(),
+			&create_info,
+			nullptr,
+			&this->shader_module
+		) != VK_SUCCESS) {
+			return false;
+		}
+
+		return true;
+	}
+
+	void ComputePipeline::DestroyShaderModule() {
+		if (this->shader_module == VK_NULL_HANDLE) {
+			return;
+		}
+
+		vkDestroyShaderModule(
+			this->device.GetDevice(),
+			this->shader_module,
+			nullptr
+		);
+	}
+
+
+	bool ComputePipeline::CreatePipelineLayout() {
+		VkPipelineLayoutCreateInfo layout_info = {};
+
+		layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		layout_info.setLayoutCount = this->set_layouts.size();
+		layout_info.pSetLayouts = this->set_layouts.data();
+		layout_info.pushConstantRangeCount = this->push_constant_ranges.size();
+		layout_info.pPushConstantRanges = this->push_constant_ranges.data();
+
+		if (vkCreatePipelineLayout(
+			this->device.GetDevice(),
+			&layout_info,
+			nullptr,
+			&this->pipeline_layout
+		) != VK_SUCCESS) {
+			return false;
+		}
+
+		return true;
+	}
+
+	void ComputePipeline::DestroyPipelineLayout() {
+		if (this->pipeline_layout == VK_NULL_HANDLE) {
+			return;
+		}
+
+		vkDestroyPipelineLayout(
+			this->device.GetDevice(),
+			this->pipeline_layout,
+			nullptr
+		);
+	}
+
+
+	bool ComputePipeline::CreatePipeline() {
+		VkPipelineShaderStageCreateInfo shader_stage = {};
+
+		shader_stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shader_stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		shader_stage.module = this->shader_module;
+		shader_stage.pName = "main";
+
+		VkComputePipelineCreateInfo pipeline_info = {};
+
+		pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipeline_info.stage = shader_stage;
+		pipeline_info.layout = this->pipeline_layout;
+		pipeline_info.basePipelineIndex = -1;
+		pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
+
+		std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+		if (vkCreateComputePipelines(
+			this->device.GetDevice(),
+			this->device.GetPipelineCache(),
+			1,
+			&pipeline_info,
+			nullptr,
+			&this->pipeline
+		) != VK_SUCCESS) {
+			return false;
+		}
+
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start_time;
+
+		this->device.RecordPipelineCreation(elapsed.count());
+
+		return true;
+	}
+
+	void ComputePipeline::DestoryPipeline() {
+		if (this->pipeline == VK_NULL_HANDLE) {
+			return;
+		}
+
+		vkDestroyPipeline(
+			this->device.GetDevice(),
+			this->pipeline,
+			nullptr
+		);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "device.h"
+
+namespace yib {
+	class ComputePipeline {
+	public:
+		ComputePipeline(
+			Device& device,
+			const std::string compute_shader,
+			std::vector<VkDescriptorSetLayout> set_layouts,
+			std::vector<VkPushConstantRange> push_constant_ranges = {}
+		);
+		~ComputePipeline();
+
+		ComputePipeline(const ComputePipeline&) = delete;
+		ComputePipeline& operator=(const ComputePipeline&) = delete;
+
+		VkPipelineLayout GetPipelineLayout() const;
+
+		void BindCommandBuffer(VkCommandBuffer command_buffer) const;
+
+		bool success;
+	private:
+		bool CreateShaderModule();
+		void DestroyShaderModule();
+
+		bool CreatePipelineLayout();
+		void DestroyPipelineLayout();
+
+		bool CreatePipeline();
+		void DestoryPipeline();
+
+		const std::string compute_shader;
+		std::vector<VkDescriptorSetLayout> set_layouts;
+		std::vector<VkPushConstantRange> push_constant_ranges;
+
+		Device& device;
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+		VkShaderModule shader_module = VK_NULL_HANDLE;
+	};
+}
\ No newline at end of file
@@ -1,5 +1,9 @@
 #include "descriptors.h"
 
+#include <algorithm>
+
+#include "../../shared/profiler.h"
+
 namespace yib {
 	DescriptorSetLayout::Builder::Builder(Device& device) : device(device) { }
 
@@ -33,7 +37,7 @@ namespace yib {
 	DescriptorSetLayout::DescriptorSetLayout(
 		Device& device,
 		std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings
-	) : device(device), bindings(bindings), success(success) {
+	) : device(device), bindings(bindings), success(false) {
 		std::vector<VkDescriptorSetLayoutBinding> set_layout_bindings = { };
 
 		for (std::pair<uint32_t, VkDescriptorSetLayoutBinding> binding : bindings) {
@@ -55,10 +59,22 @@ namespace yib {
 			return;
 		}
 
+		if (!CreateUpdateTemplate()) {
+			return;
+		}
+
 		this->success = true;
 	}
 
 	DescriptorSetLayout::~DescriptorSetLayout() {
+		if (this->update_template != VK_NULL_HANDLE) {
+			vkDestroyDescriptorUpdateTemplate(
+				this->device.GetDevice(),
+				this->update_template,
+				nullptr
+			);
+		}
+
 		vkDestroyDescriptorSetLayout(
 			this->device.GetDevice(),
 			this->desciptor_set_layout,
@@ -70,6 +86,56 @@ namespace yib {
 		return this->desciptor_set_layout;
 	}
 
+	bool DescriptorSetLayout::CreateUpdateTemplate() {
+		if (this->device.GetPhysicalDeviceProperties().apiVersion < VK_API_VERSION_1_1) {
+			return true;
+		}
+
+		for (const std::pair<const uint32_t, VkDescriptorSetLayoutBinding>& binding : this->bindings) {
+			if (binding.second.descriptorCount != 1) {
+				return true;
+			}
+
+			this->template_bindings.push_back(binding.first);
+		}
+
+		std::sort(this->template_bindings.begin(), this->template_bindings.end());
+
+		std::vector<VkDescriptorUpdateTemplateEntry> entries = {};
+
+		for (size_t i = 0; i < this->template_bindings.size(); i++) {
+			VkDescriptorUpdateTemplateEntry entry = { };
+
+			entry.dstBinding = this->template_bindings.at(i);
+			entry.dstArrayElement = 0;
+			entry.descriptorCount = 1;
+			entry.descriptorType = this->bindings.at(entry.dstBinding).descriptorType;
+			entry.offset = sizeof(TemplateData) * i;
+			entry.stride = sizeof(TemplateData);
+
+			entries.push_back(entry);
+		}
+
+		VkDescriptorUpdateTemplateCreateInfo create_info = { };
+
+		create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+		create_info.descriptorUpdateEntryCount = entries.size();
+		create_info.pDescriptorUpdateEntries = entries.data();
+		create_info.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+		create_info.descriptorSetLayout = this->desciptor_set_layout;
+
+		if (vkCreateDescriptorUpdateTemplate(
+			this->device.GetDevice(),
+			&create_info,
+			nullptr,
+			&this->update_template
+		) != VK_SUCCESS) {
+			return false;
+		}
+
+		return true;
+	}
+
 
 	DescriptorPool::Builder::Builder(Device& device) : device(device) { }
 
@@ -169,10 +235,266 @@ namespace yib {
 	}
 
 
+	DescriptorAllocator::DescriptorAllocator(
+		Device& device,
+		uint32_t sets_per_pool,
+		const std::vector<PoolRatio>& ratios
+	) :
+		device(device),
+		sets_per_pool(sets_per_pool),
+		ratios(ratios),
+		success(false)
+	{
+		std::optional<VkDescriptorPool> pool = GetPool();
+		if (!pool.has_value()) {
+			return;
+		}
+
+		this->current_pool = pool.value();
+		this->used_pools.push_back(this->current_pool);
+
+		this->success = true;
+	}
+
+	DescriptorAllocator::~DescriptorAllocator() {
+		for (VkDescriptorPool pool : this->used_pools) {
+			vkDestroyDescriptorPool(
+				this->device.GetDevice(),
+				pool,
+				nullptr
+			);
+		}
+
+		for (VkDescriptorPool pool : this->free_pools) {
+			vkDestroyDescriptorPool(
+				this->device.GetDevice(),
+				pool,
+				nullptr
+			);
+		}
+	}
+
+	bool DescriptorAllocator::Allocate(
+		const VkDescriptorSetLayout descriptor_set_layout,
+		VkDescriptorSet& descriptor
+	) {
+		VkDescriptorSetAllocateInfo allocate_info = { };
+
+		allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocate_info.descriptorPool = this->current_pool;
+		allocate_info.pSetLayouts = &descriptor_set_layout;
+		allocate_info.descriptorSetCount = 1;
+
+		VkResult result = vkAllocateDescriptorSets(
+			this->device.GetDevice(),
+			&allocate_info,
+			&descriptor
+		);
+		if (result == VK_SUCCESS) {
+			return true;
+		}
+
+		if (
+			result != VK_ERROR_OUT_OF_POOL_MEMORY &&
+			result != VK_ERROR_FRAGMENTED_POOL
+		) {
+			return false;
+		}
+
+		// Chain a new pool, a set that doesn't fit a fresh pool never will.
+		std::optional<VkDescriptorPool> pool = GetPool();
+		if (!pool.has_value()) {
+			return false;
+		}
+
+		this->current_pool = pool.value();
+		this->used_pools.push_back(this->current_pool);
+
+		allocate_info.descriptorPool = this->current_pool;
+
+		if (vkAllocateDescriptorSets(
+			this->device.GetDevice(),
+			&allocate_info,
+			&descriptor
+		) != VK_SUCCESS) {
+			return false;
+		}
+
+		return true;
+	}
+
+	void DescriptorAllocator::Reset() {
+		for (VkDescriptorPool pool : this->used_pools) {
+			vkResetDescriptorPool(
+				this->device.GetDevice(),
+				pool,
+				0
+			);
+		}
+
+		// Keep filling the first pool, the rest wait until it runs out.
+		this->free_pools.insert(
+			this->free_pools.end(),
+			this->used_pools.begin() + 1,
+			this->used_pools.end()
+		);
+		this->used_pools.resize(1);
+
+		this->current_pool = this->used_pools.front();
+	}
+
+	uint32_t DescriptorAllocator::GetPoolCount() const {
+		return this->used_pools.size() + this->free_pools.size();
+	}
+
+	std::vector<DescriptorAllocator::PoolRatio> DescriptorAllocator::GetDefaultRatios() {
+		return {
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f },
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.0f },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0.5f }
+		};
+	}
+
+	std::optional<VkDescriptorPool> DescriptorAllocator::GetPool() {
+		if (!this->free_pools.empty()) {
+			VkDescriptorPool pool = this->free_pools.back();
+			this->free_pools.pop_back();
+
+			return pool;
+		}
+
+		// Every new pool doubles in size, so a growing workload settles on
+		// a handful of pools.
+		uint32_t max_sets = this->sets_per_pool << std::min<size_t>(this->used_pools.size(), 6);
+
+		return CreatePool(max_sets);
+	}
+
+	std::optional<VkDescriptorPool> DescriptorAllocator::CreatePool(uint32_t max_sets) {
+		std::vector<VkDescriptorPoolSize> sizes = {};
+
+		for (const PoolRatio& ratio : this->ratios) {
+			sizes.push_back({
+				ratio.descriptor_type,
+				std::max<uint32_t>(ratio.ratio * max_sets, 1)
+			});
+		}
+
+		VkDescriptorPoolCreateInfo create_info = { };
+
+		create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		create_info.poolSizeCount = sizes.size();
+		create_info.pPoolSizes = sizes.data();
+		create_info.maxSets = max_sets;
+
+		VkDescriptorPool pool = VK_NULL_HANDLE;
+
+		if (vkCreateDescriptorPool(
+			this->device.GetDevice(),
+			&create_info,
+			nullptr,
+			&pool
+		) != VK_SUCCESS) {
+			return std::nullopt;
+		}
+
+		return pool;
+	}
+
+
+	DescriptorCache::DescriptorCache(
+		Device& device,
+		uint32_t sets_per_pool
+	) :
+		allocator(device, sets_per_pool),
+		success(false)
+	{
+		if (!this->allocator.success) {
+			return;
+		}
+
+		this->success = true;
+	}
+
+	bool DescriptorCache::Find(
+		const Key& key,
+		VkDescriptorSet& descriptor
+	) {
+		std::unordered_map<Key, VkDescriptorSet, KeyHash>::iterator it = this->sets.find(key);
+		if (it == this->sets.end()) {
+			this->miss_count++;
+			YIB_PROFILE_COUNTER("Descriptor cache misses", this->miss_count);
+
+			return false;
+		}
+
+		this->hit_count++;
+		YIB_PROFILE_COUNTER("Descriptor cache hits", this->hit_count);
+
+		descriptor = it->second;
+
+		return true;
+	}
+
+	bool DescriptorCache::Allocate(
+		const VkDescriptorSetLayout descriptor_set_layout,
+		VkDescriptorSet& descriptor
+	) {
+		return this->allocator.Allocate(
+			descriptor_set_layout,
+			descriptor
+		);
+	}
+
+	void DescriptorCache::Insert(
+		Key key,
+		VkDescriptorSet descriptor
+	) {
+		this->sets[std::move(key)] = descriptor;
+	}
+
+	void DescriptorCache::Clear() {
+		this->sets.clear();
+		this->allocator.Reset();
+	}
+
+	uint64_t DescriptorCache::GetHitCount() const {
+		return this->hit_count;
+	}
+
+	uint64_t DescriptorCache::GetMissCount() const {
+		return this->miss_count;
+	}
+
+	size_t DescriptorCache::KeyHash::operator()(const Key& key) const {
+		// FNV-1a over every word.
+		uint64_t hash = 14695981039346656037ull;
+
+		for (uint64_t word : key) {
+			hash ^= word;
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+
 	DescriptorWriter::DescriptorWriter(
 		DescriptorSetLayout& set_layout,
 		DescriptorPool& pool
-	) : set_layout(set_layout), pool(pool) { }
+	) : set_layout(set_layout), pool(&pool) { }
+
+	DescriptorWriter::DescriptorWriter(
+		DescriptorSetLayout& set_layout,
+		DescriptorAllocator& allocator
+	) : set_layout(set_layout), allocator(&allocator) { }
+
+	DescriptorWriter::DescriptorWriter(
+		DescriptorSetLayout& set_layout,
+		DescriptorCache& cache
+	) : set_layout(set_layout), cache(&cache) { }
 
 	bool DescriptorWriter::WriteBuffer(
 		uint32_t binding,
@@ -229,10 +551,28 @@ namespace yib {
 	}
 
 	bool DescriptorWriter::Build(VkDescriptorSet& set) {
-		if (!this->pool.AllocateDescriptor(
-			this->set_layout.GetDescriptorSetLayout(),
-			set
-		)) {
+		if (this->cache != nullptr) {
+			DescriptorCache::Key key = GetCacheKey();
+
+			if (this->cache->Find(key, set)) {
+				return true;
+			}
+
+			if (!this->cache->Allocate(this->set_layout.GetDescriptorSetLayout(), set)) {
+				return false;
+			}
+
+			Overwrite(set);
+
+			this->cache->Insert(std::move(key), set);
+
+			return true;
+		}
+
+		bool allocated = this->allocator != nullptr ?
+			this->allocator->Allocate(this->set_layout.GetDescriptorSetLayout(), set) :
+			this->pool->AllocateDescriptor(this->set_layout.GetDescriptorSetLayout(), set);
+		if (!allocated) {
 			return false;
 		}
 
@@ -242,16 +582,107 @@ namespace yib {
 	}
 
 	void DescriptorWriter::Overwrite(VkDescriptorSet& set) {
+		if (WriteWithTemplate(set)) {
+			return;
+		}
+
 		for (VkWriteDescriptorSet& write : this->writes) {
 			write.dstSet = set;
 		}
 
 		vkUpdateDescriptorSets(
-			this->pool.device.GetDevice(),
+			this->set_layout.device.GetDevice(),
 			this->writes.size(),
 			this->writes.data(),
 			0,
 			nullptr
 		);
 	}
+
+
+	DescriptorCache::Key DescriptorWriter::GetCacheKey() const {
+		std::vector<const VkWriteDescriptorSet*> sorted_writes = {};
+
+		for (const VkWriteDescriptorSet& write : this->writes) {
+			sorted_writes.push_back(&write);
+		}
+
+		std::sort(
+			sorted_writes.begin(),
+			sorted_writes.end(),
+			[](const VkWriteDescriptorSet* a, const VkWriteDescriptorSet* b) {
+				return a->dstBinding < b->dstBinding;
+			}
+		);
+
+		DescriptorCache::Key key = {
+			reinterpret_cast<uint64_t>(this->set_layout.GetDescriptorSetLayout())
+		};
+
+		for (const VkWriteDescriptorSet* write : sorted_writes) {
+			key.push_back(write->dstBinding);
+			key.push_back(write->descriptorType);
+
+			if (write->pBufferInfo != nullptr) {
+				key.push_back(reinterpret_cast<uint64_t>(write->pBufferInfo->buffer));
+				key.push_back(write->pBufferInfo->offset);
+				key.push_back(write->pBufferInfo->range);
+			} else {
+				key.push_back(reinterpret_cast<uint64_t>(write->pImageInfo->sampler));
+				key.push_back(reinterpret_cast<uint64_t>(write->pImageInfo->imageView));
+				key.push_back(write->pImageInfo->imageLayout);
+			}
+		}
+
+		return key;
+	}
+
+	bool DescriptorWriter::WriteWithTemplate(VkDescriptorSet set) const {
+		const std::vector<uint32_t>& template_bindings = this->set_layout.template_bindings;
+
+		// A template writes every binding, partial updates take the
+		// regular path.
+		if (
+			this->set_layout.update_template == VK_NULL_HANDLE ||
+			this->writes.size() != template_bindings.size()
+		) {
+			return false;
+		}
+
+		std::vector<DescriptorSetLayout::TemplateData> data(template_bindings.size());
+		std::vector<bool> written(template_bindings.size(), false);
+
+		for (const VkWriteDescriptorSet& write : this->writes) {
+			std::vector<uint32_t>::const_iterator it = std::lower_bound(
+				template_bindings.begin(),
+				template_bindings.end(),
+				write.dstBinding
+			);
+			if (it == template_bindings.end() || *it != write.dstBinding) {
+				return false;
+			}
+
+			size_t index = it - template_bindings.begin();
+			if (written.at(index)) {
+				return false;
+			}
+
+			written.at(index) = true;
+
+			if (write.pBufferInfo != nullptr) {
+				data.at(index).buffer_info = *write.pBufferInfo;
+			} else {
+				data.at(index).image_info = *write.pImageInfo;
+			}
+		}
+
+		vkUpdateDescriptorSetWithTemplate(
+			this->set_layout.device.GetDevice(),
+			set,
+			this->set_layout.update_template,
+			data.data()
+		);
+
+		return true;
+	}
 }
\ No newline at end of file
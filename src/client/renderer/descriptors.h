@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <vector>
+#include <optional>
 #include <unordered_map>
 
 #include <vulkan/vulkan.h>
@@ -40,10 +41,22 @@ namespace yib {
 
 		bool success;
 	private:
+		// One entry per binding in the data passed to the update template.
+		union TemplateData {
+			VkDescriptorImageInfo image_info;
+			VkDescriptorBufferInfo buffer_info;
+		};
+
+		bool CreateUpdateTemplate();
+
 		Device& device;
 		VkDescriptorSetLayout desciptor_set_layout;
 		std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings;
 
+		// Null when a binding holds an array or the device lacks Vulkan 1.1.
+		VkDescriptorUpdateTemplate update_template = VK_NULL_HANDLE;
+		std::vector<uint32_t> template_bindings = {};
+
 		friend class DescriptorWriter;
 	};
 
@@ -93,12 +106,115 @@ namespace yib {
 		friend class DescriptorWriter;
 	};
 
+	// Hands out descriptor sets from a chain of pools, a new pool is created
+	// whenever the current one runs out. Sets are never freed one by one,
+	// only every set at once through Reset.
+	class DescriptorAllocator {
+	public:
+		struct PoolRatio {
+			VkDescriptorType descriptor_type;
+			// Descriptors of this type per set.
+			float ratio;
+		};
+
+		DescriptorAllocator(
+			Device& device,
+			uint32_t sets_per_pool = 64,
+			const std::vector<PoolRatio>& ratios = GetDefaultRatios()
+		);
+		~DescriptorAllocator();
+
+		DescriptorAllocator(const DescriptorAllocator&) = delete;
+		DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+		bool Allocate(
+			const VkDescriptorSetLayout descriptor_set_layout,
+			VkDescriptorSet& descriptor
+		);
+
+		// Every set allocated so far becomes invalid, the pools are kept.
+		void Reset();
+
+		uint32_t GetPoolCount() const;
+
+		static std::vector<PoolRatio> GetDefaultRatios();
+
+		bool success;
+	private:
+		std::optional<VkDescriptorPool> GetPool();
+		std::optional<VkDescriptorPool> CreatePool(uint32_t max_sets);
+
+		Device& device;
+		uint32_t sets_per_pool;
+		std::vector<PoolRatio> ratios;
+
+		VkDescriptorPool current_pool = VK_NULL_HANDLE;
+		std::vector<VkDescriptorPool> used_pools = {};
+		std::vector<VkDescriptorPool> free_pools = {};
+	};
+
+	// Reuses sets built from the same layout and resources. A cached set
+	// keeps pointing at its resources, so the cache has to be cleared once
+	// one of them is destroyed and no frame in flight uses the sets anymore.
+	class DescriptorCache {
+	public:
+		typedef std::vector<uint64_t> Key;
+
+		DescriptorCache(
+			Device& device,
+			uint32_t sets_per_pool = 64
+		);
+
+		DescriptorCache(const DescriptorCache&) = delete;
+		DescriptorCache& operator=(const DescriptorCache&) = delete;
+
+		bool Find(
+			const Key& key,
+			VkDescriptorSet& descriptor
+		);
+		bool Allocate(
+			const VkDescriptorSetLayout descriptor_set_layout,
+			VkDescriptorSet& descriptor
+		);
+		void Insert(
+			Key key,
+			VkDescriptorSet descriptor
+		);
+
+		void Clear();
+
+		uint64_t GetHitCount() const;
+		uint64_t GetMissCount() const;
+
+		bool success;
+	private:
+		struct KeyHash {
+			size_t operator()(const Key& key) const;
+		};
+
+		DescriptorAllocator allocator;
+		std::unordered_map<Key, VkDescriptorSet, KeyHash> sets = {};
+
+		uint64_t hit_count = 0;
+		uint64_t miss_count = 0;
+	};
+
 	class DescriptorWriter {
 	public:
 		DescriptorWriter(
 			DescriptorSetLayout& set_layout,
 			DescriptorPool& pool
 		);
+		DescriptorWriter(
+			DescriptorSetLayout& set_layout,
+			DescriptorAllocator& allocator
+		);
+		// Build returns a cached set when one was built from the same
+		// resources before.
+		DescriptorWriter(
+			DescriptorSetLayout& set_layout,
+			DescriptorCache& cache
+		);
 
 		bool WriteBuffer(
 			uint32_t binding,
@@ -112,7 +228,12 @@ namespace yib {
 		bool Build(VkDescriptorSet& set);
 		void Overwrite(VkDescriptorSet& set);
 	private:
-		DescriptorPool& pool;
+		DescriptorCache::Key GetCacheKey() const;
+		bool WriteWithTemplate(VkDescriptorSet set) const;
+
+		DescriptorPool* pool = nullptr;
+		DescriptorAllocator* allocator = nullptr;
+		DescriptorCache* cache = nullptr;
 		DescriptorSetLayout& set_layout;
 		std::vector<VkWriteDescriptorSet> writes;
 	};
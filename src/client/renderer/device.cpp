@@ -1,5 +1,10 @@
 #include "device.h"
 
+#include "uploader.h"
+#include "frame_sync.h"
+#include "bindless_textures.h"
+#include "../../shared/file.h"
+
 static const char* GetSeverityString(VkDebugUtilsMessageSeverityFlagBitsEXT severity) {
 	switch (severity) {
 	case VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT:
@@ -72,15 +77,41 @@ namespace yib {
 			return;
 		}
 
+		if (!CreateAllocator()) {
+			return;
+		}
+
 		if (!CreateCommandPool()) {
 			return;
 		}
 
+		if (!CreateTransferCommandPool()) {
+			return;
+		}
+
+		if (!CreateUploader()) {
+			return;
+		}
+
+		if (!CreateBindlessTextures()) {
+			return;
+		}
+
+		if (!CreatePipelineCache()) {
+			return;
+		}
+
 		this->success = true;
 	}
 
 	Device::~Device() {
+		DestroyRetiredImages(true);
+		DestroyPipelineCache();
+		DestroyBindlessTextures();
+		DestroyUploader();
+		DestroyTransferCommandPool();
 		DestroyCommandPool();
+		DestroyAllocator();
 		DestroyLogicalDevice();
 		DestorySurface();
 
@@ -92,6 +123,10 @@ namespace yib {
 	}
 
 
+	bool Device::IsHeadless() const {
+		return this->window == nullptr;
+	}
+
 	VkDevice Device::GetDevice() const {
 		return this->device;
 	}
@@ -108,10 +143,22 @@ namespace yib {
 		return this->graphics_queue;
 	}
 
+	VkQueue Device::GetTransferQueue() const {
+		return this->transfer_queue;
+	}
+
 	VkCommandPool Device::GetCommandPool() const {
 		return this->command_pool;
 	}
 
+	VkCommandPool Device::GetTransferCommandPool() const {
+		return this->transfer_command_pool;
+	}
+
+	bool Device::HasTransferQueue() const {
+		return this->transfer_queue != VK_NULL_HANDLE;
+	}
+
 	VkPhysicalDevice Device::GetPhysicalDevice() const {
 		return this->physical_device;
 	}
@@ -123,6 +170,128 @@ namespace yib {
 		return propeties;
 	}
 
+	Allocator& Device::GetAllocator() const {
+		return *this->allocator;
+	}
+
+	Uploader& Device::GetUploader() const {
+		return *this->uploader;
+	}
+
+	VkPipelineCache Device::GetPipelineCache() const {
+		return this->pipeline_cache;
+	}
+
+	PipelineCacheStats Device::GetPipelineCacheStats() const {
+		PipelineCacheStats stats = {};
+
+		stats.pipeline_count = this->pipeline_count;
+		stats.creation_time = this->pipeline_creation_time / 1000.0;
+		stats.loaded_size = this->pipeline_cache_loaded_size;
+
+		vkGetPipelineCacheData(
+			this->device,
+			this->pipeline_cache,
+			&stats.size,
+			nullptr
+		);
+
+		return stats;
+	}
+
+	void Device::RecordPipelineCreation(double milliseconds) {
+		this->pipeline_count++;
+		this->pipeline_creation_time += static_cast<uint64_t>(milliseconds * 1000.0);
+	}
+
+	bool Device::SupportsTimelineSemaphores() const {
+		return this->timeline_semaphores;
+	}
+
+	bool Device::SupportsDescriptorIndexing() const {
+		return this->descriptor_indexing;
+	}
+
+	bool Device::SupportsMultiDrawIndirect() const {
+		return this->multi_draw_indirect;
+	}
+
+	BindlessTextures* Device::GetBindlessTextures() const {
+		return this->bindless_textures.get();
+	}
+
+	void Device::SetFrameSync(FrameSync* frame_sync) {
+		if (this->bindless_textures != nullptr) {
+			this->bindless_textures->SetFrameSync(frame_sync);
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(this->retired_mutex);
+
+			this->frame_sync = frame_sync;
+		}
+
+		DestroyRetiredImages(false);
+	}
+
+	void Device::RetireImage(
+		VkImage image,
+		Allocation allocation,
+		VkImageView view,
+		VkSampler sampler
+	) {
+		{
+			std::unique_lock<std::mutex> lock(this->retired_mutex);
+
+			RetiredImage retired = {};
+
+			retired.image = image;
+			retired.allocation = allocation;
+			retired.view = view;
+			retired.sampler = sampler;
+			retired.frame = this->frame_sync != nullptr ? this->frame_sync->GetSubmittedFrame() : 0;
+
+			this->retired_images.push_back(retired);
+		}
+
+		DestroyRetiredImages(false);
+	}
+
+	void Device::DestroyRetiredImages(bool wait) {
+		std::unique_lock<std::mutex> lock(this->retired_mutex);
+
+		std::vector<RetiredImage>::iterator it = this->retired_images.begin();
+
+		while (it != this->retired_images.end()) {
+			if (!wait && this->frame_sync != nullptr && !this->frame_sync->IsFrameComplete(it->frame)) {
+				it++;
+				continue;
+			}
+
+			vkDestroySampler(
+				this->device,
+				it->sampler,
+				nullptr
+			);
+
+			vkDestroyImageView(
+				this->device,
+				it->view,
+				nullptr
+			);
+
+			vkDestroyImage(
+				this->device,
+				it->image,
+				nullptr
+			);
+
+			this->allocator->Free(it->allocation);
+
+			it = this->retired_images.erase(it);
+		}
+	}
+
 
 	std::optional<uint32_t> Device::FindMemoryType(
 		uint32_t type_filter,
@@ -175,7 +344,7 @@ namespace yib {
 	bool Device::CreateImageWithInfo(
 		const VkImageCreateInfo& image_info,
 		VkMemoryPropertyFlags properties,
-		VkDeviceMemory& image_memory,
+		Allocation& image_allocation,
 		VkImage& image
 	) const {
 		if (vkCreateImage(
@@ -202,26 +371,20 @@ namespace yib {
 			return false;
 		}
 
-		VkMemoryAllocateInfo allocation_info{};
-
-		allocation_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocation_info.allocationSize = memory_requirements.size;
-		allocation_info.memoryTypeIndex = memory_type_index.value();
-
-		if (vkAllocateMemory(
-			this->device,
-			&allocation_info,
-			nullptr,
-			&image_memory
-		) != VK_SUCCESS) {
+		if (!this->allocator->Allocate(
+			memory_requirements,
+			memory_type_index.value(),
+			image_info.tiling == VK_IMAGE_TILING_LINEAR,
+			image_allocation
+		)) {
 			return false;
 		}
 
 		if (vkBindImageMemory(
 			this->device,
 			image,
-			image_memory,
-			NULL
+			image_allocation.memory,
+			image_allocation.offset
 		) != VK_SUCCESS) {
 			return false;
 		}
@@ -229,54 +392,12 @@ namespace yib {
 		return true;
 	}
 
-	bool Device::CopyBufferToImage(
-		VkBuffer buffer,
-		VkImage image,
-		uint32_t width,
-		uint32_t height,
-		uint32_t layer_count
-	) {
-		VkCommandBuffer command_buffer = BeginSingleTimeCommands();
-		if (command_buffer == VK_NULL_HANDLE) {
-			return false;
-		}
-
-		VkBufferImageCopy region{};
-
-		region.bufferOffset = 0;
-		region.bufferRowLength = 0;
-		region.bufferImageHeight = 0;
-
-		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		region.imageSubresource.mipLevel = 0;
-		region.imageSubresource.baseArrayLayer = 0;
-		region.imageSubresource.layerCount = layer_count;
-
-		region.imageOffset = { 0, 0, 0 };
-		region.imageExtent = { width, height, 1 };
-
-		vkCmdCopyBufferToImage(
-			command_buffer,
-			buffer,
-			image,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			1,
-			&region
-		);
-
-		if (!EndSingleTimeCommands(command_buffer)) {
-			return false;
-		}
-
-		return true;
-	}
-
 	bool Device::CreateBuffer(
 		VkDeviceSize size,
 		VkBufferUsageFlags usage,
 		VkMemoryPropertyFlags properties,
 		VkBuffer& buffer,
-		VkDeviceMemory& buffer_memory
+		Allocation& buffer_allocation
 	) {
 		VkBufferCreateInfo buffer_info = {};
 
@@ -306,26 +427,20 @@ namespace yib {
 			return false;
 		}
 
-		VkMemoryAllocateInfo allocation_info = {};
-
-		allocation_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocation_info.allocationSize = memory_requirements.size;
-		allocation_info.memoryTypeIndex = memory_type.value();
-
-		if (vkAllocateMemory(
-			this->device,
-			&allocation_info,
-			nullptr,
-			&buffer_memory
-		) != VK_SUCCESS) {
+		if (!this->allocator->Allocate(
+			memory_requirements,
+			memory_type.value(),
+			true,
+			buffer_allocation
+		)) {
 			return false;
 		}
 
 		if (vkBindBufferMemory(
 			this->device,
 			buffer,
-			buffer_memory,
-			0
+			buffer_allocation.memory,
+			buffer_allocation.offset
 		) != VK_SUCCESS) {
 			return false;
 		}
@@ -333,35 +448,6 @@ namespace yib {
 		return true;
 	}
 
-	bool Device::CopyBuffer(
-		VkBuffer source,
-		VkBuffer destination,
-		VkDeviceSize size
-	) {
-		VkCommandBuffer command_buffer = BeginSingleTimeCommands();
-		if (command_buffer == VK_NULL_HANDLE) {
-			return false;
-		}
-
-		VkBufferCopy copy_region = {};
-
-		copy_region.size = size;
-		copy_region.srcOffset = 0;
-		copy_region.dstOffset = 0;
-
-		vkCmdCopyBuffer(
-			command_buffer,
-			source,
-			destination,
-			1,
-			&copy_region
-		);
-
-		EndSingleTimeCommands(command_buffer);
-
-		return true;
-	}
-
 	VkCommandBuffer Device::BeginSingleTimeCommands() const {
 		VkCommandBufferAllocateInfo allocation_info = {};
 
@@ -431,27 +517,36 @@ namespace yib {
 		VkPhysicalDeviceProperties propeties;
 		vkGetPhysicalDeviceProperties(device, &propeties);
 
-		if (propeties.deviceType != VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
+		if (
+			!IsHeadless() &&
+			propeties.deviceType != VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU
+		) {
 			return false;
 		}
 
 		QueueFamiliyIndices indices = GetFamilyIndices(device);
-		if (!indices.graphics || !indices.present) {
+		if (!indices.graphics) {
 			return false;
 		}
 
-		if (!SupportsRequiredExtentions(device)) {
+		if (!IsHeadless() && !indices.present) {
 			return false;
 		}
 
-		SwapChainSupport swapchain_support = GetSwapChainSupport(device);
-		if (
-			swapchain_support.formats.empty() ||
-			swapchain_support.present_modes.empty()
-			) {
+		if (!SupportsRequiredExtentions(device)) {
 			return false;
 		}
 
+		if (!IsHeadless()) {
+			SwapChainSupport swapchain_support = GetSwapChainSupport(device);
+			if (
+				swapchain_support.formats.empty() ||
+				swapchain_support.present_modes.empty()
+				) {
+				return false;
+			}
+		}
+
 		VkPhysicalDeviceFeatures supported_features;
 		vkGetPhysicalDeviceFeatures(device, &supported_features);
 		if (supported_features.samplerAnisotropy == VK_FALSE) {
@@ -470,7 +565,7 @@ namespace yib {
 			nullptr
 		);
 		if (extension_count == 0) {
-			return false;
+			return GetDeviceExtentions().empty();
 		}
 
 		std::vector<VkExtensionProperties> available_extension_properties(extension_count);
@@ -495,7 +590,7 @@ namespace yib {
 			avail_extentions.push_back(extention_name);
 		}
 
-		for (const char* required_extention : device_extensions) {
+		for (const char* required_extention : GetDeviceExtentions()) {
 			bool found = false;
 
 			for (const char* avail_extention : avail_extentions) {
@@ -538,7 +633,7 @@ namespace yib {
 				}
 			}
 
-			if (!indices.present) {
+			if (!indices.present && this->surface != VK_NULL_HANDLE) {
 				VkBool32 present_support = false;
 				vkGetPhysicalDeviceSurfaceSupportKHR(
 					device,
@@ -553,8 +648,17 @@ namespace yib {
 				}
 			}
 
-			if (indices.graphics && indices.present) {
-				break;
+			// Only families without graphics count as a transfer queue, ones
+			// without compute as well are preferred since those are usually
+			// backed by a dedicated copy engine.
+			if (
+				(queue_family.queueFlags & (VK_QUEUE_TRANSFER_BIT | VK_QUEUE_COMPUTE_BIT)) &&
+				!(queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+			) {
+				if (!indices.transfer || !(queue_family.queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+					indices.transfer_index = i;
+					indices.transfer = true;
+				}
 			}
 		}
 
@@ -613,7 +717,7 @@ namespace yib {
 		VkApplicationInfo app_info = {};
 		
 		app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-		app_info.apiVersion = VK_API_VERSION_1_0;
+		app_info.apiVersion = VK_API_VERSION_1_2;
 
 		app_info.pApplicationName = this->name.c_str();
 		app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
@@ -729,6 +833,10 @@ namespace yib {
 
 
 	bool Device::CreateSurface() {
+		if (IsHeadless()) {
+			return true;
+		}
+
 		if (glfwCreateWindowSurface(
 			this->instance,
 			this->window->GetInternal(),
@@ -800,11 +908,18 @@ namespace yib {
 		QueueFamiliyIndices indices = GetFamilyIndices(this->physical_device);
 
 		std::vector<VkDeviceQueueCreateInfo> queue_create_infos = {};
-		std::vector<uint32_t> unique_queue_families = {
-			indices.graphics_index,
-			indices.present
+		std::set<uint32_t> unique_queue_families = {
+			indices.graphics_index
 		};
 
+		if (indices.present) {
+			unique_queue_families.insert(indices.present_index);
+		}
+
+		if (indices.transfer) {
+			unique_queue_families.insert(indices.transfer_index);
+		}
+
 		float queue_priority = 0.0f;
 		for (uint32_t queue_family : unique_queue_families) {
 			VkDeviceQueueCreateInfo queue_create_info = {};
@@ -817,18 +932,71 @@ namespace yib {
 			queue_create_infos.push_back(queue_create_info);
 		}
 
+		VkPhysicalDeviceFeatures supported_features_10;
+		vkGetPhysicalDeviceFeatures(this->physical_device, &supported_features_10);
+
 		VkPhysicalDeviceFeatures device_features = {};
 		device_features.samplerAnisotropy = VK_TRUE;
 
+		bool multi_draw_indirect =
+			supported_features_10.multiDrawIndirect == VK_TRUE &&
+			supported_features_10.drawIndirectFirstInstance == VK_TRUE;
+
+		if (multi_draw_indirect) {
+			device_features.multiDrawIndirect = VK_TRUE;
+			device_features.drawIndirectFirstInstance = VK_TRUE;
+		}
+
+		// Timeline semaphores and descriptor indexing are core in 1.2, older
+		// devices keep using fences and regular descriptor sets.
+		VkPhysicalDeviceVulkan12Features supported_features_12 = {};
+		supported_features_12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+		if (GetPhysicalDeviceProperties().apiVersion >= VK_API_VERSION_1_2) {
+			VkPhysicalDeviceFeatures2 supported_features = {};
+			supported_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			supported_features.pNext = &supported_features_12;
+
+			vkGetPhysicalDeviceFeatures2(
+				this->physical_device,
+				&supported_features
+			);
+		}
+
+		VkPhysicalDeviceVulkan12Features device_features_12 = {};
+		device_features_12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		device_features_12.timelineSemaphore = supported_features_12.timelineSemaphore;
+
+		bool descriptor_indexing =
+			supported_features_12.runtimeDescriptorArray == VK_TRUE &&
+			supported_features_12.descriptorBindingPartiallyBound == VK_TRUE &&
+			supported_features_12.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE &&
+			supported_features_12.descriptorBindingUpdateUnusedWhilePending == VK_TRUE &&
+			supported_features_12.shaderSampledImageArrayNonUniformIndexing == VK_TRUE;
+
+		if (descriptor_indexing) {
+			device_features_12.runtimeDescriptorArray = VK_TRUE;
+			device_features_12.descriptorBindingPartiallyBound = VK_TRUE;
+			device_features_12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+			device_features_12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+			device_features_12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+		}
+
 		VkDeviceCreateInfo create_info = {};
 		create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 
+		if (device_features_12.timelineSemaphore == VK_TRUE || descriptor_indexing) {
+			create_info.pNext = &device_features_12;
+		}
+
 		create_info.queueCreateInfoCount = queue_create_infos.size();
 		create_info.pQueueCreateInfos = queue_create_infos.data();
 
 		create_info.pEnabledFeatures = &device_features;
-		create_info.enabledExtensionCount = this->device_extensions.size();
-		create_info.ppEnabledExtensionNames = this->device_extensions.data();
+		std::vector<const char*> device_extensions = GetDeviceExtentions();
+
+		create_info.enabledExtensionCount = device_extensions.size();
+		create_info.ppEnabledExtensionNames = device_extensions.data();
 
 		if (this->enable_validation_layers) {
 			create_info.enabledLayerCount = validation_layers.size();
@@ -846,6 +1014,10 @@ namespace yib {
 			return false;
 		}
 
+		this->timeline_semaphores = device_features_12.timelineSemaphore == VK_TRUE;
+		this->descriptor_indexing = descriptor_indexing;
+		this->multi_draw_indirect = multi_draw_indirect;
+
 		vkGetDeviceQueue(
 			this->device,
 			indices.graphics_index,
@@ -853,12 +1025,23 @@ namespace yib {
 			&this->graphics_queue
 		);
 
-		vkGetDeviceQueue(
-			this->device,
-			indices.present_index,
-			NULL,
-			&this->present_queue
-		);
+		if (indices.present) {
+			vkGetDeviceQueue(
+				this->device,
+				indices.present_index,
+				NULL,
+				&this->present_queue
+			);
+		}
+
+		if (indices.transfer) {
+			vkGetDeviceQueue(
+				this->device,
+				indices.transfer_index,
+				NULL,
+				&this->transfer_queue
+			);
+		}
 
 		return true;
 	}
@@ -872,6 +1055,58 @@ namespace yib {
 	}
 
 
+	bool Device::CreateTransferCommandPool() {
+		if (!HasTransferQueue()) {
+			return true;
+		}
+
+		QueueFamiliyIndices indices = GetFamilyIndices(this->physical_device);
+
+		VkCommandPoolCreateInfo pool_info = {};
+
+		pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		pool_info.queueFamilyIndex = indices.transfer_index;
+		pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+		if (vkCreateCommandPool(
+			this->device,
+			&pool_info,
+			nullptr,
+			&this->transfer_command_pool
+		) != VK_SUCCESS) {
+			return false;
+		}
+
+		return true;
+	}
+
+	void Device::DestroyTransferCommandPool() const {
+		if (this->transfer_command_pool == VK_NULL_HANDLE) {
+			return;
+		}
+
+		vkDestroyCommandPool(
+			this->device,
+			this->transfer_command_pool,
+			nullptr
+		);
+	}
+
+
+	bool Device::CreateAllocator() {
+		this->allocator = std::make_unique<Allocator>(
+			this->device,
+			this->physical_device
+		);
+
+		return true;
+	}
+
+	void Device::DestroyAllocator() {
+		this->allocator.reset();
+	}
+
+
 	bool Device::CreateCommandPool() {
 		QueueFamiliyIndices indices = GetFamilyIndices(this->physical_device);
 
@@ -906,6 +1141,135 @@ namespace yib {
 	}
 
 
+	bool Device::CreateUploader() {
+		this->uploader = std::make_unique<Uploader>(*this);
+		if (!this->uploader->success) {
+			return false;
+		}
+
+		return true;
+	}
+
+	void Device::DestroyUploader() {
+		this->uploader.reset();
+	}
+
+
+	bool Device::CreateBindlessTextures() {
+		if (!this->descriptor_indexing) {
+			return true;
+		}
+
+		this->bindless_textures = std::make_unique<BindlessTextures>(*this);
+		if (!this->bindless_textures->success) {
+			return false;
+		}
+
+		return true;
+	}
+
+	void Device::DestroyBindlessTextures() {
+		this->bindless_textures.reset();
+	}
+
+
+	bool Device::CreatePipelineCache() {
+		std::vector<char> data = File::Read(this->pipeline_cache_path.c_str());
+
+		// A cache from another driver or gpu is useless and some drivers
+		// do not reject it themselves, so it is dropped and rebuilt.
+		if (!IsPipelineCacheCompatible(data)) {
+			data.clear();
+		}
+
+		VkPipelineCacheCreateInfo create_info = {};
+
+		create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		create_info.initialDataSize = data.size();
+		create_info.pInitialData = data.empty() ? nullptr : data.data();
+
+		if (vkCreatePipelineCache(
+			this->device,
+			&create_info,
+			nullptr,
+			&this->pipeline_cache
+		) != VK_SUCCESS) {
+			return false;
+		}
+
+		this->pipeline_cache_loaded_size = data.size();
+
+		return true;
+	}
+
+	void Device::DestroyPipelineCache() const {
+		if (this->pipeline_cache == VK_NULL_HANDLE) {
+			return;
+		}
+
+		size_t size = 0;
+		if (vkGetPipelineCacheData(
+			this->device,
+			this->pipeline_cache,
+			&size,
+			nullptr
+		) == VK_SUCCESS && size > 0) {
+			std::vector<char> data(size);
+
+			if (vkGetPipelineCacheData(
+				this->device,
+				this->pipeline_cache,
+				&size,
+				data.data()
+			) == VK_SUCCESS) {
+				data.resize(size);
+				File::Write(this->pipeline_cache_path.c_str(), data);
+			}
+		}
+
+		vkDestroyPipelineCache(
+			this->device,
+			this->pipeline_cache,
+			nullptr
+		);
+	}
+
+	bool Device::IsPipelineCacheCompatible(const std::vector<char>& data) const {
+		if (data.size() < sizeof(VkPipelineCacheHeaderVersionOne)) {
+			return false;
+		}
+
+		VkPipelineCacheHeaderVersionOne header;
+		memcpy(&header, data.data(), sizeof(header));
+
+		if (
+			header.headerSize < sizeof(VkPipelineCacheHeaderVersionOne) ||
+			header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+		) {
+			return false;
+		}
+
+		VkPhysicalDeviceProperties properties = GetPhysicalDeviceProperties();
+
+		if (
+			header.vendorID != properties.vendorID ||
+			header.deviceID != properties.deviceID
+		) {
+			return false;
+		}
+
+		if (memcmp(
+			header.pipelineCacheUUID,
+			properties.pipelineCacheUUID,
+			VK_UUID_SIZE
+		) != 0) {
+			return false;
+		}
+
+		return true;
+	}
+
+
 	std::vector<const char*> Device::GetAvailExtentions() const {
 		uint32_t extension_count = 0;
 		vkEnumerateInstanceExtensionProperties(
@@ -939,13 +1303,17 @@ namespace yib {
 	}
 
 	std::vector<const char*> Device::GetRequiredExtentions() const {
-		uint32_t glfw_extention_count = 0;
-		const char** glfw_extentions = glfwGetRequiredInstanceExtensions(&glfw_extention_count);
+		std::vector<const char*> extantions = {};
 
-		std::vector<const char*> extantions = std::vector<const char*>(
-			glfw_extentions,
-			glfw_extentions + glfw_extention_count
-		);
+		if (!IsHeadless()) {
+			uint32_t glfw_extention_count = 0;
+			const char** glfw_extentions = glfwGetRequiredInstanceExtensions(&glfw_extention_count);
+
+			extantions = std::vector<const char*>(
+				glfw_extentions,
+				glfw_extentions + glfw_extention_count
+			);
+		}
 
 		if (enable_validation_layers) {
 			extantions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -953,4 +1321,14 @@ namespace yib {
 
 		return extantions;
 	}
+
+	std::vector<const char*> Device::GetDeviceExtentions() const {
+		std::vector<const char*> extentions = {};
+
+		if (!IsHeadless()) {
+			extentions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+		}
+
+		return extentions;
+	}
 }
\ No newline at end of file
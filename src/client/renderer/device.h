@@ -1,5 +1,9 @@
 #pragma once
 
+#include <set>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <cstring>
@@ -11,13 +15,29 @@
 #include <vulkan/vulkan.h>
 
 #include "window.h"
+#include "allocator.h"
 
 namespace yib {
+	class Uploader;
+	class FrameSync;
+	class BindlessTextures;
+
 	struct QueueFamiliyIndices {
 		uint32_t graphics_index = 0;
 		bool graphics = false;
 		uint32_t present_index = 0;
 		bool present = false;
+		uint32_t transfer_index = 0;
+		bool transfer = false;
+	};
+
+	struct PipelineCacheStats {
+		uint32_t pipeline_count = 0;
+		double creation_time = 0.0;
+		// A pipeline that hits the cache adds nothing to it, so a size that
+		// stays at the loaded size means every pipeline was a hit.
+		size_t loaded_size = 0;
+		size_t size = 0;
 	};
 
 	struct SwapChainSupport {
@@ -34,13 +54,45 @@ namespace yib {
 		Device(const Device&) = delete;
 		Device& operator=(const Device&) = delete;
 
+		bool IsHeadless() const;
 		VkDevice GetDevice() const;
 		VkSurfaceKHR GetSurface() const;
 		VkQueue GetPresentQueue() const;
 		VkQueue GetGraphicsQueue() const;
+		VkQueue GetTransferQueue() const;
 		VkCommandPool GetCommandPool() const;
+		VkCommandPool GetTransferCommandPool() const;
+		bool HasTransferQueue() const;
 		VkPhysicalDevice GetPhysicalDevice() const;
 		VkPhysicalDeviceProperties GetPhysicalDeviceProperties() const;
+		Allocator& GetAllocator() const;
+		Uploader& GetUploader() const;
+		VkPipelineCache GetPipelineCache() const;
+		PipelineCacheStats GetPipelineCacheStats() const;
+		// Called from pipeline compile threads too.
+		void RecordPipelineCreation(double milliseconds);
+		bool SupportsTimelineSemaphores() const;
+		bool SupportsDescriptorIndexing() const;
+		// Both multiDrawIndirect and drawIndirectFirstInstance, so one
+		// indirect call can draw several commands with their own instances.
+		bool SupportsMultiDrawIndirect() const;
+		// Null without descriptor indexing, textures then have to be bound
+		// through regular descriptor sets.
+		BindlessTextures* GetBindlessTextures() const;
+
+		// Frames are tracked by the renderer, which is created after the
+		// device. Without a frame sync nothing can be in flight, so retired
+		// resources are destroyed right away.
+		void SetFrameSync(FrameSync* frame_sync);
+		// Descriptors of frames already submitted may still reference the
+		// image, so it is only destroyed once those frames have completed.
+		void RetireImage(
+			VkImage image,
+			Allocation allocation,
+			VkImageView view,
+			VkSampler sampler
+		);
+		void DestroyRetiredImages(bool wait);
 
 		std::optional<uint32_t> FindMemoryType(
 			uint32_t type_filter,
@@ -54,27 +106,15 @@ namespace yib {
 		bool CreateImageWithInfo(
 			const VkImageCreateInfo& image_info,
 			VkMemoryPropertyFlags properties,
-			VkDeviceMemory& image_memory,
+			Allocation& image_allocation,
 			VkImage& image
 		) const;
-		bool CopyBufferToImage(
-			VkBuffer buffer,
-			VkImage image,
-			uint32_t width,
-			uint32_t height,
-			uint32_t layer_ount
-		);
 		bool CreateBuffer(
 			VkDeviceSize size,
 			VkBufferUsageFlags usage,
 			VkMemoryPropertyFlags properties,
 			VkBuffer& buffer,
-			VkDeviceMemory& buffer_memory
-		);
-		bool CopyBuffer(
-			VkBuffer source,
-			VkBuffer destination,
-			VkDeviceSize size
+			Allocation& buffer_allocation
 		);
 		VkCommandBuffer BeginSingleTimeCommands() const;
 		bool EndSingleTimeCommands(VkCommandBuffer command_buffer);
@@ -99,20 +139,43 @@ namespace yib {
 		bool CreateLogicalDevice();
 		void DestroyLogicalDevice() const;
 
+		bool CreateAllocator();
+		void DestroyAllocator();
+
+		bool CreateUploader();
+		void DestroyUploader();
+
+		bool CreateBindlessTextures();
+		void DestroyBindlessTextures();
+
+		bool CreatePipelineCache();
+		void DestroyPipelineCache() const;
+		bool IsPipelineCacheCompatible(const std::vector<char>& data) const;
+
 		bool CreateCommandPool();
 		void DestroyCommandPool() const;
 
+		bool CreateTransferCommandPool();
+		void DestroyTransferCommandPool() const;
+
+		struct RetiredImage {
+			VkImage image;
+			Allocation allocation;
+			VkImageView view;
+			VkSampler sampler;
+			uint64_t frame;
+		};
+
 		std::vector<const char*> GetAvailExtentions() const;
 		std::vector<const char*> GetRequiredExtentions() const;
+		std::vector<const char*> GetDeviceExtentions() const;
 
 		const std::string name;
 		const bool enable_validation_layers = true;
 		const std::vector<const char*> validation_layers = {
 				"VK_LAYER_KHRONOS_validation"
 		};
-		const std::vector<const char*> device_extensions = {
-			VK_KHR_SWAPCHAIN_EXTENSION_NAME
-		};
+		const std::string pipeline_cache_path = "pipeline_cache.bin";
 
 		Window* window;
 		VkDevice device = VK_NULL_HANDLE;
@@ -120,7 +183,22 @@ namespace yib {
 		VkSurfaceKHR surface = VK_NULL_HANDLE;
 		VkQueue present_queue = VK_NULL_HANDLE;
 		VkQueue graphics_queue = VK_NULL_HANDLE;
+		VkQueue transfer_queue = VK_NULL_HANDLE;
 		VkCommandPool command_pool = VK_NULL_HANDLE;
+		VkCommandPool transfer_command_pool = VK_NULL_HANDLE;
+		std::unique_ptr<Allocator> allocator = nullptr;
+		std::unique_ptr<Uploader> uploader;
+		std::unique_ptr<BindlessTextures> bindless_textures;
+		std::mutex retired_mutex;
+		std::vector<RetiredImage> retired_images = {};
+		FrameSync* frame_sync = nullptr;
+		VkPipelineCache pipeline_cache = VK_NULL_HANDLE;
+		size_t pipeline_cache_loaded_size = 0;
+		std::atomic<uint32_t> pipeline_count = 0;
+		std::atomic<uint64_t> pipeline_creation_time = 0;
+		bool timeline_semaphores = false;
+		bool descriptor_indexing = false;
+		bool multi_draw_indirect = false;
 		VkPhysicalDevice physical_device = VK_NULL_HANDLE;
 		VkDebugUtilsMessengerEXT debug_messenger = VK_NULL_HANDLE;
 	};
@@ -0,0 +1,140 @@
+#include "frame_pacer.h"
+
+#include <thread>
+#include <algorithm>
+
+#include "swapchain.h"
+
+namespace yib {
+	std::optional<VkPresentModeKHR> FramePacing::ParsePresentMode(const std::string& name) {
+		if (name == "immediate") {
+			return VK_PRESENT_MODE_IMMEDIATE_KHR;
+		}
+
+		if (name == "mailbox") {
+			return VK_PRESENT_MODE_MAILBOX_KHR;
+		}
+
+		if (name == "fifo") {
+			return VK_PRESENT_MODE_FIFO_KHR;
+		}
+
+		if (name == "fifo-relaxed") {
+			return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+		}
+
+		return std::nullopt;
+	}
+
+	const char* FramePacing::GetPresentModeName(VkPresentModeKHR present_mode) {
+		switch (present_mode) {
+		case VK_PRESENT_MODE_IMMEDIATE_KHR:
+			return "immediate";
+		case VK_PRESENT_MODE_MAILBOX_KHR:
+			return "mailbox";
+		case VK_PRESENT_MODE_FIFO_KHR:
+			return "fifo";
+		case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+			return "fifo-relaxed";
+		default:
+			return "unknown";
+		}
+	}
+
+
+	FramePacer::FramePacer(const FramePacing& pacing) :
+		pacing(pacing),
+		next_frame_time(std::chrono::steady_clock::now())
+	{
+		this->pacing.frames_in_flight = std::clamp<uint32_t>(
+			this->pacing.frames_in_flight,
+			1,
+			SwapChain::MAX_FRAMES_IN_FLIGHT
+		);
+
+		this->frame_start_times.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+	}
+
+
+	const FramePacing& FramePacer::GetPacing() const {
+		return this->pacing;
+	}
+
+	uint32_t FramePacer::GetFramesInFlight() const {
+		return this->pacing.frames_in_flight;
+	}
+
+
+	void FramePacer::Limit() {
+		if (this->pacing.frame_limit <= 0.0) {
+			return;
+		}
+
+		std::chrono::steady_clock::duration frame_time = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+			std::chrono::duration<double>(1.0 / this->pacing.frame_limit)
+		);
+
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+		// A frame that ran long moves the schedule instead of letting the
+		// following frames run unlimited to catch up.
+		this->next_frame_time = std::max(this->next_frame_time + frame_time, now);
+
+		// Sleeping overshoots by up to a scheduler tick, so the last stretch
+		// is waited out by yielding.
+		const std::chrono::milliseconds spin_time = std::chrono::milliseconds(2);
+
+		while (true) {
+			now = std::chrono::steady_clock::now();
+			if (now >= this->next_frame_time) {
+				break;
+			}
+
+			if (this->next_frame_time - now > spin_time) {
+				std::this_thread::sleep_for(this->next_frame_time - now - spin_time);
+			} else {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+
+	void FramePacer::BeginFrame(
+		uint32_t frame_index,
+		std::chrono::steady_clock::time_point start_time
+	) {
+		this->frame_start_times.at(frame_index) = start_time;
+	}
+
+	void FramePacer::CompleteFrame(uint32_t frame_index) {
+		std::optional<std::chrono::steady_clock::time_point>& start_time = this->frame_start_times.at(frame_index);
+		if (!start_time.has_value()) {
+			return;
+		}
+
+		std::chrono::duration<double, std::milli> latency = std::chrono::steady_clock::now() - start_time.value();
+
+		this->last_latency = latency.count();
+		this->total_latency += latency.count();
+		this->latency_count++;
+
+		start_time = std::nullopt;
+	}
+
+	bool FramePacer::IsFramePending(uint32_t frame_index) const {
+		return this->frame_start_times.at(frame_index).has_value();
+	}
+
+
+	std::optional<double> FramePacer::GetLastLatency() const {
+		return this->last_latency;
+	}
+
+	std::optional<double> FramePacer::GetAverageLatency() const {
+		if (this->latency_count == 0) {
+			return std::nullopt;
+		}
+
+		return this->total_latency / this->latency_count;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <optional>
+
+#include <vulkan/vulkan.h>
+
+namespace yib {
+	struct FramePacing {
+		// Clamped to SwapChain::MAX_FRAMES_IN_FLIGHT, which sizes every
+		// per-frame resource.
+		uint32_t frames_in_flight = 2;
+		// Falls back to FIFO, the only mode every device supports.
+		VkPresentModeKHR present_mode = VK_PRESENT_MODE_MAILBOX_KHR;
+		// Zero asks for one image more than the surface minimum.
+		uint32_t image_count = 0;
+		// Frames per second, zero leaves the frame rate unlimited.
+		double frame_limit = 0.0;
+
+		static std::optional<VkPresentModeKHR> ParsePresentMode(const std::string& name);
+		static const char* GetPresentModeName(VkPresentModeKHR present_mode);
+	};
+
+	// Limits the cpu frame rate and measures the time from the start of a
+	// frame on the cpu until the gpu has finished the submit that presents it.
+	class FramePacer {
+	public:
+		FramePacer(const FramePacing& pacing);
+
+		const FramePacing& GetPacing() const;
+		uint32_t GetFramesInFlight() const;
+
+		// Sleeps until the next frame is due.
+		void Limit();
+
+		void BeginFrame(
+			uint32_t frame_index,
+			std::chrono::steady_clock::time_point start_time
+		);
+		void CompleteFrame(uint32_t frame_index);
+		bool IsFramePending(uint32_t frame_index) const;
+
+		std::optional<double> GetLastLatency() const;
+		std::optional<double> GetAverageLatency() const;
+	private:
+		FramePacing pacing;
+
+		std::chrono::steady_clock::time_point next_frame_time;
+		std::vector<std::optional<std::chrono::steady_clock::time_point>> frame_start_times;
+
+		std::optional<double> last_latency = std::nullopt;
+		double total_latency = 0.0;
+		uint64_t latency_count = 0;
+	};
+}
\ No newline at end of file
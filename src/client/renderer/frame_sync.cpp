@@ -0,0 +1,283 @@
+#include "frame_sync.h"
+
+#include <limits>
+#include <algorithm>
+
+namespace yib {
+	FrameSync::FrameSync(
+		Device& device,
+		uint32_t slot_count
+	) :
+		device(device),
+		success(false)
+	{
+		this->slot_frames.resize(slot_count, 0);
+
+		if (this->device.SupportsTimelineSemaphores()) {
+			if (!CreateTimeline()) {
+				return;
+			}
+		} else {
+			if (!CreateFences()) {
+				return;
+			}
+		}
+
+		this->success = true;
+	}
+
+	FrameSync::~FrameSync() {
+		DestroySyncObjects();
+	}
+
+
+	bool FrameSync::UsesTimeline() const {
+		return this->timeline != VK_NULL_HANDLE;
+	}
+
+
+	uint64_t FrameSync::GetSubmittedFrame() const {
+		return this->submitted_frame;
+	}
+
+	uint64_t FrameSync::GetCompletedFrame() {
+		if (UsesTimeline()) {
+			uint64_t value = 0;
+
+			if (vkGetSemaphoreCounterValue(
+				this->device.GetDevice(),
+				this->timeline,
+				&value
+			) == VK_SUCCESS) {
+				this->completed_frame = std::max(this->completed_frame, value);
+			}
+
+			return this->completed_frame;
+		}
+
+		for (uint32_t slot = 0; slot < this->slot_frames.size(); slot++) {
+			if (vkGetFenceStatus(
+				this->device.GetDevice(),
+				this->fences.at(slot)
+			) == VK_SUCCESS) {
+				this->completed_frame = std::max(this->completed_frame, this->slot_frames.at(slot));
+			}
+		}
+
+		return this->completed_frame;
+	}
+
+	uint64_t FrameSync::GetSlotFrame(uint32_t slot) const {
+		return this->slot_frames.at(slot);
+	}
+
+
+	bool FrameSync::IsFrameComplete(uint64_t frame) {
+		if (frame <= this->completed_frame) {
+			return true;
+		}
+
+		return frame <= GetCompletedFrame();
+	}
+
+	bool FrameSync::WaitForFrame(uint64_t frame) {
+		if (frame <= this->completed_frame) {
+			return true;
+		}
+
+		if (UsesTimeline()) {
+			VkSemaphoreWaitInfo wait_info = {};
+
+			wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+			wait_info.semaphoreCount = 1;
+			wait_info.pSemaphores = &this->timeline;
+			wait_info.pValues = &frame;
+
+			if (vkWaitSemaphores(
+				this->device.GetDevice(),
+				&wait_info,
+				std::numeric_limits<uint64_t>::max()
+			) != VK_SUCCESS) {
+				return false;
+			}
+
+			this->completed_frame = std::max(this->completed_frame, frame);
+
+			return true;
+		}
+
+		// A slot is only reused after its previous frame finished, so a frame
+		// that no slot holds anymore is already complete.
+		for (uint32_t slot = 0; slot < this->slot_frames.size(); slot++) {
+			if (this->slot_frames.at(slot) == frame) {
+				return WaitForSlot(slot);
+			}
+		}
+
+		return true;
+	}
+
+
+	bool FrameSync::IsSlotComplete(uint32_t slot) {
+		return IsFrameComplete(this->slot_frames.at(slot));
+	}
+
+	bool FrameSync::WaitForSlot(uint32_t slot) {
+		uint64_t frame = this->slot_frames.at(slot);
+
+		if (UsesTimeline()) {
+			return WaitForFrame(frame);
+		}
+
+		if (vkWaitForFences(
+			this->device.GetDevice(),
+			1,
+			&this->fences.at(slot),
+			VK_TRUE,
+			std::numeric_limits<uint64_t>::max()
+		) != VK_SUCCESS) {
+			return false;
+		}
+
+		this->completed_frame = std::max(this->completed_frame, frame);
+
+		return true;
+	}
+
+
+	VkResult FrameSync::Submit(
+		VkQueue queue,
+		uint32_t slot,
+		VkSubmitInfo submit_info
+	) {
+		uint64_t frame = this->submitted_frame + 1;
+
+		if (UsesTimeline()) {
+			std::vector<VkSemaphore> signal_semaphores(
+				submit_info.pSignalSemaphores,
+				submit_info.pSignalSemaphores + submit_info.signalSemaphoreCount
+			);
+			signal_semaphores.push_back(this->timeline);
+
+			// Binary semaphores ignore their values, but the arrays have to
+			// match the semaphore counts.
+			std::vector<uint64_t> signal_values(signal_semaphores.size(), 0);
+			signal_values.back() = frame;
+
+			std::vector<uint64_t> wait_values(submit_info.waitSemaphoreCount, 0);
+
+			VkTimelineSemaphoreSubmitInfo timeline_info = {};
+
+			timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+			timeline_info.pNext = submit_info.pNext;
+			timeline_info.waitSemaphoreValueCount = wait_values.size();
+			timeline_info.pWaitSemaphoreValues = wait_values.data();
+			timeline_info.signalSemaphoreValueCount = signal_values.size();
+			timeline_info.pSignalSemaphoreValues = signal_values.data();
+
+			submit_info.pNext = &timeline_info;
+			submit_info.signalSemaphoreCount = signal_semaphores.size();
+			submit_info.pSignalSemaphores = signal_semaphores.data();
+
+			VkResult result = vkQueueSubmit(
+				queue,
+				1,
+				&submit_info,
+				VK_NULL_HANDLE
+			);
+			if (result != VK_SUCCESS) {
+				return result;
+			}
+		} else {
+			vkResetFences(
+				this->device.GetDevice(),
+				1,
+				&this->fences.at(slot)
+			);
+
+			VkResult result = vkQueueSubmit(
+				queue,
+				1,
+				&submit_info,
+				this->fences.at(slot)
+			);
+			if (result != VK_SUCCESS) {
+				return result;
+			}
+		}
+
+		this->submitted_frame = frame;
+		this->slot_frames.at(slot) = frame;
+
+		return VK_SUCCESS;
+	}
+
+
+	bool FrameSync::CreateTimeline() {
+		VkSemaphoreTypeCreateInfo type_info = {};
+
+		type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		type_info.initialValue = 0;
+
+		VkSemaphoreCreateInfo semaphore_info = {};
+
+		semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphore_info.pNext = &type_info;
+
+		if (vkCreateSemaphore(
+			this->device.GetDevice(),
+			&semaphore_info,
+			nullptr,
+			&this->timeline
+		) != VK_SUCCESS) {
+			return false;
+		}
+
+		return true;
+	}
+
+	bool FrameSync::CreateFences() {
+		this->fences.resize(this->slot_frames.size(), VK_NULL_HANDLE);
+
+		VkFenceCreateInfo fence_info = {};
+
+		fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+		for (VkFence& fence : this->fences) {
+			if (vkCreateFence(
+				this->device.GetDevice(),
+				&fence_info,
+				nullptr,
+				&fence
+			) != VK_SUCCESS) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void FrameSync::DestroySyncObjects() {
+		if (this->timeline != VK_NULL_HANDLE) {
+			vkDestroySemaphore(
+				this->device.GetDevice(),
+				this->timeline,
+				nullptr
+			);
+		}
+
+		for (VkFence fence : this->fences) {
+			if (fence == VK_NULL_HANDLE) {
+				continue;
+			}
+
+			vkDestroyFence(
+				this->device.GetDevice(),
+				fence,
+				nullptr
+			);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "device.h"
+
+namespace yib {
+	// Tracks a monotonically increasing frame counter for the submits made
+	// through it. With timeline semaphores every submit signals the next
+	// counter value on one semaphore, otherwise every frame slot falls back
+	// to its own fence.
+	class FrameSync {
+	public:
+		FrameSync(
+			Device& device,
+			uint32_t slot_count
+		);
+		~FrameSync();
+
+		FrameSync(const FrameSync&) = delete;
+		FrameSync& operator=(const FrameSync&) = delete;
+
+		bool UsesTimeline() const;
+
+		uint64_t GetSubmittedFrame() const;
+		uint64_t GetCompletedFrame();
+		uint64_t GetSlotFrame(uint32_t slot) const;
+
+		bool IsFrameComplete(uint64_t frame);
+		bool WaitForFrame(uint64_t frame);
+
+		bool IsSlotComplete(uint32_t slot);
+		bool WaitForSlot(uint32_t slot);
+
+		// Submits to the queue and signals the next frame value, which is
+		// then recorded as the slot's latest frame.
+		VkResult Submit(
+			VkQueue queue,
+			uint32_t slot,
+			VkSubmitInfo submit_info
+		);
+
+		bool success;
+	private:
+		bool CreateTimeline();
+		bool CreateFences();
+		void DestroySyncObjects();
+
+		Device& device;
+
+		VkSemaphore timeline = VK_NULL_HANDLE;
+		std::vector<VkFence> fences = {};
+
+		std::vector<uint64_t> slot_frames = {};
+		uint64_t submitted_frame = 0;
+		uint64_t completed_frame = 0;
+	};
+}
\ No newline at end of file
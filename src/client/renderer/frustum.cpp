@@ -0,0 +1,190 @@
+#include "frustum.h"
+
+#include <bit>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define YIB_FRUSTUM_SIMD_WIDTH 8
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define YIB_FRUSTUM_SIMD_WIDTH 4
+#else
+#define YIB_FRUSTUM_SIMD_WIDTH 1
+#endif
+
+namespace yib {
+	void BoundingSpheres::Clear() {
+		this->x.clear();
+		this->y.clear();
+		this->z.clear();
+		this->radius.clear();
+	}
+
+	void BoundingSpheres::Reserve(uint32_t count) {
+		this->x.reserve(count);
+		this->y.reserve(count);
+		this->z.reserve(count);
+		this->radius.reserve(count);
+	}
+
+	void BoundingSpheres::Add(
+		const glm::vec3& center,
+		float radius
+	) {
+		this->x.push_back(center.x);
+		this->y.push_back(center.y);
+		this->z.push_back(center.z);
+		this->radius.push_back(radius);
+	}
+
+	uint32_t BoundingSpheres::Size() const {
+		return this->x.size();
+	}
+
+
+	Frustum::Frustum(const glm::mat4& projection_view) {
+		glm::vec4 rows[4];
+		for (int i = 0; i < 4; i++) {
+			rows[i] = glm::vec4(
+				projection_view[0][i],
+				projection_view[1][i],
+				projection_view[2][i],
+				projection_view[3][i]
+			);
+		}
+
+		// Depth is in the zero to one range, so the near plane is the third
+		// row on its own.
+		this->planes[0] = rows[3] + rows[0];
+		this->planes[1] = rows[3] - rows[0];
+		this->planes[2] = rows[3] + rows[1];
+		this->planes[3] = rows[3] - rows[1];
+		this->planes[4] = rows[2];
+		this->planes[5] = rows[3] - rows[2];
+
+		for (glm::vec4& plane : this->planes) {
+			plane /= glm::length(glm::vec3(plane));
+		}
+	}
+
+
+	bool Frustum::IsVisible(
+		const glm::vec3& center,
+		float radius
+	) const {
+		for (const glm::vec4& plane : this->planes) {
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+
+	void Frustum::Cull(
+		const BoundingSpheres& spheres,
+		std::vector<uint32_t>& visible
+	) const {
+		visible.clear();
+
+		uint32_t count = spheres.Size();
+		uint32_t i = 0;
+
+#if YIB_FRUSTUM_SIMD_WIDTH == 8
+		for (; i + 8 <= count; i += 8) {
+			__m256 x = _mm256_loadu_ps(spheres.x.data() + i);
+			__m256 y = _mm256_loadu_ps(spheres.y.data() + i);
+			__m256 z = _mm256_loadu_ps(spheres.z.data() + i);
+			__m256 negative_radius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(spheres.radius.data() + i));
+
+			__m256 outside = _mm256_setzero_ps();
+			for (const glm::vec4& plane : this->planes) {
+				__m256 distance = _mm256_add_ps(
+					_mm256_add_ps(
+						_mm256_mul_ps(x, _mm256_set1_ps(plane.x)),
+						_mm256_mul_ps(y, _mm256_set1_ps(plane.y))
+					),
+					_mm256_add_ps(
+						_mm256_mul_ps(z, _mm256_set1_ps(plane.z)),
+						_mm256_set1_ps(plane.w)
+					)
+				);
+
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, negative_radius, _CMP_LT_OQ));
+			}
+
+			uint32_t mask = ~_mm256_movemask_ps(outside) & 0xFF;
+			while (mask != 0) {
+				visible.push_back(i + std::countr_zero(mask));
+				mask &= mask - 1;
+			}
+		}
+#elif YIB_FRUSTUM_SIMD_WIDTH == 4
+		for (; i + 4 <= count; i += 4) {
+			__m128 x = _mm_loadu_ps(spheres.x.data() + i);
+			__m128 y = _mm_loadu_ps(spheres.y.data() + i);
+			__m128 z = _mm_loadu_ps(spheres.z.data() + i);
+			__m128 negative_radius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(spheres.radius.data() + i));
+
+			__m128 outside = _mm_setzero_ps();
+			for (const glm::vec4& plane : this->planes) {
+				__m128 distance = _mm_add_ps(
+					_mm_add_ps(
+						_mm_mul_ps(x, _mm_set1_ps(plane.x)),
+						_mm_mul_ps(y, _mm_set1_ps(plane.y))
+					),
+					_mm_add_ps(
+						_mm_mul_ps(z, _mm_set1_ps(plane.z)),
+						_mm_set1_ps(plane.w)
+					)
+				);
+
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negative_radius));
+			}
+
+			uint32_t mask = ~_mm_movemask_ps(outside) & 0xF;
+			while (mask != 0) {
+				visible.push_back(i + std::countr_zero(mask));
+				mask &= mask - 1;
+			}
+		}
+#endif
+
+		CullRange(spheres, i, count, visible);
+	}
+
+	void Frustum::CullScalar(
+		const BoundingSpheres& spheres,
+		std::vector<uint32_t>& visible
+	) const {
+		visible.clear();
+
+		CullRange(spheres, 0, spheres.Size(), visible);
+	}
+
+
+	uint32_t Frustum::GetSimdWidth() {
+		return YIB_FRUSTUM_SIMD_WIDTH;
+	}
+
+
+	void Frustum::CullRange(
+		const BoundingSpheres& spheres,
+		uint32_t first,
+		uint32_t last,
+		std::vector<uint32_t>& visible
+	) const {
+		for (uint32_t i = first; i < last; i++) {
+			glm::vec3 center = glm::vec3(
+				spheres.x[i],
+				spheres.y[i],
+				spheres.z[i]
+			);
+
+			if (IsVisible(center, spheres.radius[i])) {
+				visible.push_back(i);
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+namespace yib {
+	// Bounding spheres stored as separate arrays so the culler can load
+	// several of them into one register.
+	struct BoundingSpheres {
+		void Clear();
+		void Reserve(uint32_t count);
+		void Add(
+			const glm::vec3& center,
+			float radius
+		);
+		uint32_t Size() const;
+
+		std::vector<float> x = {};
+		std::vector<float> y = {};
+		std::vector<float> z = {};
+		std::vector<float> radius = {};
+	};
+
+	class Frustum {
+	public:
+		Frustum(const glm::mat4& projection_view);
+
+		bool IsVisible(
+			const glm::vec3& center,
+			float radius
+		) const;
+
+		// Writes the indices of the spheres that intersect the frustum.
+		// Uses AVX or SSE when the compiler targets them.
+		void Cull(
+			const BoundingSpheres& spheres,
+			std::vector<uint32_t>& visible
+		) const;
+		void CullScalar(
+			const BoundingSpheres& spheres,
+			std::vector<uint32_t>& visible
+		) const;
+
+		static uint32_t GetSimdWidth();
+	private:
+		void CullRange(
+			const BoundingSpheres& spheres,
+			uint32_t first,
+			uint32_t last,
+			std::vector<uint32_t>& visible
+		) const;
+
+		glm::vec4 planes[6];
+	};
+}
\ No newline at end of file
@@ -0,0 +1,273 @@
+#include "gpu_culling.h"
+
+#include "swapchain.h"
+
+namespace yib {
+	GpuCulling::GpuCulling(Device& device) : device(device), success(false) {
+		if (!CreateDescriptors()) {
+			return;
+		}
+
+		if (!CreatePipeline()) {
+			return;
+		}
+
+		this->frames.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+
+		this->success = true;
+	}
+
+	GpuCulling::~GpuCulling() { }
+
+
+	bool GpuCulling::Prepare(
+		uint32_t frame_index,
+		const glm::mat4& projection_view,
+		const std::vector<CullObject>& objects,
+		const std::vector<VkDrawIndexedIndirectCommand>& draws
+	) {
+		this->frames.at(frame_index).push_constant = {};
+
+		if (objects.empty() || draws.empty()) {
+			return true;
+		}
+
+		if (!ReserveFrame(frame_index, objects.size(), draws.size())) {
+			return false;
+		}
+
+		Frame& frame = this->frames.at(frame_index);
+
+		// The frame's fence was waited on before recording began, so the gpu
+		// is done reading these and the submit makes the writes visible.
+		if (!frame.object_buffer->Write(
+			(void*)objects.data(),
+			sizeof(CullObject) * objects.size()
+		)) {
+			return false;
+		}
+
+		if (!frame.draw_buffer->Write(
+			(void*)draws.data(),
+			DRAW_STRIDE * draws.size()
+		)) {
+			return false;
+		}
+
+		frame.object_buffer->Flush();
+		frame.draw_buffer->Flush();
+
+		frame.push_constant.projection_view = projection_view;
+		frame.push_constant.object_count = objects.size();
+
+		return true;
+	}
+
+	void GpuCulling::Dispatch(
+		VkCommandBuffer command_buffer,
+		uint32_t frame_index
+	) const {
+		const Frame& frame = this->frames.at(frame_index);
+		if (frame.push_constant.object_count == 0) {
+			return;
+		}
+
+		this->pipeline->BindCommandBuffer(command_buffer);
+
+		vkCmdBindDescriptorSets(
+			command_buffer,
+			VK_PIPELINE_BIND_POINT_COMPUTE,
+			this->pipeline->GetPipelineLayout(),
+			0,
+			1,
+			&frame.descriptor_set,
+			0,
+			nullptr
+		);
+
+		vkCmdPushConstants(
+			command_buffer,
+			this->pipeline->GetPipelineLayout(),
+			VK_SHADER_STAGE_COMPUTE_BIT,
+			0,
+			sizeof(PushConstant),
+			&frame.push_constant
+		);
+
+		vkCmdDispatch(
+			command_buffer,
+			(frame.push_constant.object_count + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+			1,
+			1
+		);
+	}
+
+
+	VkBuffer GpuCulling::GetDrawBuffer(uint32_t frame_index) const {
+		const Frame& frame = this->frames.at(frame_index);
+		if (frame.draw_buffer == nullptr) {
+			return VK_NULL_HANDLE;
+		}
+
+		return frame.draw_buffer->GetBuffer();
+	}
+
+	VkBuffer GpuCulling::GetInstanceBuffer(uint32_t frame_index) const {
+		const Frame& frame = this->frames.at(frame_index);
+		if (frame.instance_buffer == nullptr) {
+			return VK_NULL_HANDLE;
+		}
+
+		return frame.instance_buffer->GetBuffer();
+	}
+
+
+	bool GpuCulling::CreateDescriptors() {
+		DescriptorSetLayout::Builder set_layout_builder = DescriptorSetLayout::Builder(this->device);
+
+		for (uint32_t binding = 0; binding < 3; binding++) {
+			set_layout_builder.AddBinding(
+				binding,
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_COMPUTE_BIT
+			);
+		}
+
+		this->set_layout = set_layout_builder.Build();
+		if (!this->set_layout->success) {
+			return false;
+		}
+
+		DescriptorPool::Builder pool_builder = DescriptorPool::Builder(this->device);
+
+		pool_builder.SetMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT);
+		pool_builder.AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT * 3);
+
+		this->descriptor_pool = pool_builder.Build();
+		if (!this->descriptor_pool->success) {
+			return false;
+		}
+
+		return true;
+	}
+
+	bool GpuCulling::CreatePipeline() {
+		VkPushConstantRange push_constant_range = {};
+
+		push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		push_constant_range.offset = 0;
+		push_constant_range.size = sizeof(PushConstant);
+
+		this->pipeline = std::make_unique<ComputePipeline>(
+			this->device,
+			"D:/documents/projects/Yibengine/src/client/shaders/cull.comp.spv",
+			std::vector<VkDescriptorSetLayout>{ this->set_layout->GetDescriptorSetLayout() },
+			std::vector<VkPushConstantRange>{ push_constant_range }
+		);
+		if (!this->pipeline->success) {
+			return false;
+		}
+
+		return true;
+	}
+
+
+	bool GpuCulling::ReserveFrame(
+		uint32_t frame_index,
+		uint32_t object_count,
+		uint32_t draw_count
+	) {
+		Frame& frame = this->frames.at(frame_index);
+
+		bool objects_fit = frame.object_buffer != nullptr && frame.object_buffer->GetInstanceCount() >= object_count;
+		bool draws_fit = frame.draw_buffer != nullptr && frame.draw_buffer->GetInstanceCount() >= draw_count;
+		if (objects_fit && draws_fit) {
+			return true;
+		}
+
+		if (!objects_fit) {
+			uint32_t capacity = 256;
+			while (capacity < object_count) {
+				capacity *= 2;
+			}
+
+			frame.object_buffer = std::make_unique<Buffer>(
+				this->device,
+				sizeof(CullObject),
+				capacity,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+			);
+			if (!frame.object_buffer->success || !frame.object_buffer->Map()) {
+				frame.object_buffer = nullptr;
+				return false;
+			}
+
+			// Every object can be visible, so the output needs a slot per object.
+			frame.instance_buffer = std::make_unique<Buffer>(
+				this->device,
+				sizeof(CullInstance),
+				capacity,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+			);
+			if (!frame.instance_buffer->success) {
+				frame.object_buffer = nullptr;
+				frame.instance_buffer = nullptr;
+				return false;
+			}
+		}
+
+		if (!draws_fit) {
+			uint32_t capacity = 16;
+			while (capacity < draw_count) {
+				capacity *= 2;
+			}
+
+			frame.draw_buffer = std::make_unique<Buffer>(
+				this->device,
+				DRAW_STRIDE,
+				capacity,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+			);
+			if (!frame.draw_buffer->success || !frame.draw_buffer->Map()) {
+				frame.draw_buffer = nullptr;
+				return false;
+			}
+		}
+
+		if (frame.object_buffer == nullptr || frame.draw_buffer == nullptr) {
+			return false;
+		}
+
+		VkDescriptorBufferInfo object_info = frame.object_buffer->DescriptorInfo();
+		VkDescriptorBufferInfo draw_info = frame.draw_buffer->DescriptorInfo();
+		VkDescriptorBufferInfo instance_info = frame.instance_buffer->DescriptorInfo();
+
+		DescriptorWriter writer = DescriptorWriter(
+			*this->set_layout,
+			*this->descriptor_pool
+		);
+
+		if (!writer.WriteBuffer(0, &object_info)) {
+			return false;
+		}
+
+		if (!writer.WriteBuffer(1, &draw_info)) {
+			return false;
+		}
+
+		if (!writer.WriteBuffer(2, &instance_info)) {
+			return false;
+		}
+
+		if (frame.descriptor_set == VK_NULL_HANDLE) {
+			return writer.Build(frame.descriptor_set);
+		}
+
+		writer.Overwrite(frame.descriptor_set);
+
+		return true;
+	}
+}
\ No newline at end of file
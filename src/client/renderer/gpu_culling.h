@@ -0,0 +1,102 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include "device.h"
+#include "buffer.h"
+#include "descriptors.h"
+#include "compute_pipeline.h"
+
+namespace yib {
+	// Matches the Object struct in cull.comp, std430 layout.
+	struct CullObject {
+		glm::mat4 model_matrix{ 1.0f };
+		glm::vec4 bounding_sphere{ 0.0f };
+		uint32_t draw_index = 0;
+		uint32_t first_instance = 0;
+		uint32_t texture_index = 0;
+		uint32_t padding = 0;
+	};
+
+	// Matches the Instance struct in cull.comp, std430 layout.
+	struct CullInstance {
+		glm::mat4 model_matrix{ 1.0f };
+		uint32_t texture_index = 0;
+		uint32_t padding[3] = {};
+	};
+
+	// Frustum culls objects on the gpu. Every visible object bumps the
+	// instance count of its draw command and writes its matrix to the
+	// instance buffer, starting at the object's first instance.
+	class GpuCulling {
+	public:
+		GpuCulling(Device& device);
+		~GpuCulling();
+
+		GpuCulling(const GpuCulling&) = delete;
+		GpuCulling& operator=(const GpuCulling&) = delete;
+
+		// Uploads the frame's objects and draws, which may replace the
+		// frame's buffers. The draw commands are expected to have an instance
+		// count of zero.
+		bool Prepare(
+			uint32_t frame_index,
+			const glm::mat4& projection_view,
+			const std::vector<CullObject>& objects,
+			const std::vector<VkDrawIndexedIndirectCommand>& draws
+		);
+		// Has to be recorded outside of a render pass. The outputs are written
+		// by a compute shader, readers have to wait on it.
+		void Dispatch(
+			VkCommandBuffer command_buffer,
+			uint32_t frame_index
+		) const;
+
+		// Null until the frame first culled something.
+		VkBuffer GetDrawBuffer(uint32_t frame_index) const;
+		VkBuffer GetInstanceBuffer(uint32_t frame_index) const;
+
+		static constexpr uint32_t DRAW_STRIDE = sizeof(VkDrawIndexedIndirectCommand);
+		static constexpr uint32_t WORKGROUP_SIZE = 64;
+
+		bool success;
+	private:
+		struct PushConstant {
+			glm::mat4 projection_view{ 1.0f };
+			uint32_t object_count = 0;
+		};
+
+		struct Frame {
+			std::unique_ptr<Buffer> object_buffer;
+			std::unique_ptr<Buffer> draw_buffer;
+			std::unique_ptr<Buffer> instance_buffer;
+			VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+			PushConstant push_constant = {};
+		};
+
+		bool CreateDescriptors();
+		bool CreatePipeline();
+
+		bool ReserveFrame(
+			uint32_t frame_index,
+			uint32_t object_count,
+			uint32_t draw_count
+		);
+
+		Device& device;
+
+		std::unique_ptr<DescriptorSetLayout> set_layout;
+		std::unique_ptr<DescriptorPool> descriptor_pool;
+		std::unique_ptr<ComputePipeline> pipeline;
+
+		std::vector<Frame> frames;
+	};
+}
\ No newline at end of file
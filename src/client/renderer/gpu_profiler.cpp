@@ -0,0 +1,287 @@
+#include "gpu_profiler.h"
+
+#include "swapchain.h"
+
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+
+namespace yib {
+	GpuProfiler::Scope::Scope(
+		GpuProfiler& profiler,
+		VkCommandBuffer command_buffer,
+		const std::string& name
+	) :
+		profiler(profiler),
+		command_buffer(command_buffer)
+	{
+		this->profiler.BeginZone(
+			command_buffer,
+			name
+		);
+	}
+
+	GpuProfiler::Scope::~Scope() {
+		this->profiler.EndZone(this->command_buffer);
+	}
+
+
+	GpuProfiler::GpuProfiler(
+		Device& device,
+		uint32_t max_zones,
+		uint32_t history_size
+	) :
+		device(device),
+		max_zones(max_zones),
+		history_size(history_size),
+		success(false)
+	{
+		const VkPhysicalDeviceLimits& limits = device.GetPhysicalDeviceProperties().limits;
+
+		// Without timestamps on every graphics and compute queue the zones
+		// are left empty instead of failing the renderer.
+		this->supported = limits.timestampComputeAndGraphics == VK_TRUE;
+		this->timestamp_period = limits.timestampPeriod;
+
+		if (this->supported && !CreateQueryPools()) {
+			return;
+		}
+
+		this->success = true;
+	}
+
+	GpuProfiler::~GpuProfiler() {
+		DestroyQueryPools();
+	}
+
+
+	bool GpuProfiler::IsSupported() const {
+		return this->supported;
+	}
+
+	void GpuProfiler::BeginFrame(
+		VkCommandBuffer command_buffer,
+		uint32_t frame_index
+	) {
+		if (!this->supported) {
+			return;
+		}
+
+		Frame& frame = this->frames.at(frame_index);
+
+		ReadFrame(frame);
+
+		vkCmdResetQueryPool(
+			command_buffer,
+			frame.query_pool,
+			0,
+			this->max_zones * 2
+		);
+
+		frame.zones.clear();
+
+		this->current_frame = &frame;
+		this->open_zones.clear();
+	}
+
+	bool GpuProfiler::BeginZone(
+		VkCommandBuffer command_buffer,
+		const std::string& name
+	) {
+		if (this->current_frame == nullptr) {
+			return false;
+		}
+
+		std::vector<GpuZone>& zones = this->current_frame->zones;
+
+		if (zones.size() >= this->max_zones) {
+			this->open_zones.push_back(UINT32_MAX);
+			return false;
+		}
+
+		GpuZone zone = {};
+		zone.name = name;
+		zone.path = name;
+
+		if (!this->open_zones.empty() && this->open_zones.back() != UINT32_MAX) {
+			const GpuZone& parent = zones.at(this->open_zones.back());
+
+			zone.parent = this->open_zones.back();
+			zone.depth = parent.depth + 1;
+			zone.path = parent.path + "/" + name;
+		}
+
+		vkCmdWriteTimestamp(
+			command_buffer,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			this->current_frame->query_pool,
+			zones.size() * 2
+		);
+
+		this->open_zones.push_back(zones.size());
+		zones.push_back(std::move(zone));
+
+		return true;
+	}
+
+	bool GpuProfiler::EndZone(VkCommandBuffer command_buffer) {
+		if (this->current_frame == nullptr || this->open_zones.empty()) {
+			return false;
+		}
+
+		uint32_t zone_index = this->open_zones.back();
+		this->open_zones.pop_back();
+
+		if (zone_index == UINT32_MAX) {
+			return false;
+		}
+
+		vkCmdWriteTimestamp(
+			command_buffer,
+			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			this->current_frame->query_pool,
+			zone_index * 2 + 1
+		);
+
+		return true;
+	}
+
+	const std::vector<GpuZone>& GpuProfiler::GetLastFrame() const {
+		return this->last_frame;
+	}
+
+	std::optional<GpuZoneStats> GpuProfiler::GetStats(const std::string& path) const {
+		auto it = this->history.find(path);
+		if (it == this->history.end() || it->second.empty()) {
+			return std::nullopt;
+		}
+
+		std::vector<double> samples(it->second.begin(), it->second.end());
+		std::sort(samples.begin(), samples.end());
+
+		// Nearest rank.
+		auto percentile = [&samples](double fraction) {
+			size_t rank = std::ceil(fraction * samples.size());
+			return samples.at(std::clamp<size_t>(rank, 1, samples.size()) - 1);
+		};
+
+		GpuZoneStats stats = {};
+
+		for (double sample : samples) {
+			stats.average += sample;
+		}
+
+		stats.average /= samples.size();
+		stats.percentile_50 = percentile(0.50);
+		stats.percentile_95 = percentile(0.95);
+		stats.percentile_99 = percentile(0.99);
+		stats.sample_count = samples.size();
+
+		return stats;
+	}
+
+	void GpuProfiler::Print() const {
+		if (this->last_frame.empty()) {
+			return;
+		}
+
+		printf("Gpu zones (ms)          last      avg      p50      p95      p99\n");
+
+		for (const GpuZone& zone : this->last_frame) {
+			std::optional<GpuZoneStats> stats = GetStats(zone.path);
+			if (!stats.has_value()) {
+				continue;
+			}
+
+			std::string label = std::string(zone.depth * 2, ' ') + zone.name;
+
+			printf(
+				"%-20s %8.3f %8.3f %8.3f %8.3f %8.3f\n",
+				label.c_str(),
+				zone.duration,
+				stats.value().average,
+				stats.value().percentile_50,
+				stats.value().percentile_95,
+				stats.value().percentile_99
+			);
+		}
+	}
+
+
+	bool GpuProfiler::CreateQueryPools() {
+		this->frames.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+		this->timestamps.resize(this->max_zones * 2);
+
+		VkQueryPoolCreateInfo create_info = {};
+
+		create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		create_info.queryCount = this->max_zones * 2;
+
+		for (Frame& frame : this->frames) {
+			if (vkCreateQueryPool(
+				this->device.GetDevice(),
+				&create_info,
+				nullptr,
+				&frame.query_pool
+			) != VK_SUCCESS) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void GpuProfiler::DestroyQueryPools() {
+		for (Frame& frame : this->frames) {
+			vkDestroyQueryPool(
+				this->device.GetDevice(),
+				frame.query_pool,
+				nullptr
+			);
+		}
+	}
+
+
+	void GpuProfiler::ReadFrame(Frame& frame) {
+		if (frame.zones.empty()) {
+			return;
+		}
+
+		uint32_t query_count = frame.zones.size() * 2;
+
+		// No wait flag, a frame whose submit never happened reports not
+		// ready and is dropped.
+		if (vkGetQueryPoolResults(
+			this->device.GetDevice(),
+			frame.query_pool,
+			0,
+			query_count,
+			query_count * sizeof(uint64_t),
+			this->timestamps.data(),
+			sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT
+		) != VK_SUCCESS) {
+			return;
+		}
+
+		for (size_t i = 0; i < frame.zones.size(); i++) {
+			GpuZone& zone = frame.zones.at(i);
+
+			uint64_t begin = this->timestamps.at(i * 2);
+			uint64_t end = this->timestamps.at(i * 2 + 1);
+
+			// Ticks to nanoseconds to milliseconds.
+			zone.duration = end > begin ? (end - begin) * this->timestamp_period / 1000000.0 : 0.0;
+
+			std::deque<double>& samples = this->history[zone.path];
+
+			samples.push_back(zone.duration);
+			if (samples.size() > this->history_size) {
+				samples.pop_front();
+			}
+		}
+
+		this->last_frame = frame.zones;
+	}
+}
\ No newline at end of file
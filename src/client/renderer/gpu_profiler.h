@@ -0,0 +1,115 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+
+#include <vulkan/vulkan.h>
+
+#include "device.h"
+
+namespace yib {
+	struct GpuZone {
+		std::string name;
+		// Names of every enclosing zone joined by '/', used to match a zone
+		// across frames.
+		std::string path;
+		uint32_t parent = UINT32_MAX;
+		uint32_t depth = 0;
+		// Milliseconds.
+		double duration = 0.0;
+	};
+
+	struct GpuZoneStats {
+		double average = 0.0;
+		double percentile_50 = 0.0;
+		double percentile_95 = 0.0;
+		double percentile_99 = 0.0;
+		uint32_t sample_count = 0;
+	};
+
+	// Times nested zones of a frame's command buffer with timestamp queries.
+	// Every frame slot owns a query pool which is only read back once the slot
+	// comes around again, by then its fence has been waited on so reading
+	// never stalls.
+	class GpuProfiler {
+	public:
+		class Scope {
+		public:
+			Scope(
+				GpuProfiler& profiler,
+				VkCommandBuffer command_buffer,
+				const std::string& name
+			);
+			~Scope();
+
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+		private:
+			GpuProfiler& profiler;
+			VkCommandBuffer command_buffer;
+		};
+
+		GpuProfiler(
+			Device& device,
+			uint32_t max_zones = 128,
+			uint32_t history_size = 256
+		);
+		~GpuProfiler();
+
+		GpuProfiler(const GpuProfiler&) = delete;
+		GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+		bool IsSupported() const;
+
+		// Has to be recorded first in the frame's command buffer, after the
+		// frame's previous submit has completed.
+		void BeginFrame(
+			VkCommandBuffer command_buffer,
+			uint32_t frame_index
+		);
+
+		bool BeginZone(
+			VkCommandBuffer command_buffer,
+			const std::string& name
+		);
+		bool EndZone(VkCommandBuffer command_buffer);
+
+		// The latest frame that was read back, parents come before children.
+		const std::vector<GpuZone>& GetLastFrame() const;
+		std::optional<GpuZoneStats> GetStats(const std::string& path) const;
+
+		void Print() const;
+
+		bool success;
+	private:
+		struct Frame {
+			VkQueryPool query_pool = VK_NULL_HANDLE;
+			// Zone i owns queries 2 * i and 2 * i + 1.
+			std::vector<GpuZone> zones = {};
+		};
+
+		bool CreateQueryPools();
+		void DestroyQueryPools();
+
+		void ReadFrame(Frame& frame);
+
+		Device& device;
+		bool supported = false;
+		double timestamp_period = 0.0;
+		uint32_t max_zones;
+		uint32_t history_size;
+
+		std::vector<Frame> frames = {};
+		Frame* current_frame = nullptr;
+		// Zones that were dropped because the pool ran out are UINT32_MAX.
+		std::vector<uint32_t> open_zones = {};
+		std::vector<uint64_t> timestamps = {};
+
+		std::vector<GpuZone> last_frame = {};
+		std::unordered_map<std::string, std::deque<double>> history = {};
+	};
+}
\ No newline at end of file
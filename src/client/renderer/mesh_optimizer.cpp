@@ -0,0 +1,983 @@
+#include "mesh_optimizer.h"
+
+#include <bit>
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "../../shared/profiler.h"
+
+namespace yib {
+	// Sum of squared distances to a set of planes, weighted by area.
+	struct Quadric {
+		double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+		double b2 = 0.0, bc = 0.0, bd = 0.0;
+		double c2 = 0.0, cd = 0.0;
+		double d2 = 0.0;
+		double weight = 0.0;
+
+		void AddPlane(
+			const glm::vec3& normal,
+			float distance,
+			float area
+		) {
+			double a = normal.x, b = normal.y, c = normal.z, d = distance;
+
+			this->a2 += a * a * area;
+			this->ab += a * b * area;
+			this->ac += a * c * area;
+			this->ad += a * d * area;
+			this->b2 += b * b * area;
+			this->bc += b * c * area;
+			this->bd += b * d * area;
+			this->c2 += c * c * area;
+			this->cd += c * d * area;
+			this->d2 += d * d * area;
+			this->weight += area;
+		}
+
+		void Add(const Quadric& other) {
+			this->a2 += other.a2;
+			this->ab += other.ab;
+			this->ac += other.ac;
+			this->ad += other.ad;
+			this->b2 += other.b2;
+			this->bc += other.bc;
+			this->bd += other.bd;
+			this->c2 += other.c2;
+			this->cd += other.cd;
+			this->d2 += other.d2;
+			this->weight += other.weight;
+		}
+
+		// Mean squared distance of the point to the planes.
+		double Evaluate(const glm::vec3& point) const {
+			if (this->weight <= 0.0) {
+				return 0.0;
+			}
+
+			double x = point.x, y = point.y, z = point.z;
+
+			double result =
+				this->a2 * x * x + this->b2 * y * y + this->c2 * z * z +
+				2.0 * (this->ab * x * y + this->ac * x * z + this->bc * y * z) +
+				2.0 * (this->ad * x + this->bd * y + this->cd * z) +
+				this->d2;
+
+			return std::max(result, 0.0) / this->weight;
+		}
+	};
+
+	// Exact position bits, so vertices split only by their normal or uv
+	// end up with the same key.
+	struct PositionKey {
+		uint32_t x = 0;
+		uint32_t y = 0;
+		uint32_t z = 0;
+
+		bool operator==(const PositionKey& other) const {
+			return this->x == other.x &&
+				this->y == other.y &&
+				this->z == other.z;
+		}
+	};
+
+	struct PositionKeyHash {
+		size_t operator()(const PositionKey& key) const {
+			uint64_t hash = 14695981039346656037ull;
+
+			for (uint32_t value : { key.x, key.y, key.z }) {
+				hash ^= value;
+				hash *= 1099511628211ull;
+			}
+
+			return hash;
+		}
+	};
+
+	struct EdgeCollapse {
+		uint32_t from = 0;
+		uint32_t to = 0;
+		double cost = 0.0;
+	};
+
+
+	void MeshOptimizer::Optimize(
+		ModelData& data,
+		float overdraw_threshold
+	) {
+		YIB_PROFILE_FUNCTION();
+
+		OptimizeVertexCache(data.indices, data.vertices.size());
+		OptimizeOverdraw(data.indices, data.vertices, overdraw_threshold);
+		OptimizeVertexFetch(data.vertices, data.indices);
+
+		data.bounds = Bounds::FromVertices(data.vertices);
+	}
+
+	void MeshOptimizer::GenerateLods(
+		ModelData& data,
+		uint32_t max_lod_count,
+		float reduction
+	) {
+		YIB_PROFILE_FUNCTION();
+
+		data.lods.clear();
+
+		MeshLod full_lod = {};
+		full_lod.index_count = data.indices.size();
+
+		data.lods.push_back(full_lod);
+
+		std::vector<uint32_t> previous = data.indices;
+		float error = 0.0f;
+
+		while (data.lods.size() < max_lod_count) {
+			uint32_t target_index_count = (uint32_t)(previous.size() / 3 * reduction) * 3;
+
+			float lod_error = 0.0f;
+			std::vector<uint32_t> lod = Simplify(
+				data.vertices,
+				previous,
+				target_index_count,
+				lod_error
+			);
+
+			// Locked seams and borders limit how far a mesh can go, a level
+			// that barely shrinks is not worth switching to.
+			if (lod.empty() || lod.size() * 10 > previous.size() * 9) {
+				break;
+			}
+
+			OptimizeVertexCache(lod, data.vertices.size());
+
+			// Each level is simplified from the one before, so the errors add
+			// up at worst.
+			error += lod_error;
+
+			MeshLod mesh_lod = {};
+			mesh_lod.first_index = data.indices.size();
+			mesh_lod.index_count = lod.size();
+			mesh_lod.error = error;
+
+			data.indices.insert(
+				data.indices.end(),
+				lod.begin(),
+				lod.end()
+			);
+			data.lods.push_back(mesh_lod);
+
+			previous = std::move(lod);
+		}
+	}
+
+
+	void MeshOptimizer::OptimizeVertexCache(
+		std::vector<uint32_t>& indices,
+		uint32_t vertex_count
+	) {
+		uint32_t triangle_count = indices.size() / 3;
+		if (triangle_count == 0 || vertex_count == 0) {
+			return;
+		}
+
+		// Triangles adjacent to each vertex, stored back to back.
+		std::vector<uint32_t> live(vertex_count, 0);
+		std::vector<uint32_t> first_triangle(vertex_count + 1, 0);
+
+		for (uint32_t i = 0; i < triangle_count * 3; i++) {
+			live[indices[i]]++;
+		}
+
+		for (uint32_t i = 0; i < vertex_count; i++) {
+			first_triangle[i + 1] = first_triangle[i] + live[i];
+		}
+
+		std::vector<uint32_t> triangles(triangle_count * 3);
+		std::vector<uint32_t> next_triangle = first_triangle;
+
+		for (uint32_t i = 0; i < triangle_count * 3; i++) {
+			triangles[next_triangle[indices[i]]++] = i / 3;
+		}
+
+		std::vector<uint32_t> cache_time(vertex_count, 0);
+		std::vector<bool> emitted(triangle_count, false);
+		std::vector<uint32_t> dead_end = {};
+		std::vector<uint32_t> candidates = {};
+		std::vector<uint32_t> result = {};
+
+		dead_end.reserve(triangle_count * 3);
+		result.reserve(triangle_count * 3);
+
+		uint32_t time = CACHE_SIZE + 1;
+		uint32_t cursor = 0;
+		uint32_t fanning = 0;
+
+		while (fanning != UINT32_MAX) {
+			candidates.clear();
+
+			// Emits every remaining triangle around the fanning vertex.
+			for (uint32_t i = first_triangle[fanning]; i < first_triangle[fanning + 1]; i++) {
+				uint32_t triangle = triangles[i];
+				if (emitted[triangle]) {
+					continue;
+				}
+
+				for (uint32_t corner = 0; corner < 3; corner++) {
+					uint32_t vertex = indices[triangle * 3 + corner];
+
+					result.push_back(vertex);
+					dead_end.push_back(vertex);
+					candidates.push_back(vertex);
+					live[vertex]--;
+
+					if (time - cache_time[vertex] > CACHE_SIZE) {
+						cache_time[vertex] = time;
+						time++;
+					}
+				}
+
+				emitted[triangle] = true;
+			}
+
+			// Prefers the oldest candidate that still stays in the cache
+			// while its remaining triangles are emitted.
+			fanning = UINT32_MAX;
+			int64_t best_priority = -1;
+
+			for (uint32_t vertex : candidates) {
+				if (live[vertex] == 0) {
+					continue;
+				}
+
+				int64_t priority = 0;
+				if (time - cache_time[vertex] + 2 * live[vertex] <= CACHE_SIZE) {
+					priority = time - cache_time[vertex];
+				}
+
+				if (priority > best_priority) {
+					best_priority = priority;
+					fanning = vertex;
+				}
+			}
+
+			if (fanning != UINT32_MAX) {
+				continue;
+			}
+
+			// Dead end, backtrack through recently emitted vertices before
+			// falling back to the next unfinished one in index order.
+			while (!dead_end.empty() && fanning == UINT32_MAX) {
+				uint32_t vertex = dead_end.back();
+				dead_end.pop_back();
+
+				if (live[vertex] > 0) {
+					fanning = vertex;
+				}
+			}
+
+			while (cursor < vertex_count && fanning == UINT32_MAX) {
+				if (live[cursor] > 0) {
+					fanning = cursor;
+				}
+
+				cursor++;
+			}
+		}
+
+		indices = std::move(result);
+	}
+
+	void MeshOptimizer::OptimizeOverdraw(
+		std::vector<uint32_t>& indices,
+		const std::vector<Vertex>& vertices,
+		float threshold
+	) {
+		uint32_t triangle_count = indices.size() / 3;
+		if (triangle_count == 0) {
+			return;
+		}
+
+		std::vector<uint32_t> cache_time(vertices.size(), 0);
+		uint32_t time = CACHE_SIZE + 1;
+
+		// Three misses in a row usually means the cache ordering jumped to
+		// a disconnected patch.
+		std::vector<uint32_t> hard_boundaries = {};
+
+		for (uint32_t i = 0; i < triangle_count; i++) {
+			uint32_t misses = UpdateCache(
+				&indices[i * 3],
+				cache_time,
+				time
+			);
+
+			if (i == 0 || misses == 3) {
+				hard_boundaries.push_back(i);
+			}
+		}
+
+		hard_boundaries.push_back(triangle_count);
+
+		// Splits the patches further wherever a cluster can end without
+		// costing more than threshold times the patch's own ACMR.
+		std::vector<uint32_t> clusters = {};
+
+		for (uint32_t i = 0; i + 1 < hard_boundaries.size(); i++) {
+			uint32_t start = hard_boundaries.at(i);
+			uint32_t end = hard_boundaries.at(i + 1);
+
+			// Moving time past the cache size empties it.
+			time += CACHE_SIZE + 1;
+
+			uint32_t patch_misses = 0;
+			for (uint32_t j = start; j < end; j++) {
+				patch_misses += UpdateCache(&indices[j * 3], cache_time, time);
+			}
+
+			float cluster_threshold = threshold * patch_misses / (end - start);
+
+			time += CACHE_SIZE + 1;
+
+			uint32_t cluster_misses = 0;
+			uint32_t cluster_triangles = 0;
+
+			for (uint32_t j = start; j < end; j++) {
+				cluster_misses += UpdateCache(&indices[j * 3], cache_time, time);
+				cluster_triangles++;
+
+				if ((float)cluster_misses / cluster_triangles <= cluster_threshold) {
+					clusters.push_back(start);
+
+					start = j + 1;
+					cluster_misses = 0;
+					cluster_triangles = 0;
+					time += CACHE_SIZE + 1;
+				}
+			}
+
+			if (start != end) {
+				clusters.push_back(start);
+			}
+		}
+
+		clusters.push_back(triangle_count);
+
+		// Clusters whose area weighted centroid lies furthest along their
+		// normal tend to occlude the rest of the mesh.
+		glm::vec3 mesh_centroid{ 0.0f };
+		float mesh_area = 0.0f;
+
+		std::vector<glm::vec3> cluster_centroids(clusters.size() - 1, glm::vec3{ 0.0f });
+		std::vector<glm::vec3> cluster_normals(clusters.size() - 1, glm::vec3{ 0.0f });
+
+		for (uint32_t i = 0; i + 1 < clusters.size(); i++) {
+			float cluster_area = 0.0f;
+
+			for (uint32_t j = clusters.at(i); j < clusters.at(i + 1); j++) {
+				const glm::vec3& a = vertices.at(indices[j * 3 + 0]).position;
+				const glm::vec3& b = vertices.at(indices[j * 3 + 1]).position;
+				const glm::vec3& c = vertices.at(indices[j * 3 + 2]).position;
+
+				glm::vec3 normal = glm::cross(b - a, c - a);
+				float area = glm::length(normal);
+
+				cluster_centroids.at(i) += (a + b + c) * (area / 3.0f);
+				cluster_normals.at(i) += normal;
+				cluster_area += area;
+			}
+
+			mesh_centroid += cluster_centroids.at(i);
+			mesh_area += cluster_area;
+
+			if (cluster_area > 0.0f) {
+				cluster_centroids.at(i) /= cluster_area;
+			}
+		}
+
+		if (mesh_area > 0.0f) {
+			mesh_centroid /= mesh_area;
+		}
+
+		std::vector<float> sort_keys(clusters.size() - 1, 0.0f);
+		std::vector<uint32_t> order(clusters.size() - 1);
+
+		for (uint32_t i = 0; i < order.size(); i++) {
+			float normal_length = glm::length(cluster_normals.at(i));
+			if (normal_length > 0.0f) {
+				sort_keys.at(i) = glm::dot(
+					cluster_centroids.at(i) - mesh_centroid,
+					cluster_normals.at(i) / normal_length
+				);
+			}
+
+			order.at(i) = i;
+		}
+
+		std::stable_sort(
+			order.begin(),
+			order.end(),
+			[&sort_keys](uint32_t a, uint32_t b) {
+				return sort_keys.at(a) > sort_keys.at(b);
+			}
+		);
+
+		std::vector<uint32_t> result = {};
+		result.reserve(indices.size());
+
+		for (uint32_t cluster : order) {
+			result.insert(
+				result.end(),
+				indices.begin() + clusters.at(cluster) * 3,
+				indices.begin() + clusters.at(cluster + 1) * 3
+			);
+		}
+
+		indices = std::move(result);
+	}
+
+	void MeshOptimizer::OptimizeVertexFetch(
+		std::vector<Vertex>& vertices,
+		std::vector<uint32_t>& indices
+	) {
+		std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+		std::vector<Vertex> result = {};
+
+		result.reserve(vertices.size());
+
+		for (uint32_t& index : indices) {
+			if (remap.at(index) == UINT32_MAX) {
+				remap.at(index) = result.size();
+				result.push_back(vertices.at(index));
+			}
+
+			index = remap.at(index);
+		}
+
+		vertices = std::move(result);
+	}
+
+
+	void MeshOptimizer::BuildMeshlets(
+		ModelData& data,
+		uint32_t max_vertices,
+		uint32_t max_triangles
+	) {
+		YIB_PROFILE_FUNCTION();
+
+		data.meshlets.clear();
+
+		uint32_t index_count = data.lods.empty() ? data.indices.size() : data.lods.at(0).index_count;
+		if (index_count == 0) {
+			return;
+		}
+
+		// Which meshlet last counted each vertex, saves clearing a set for
+		// every meshlet.
+		std::vector<uint32_t> vertex_meshlets(data.vertices.size(), UINT32_MAX);
+
+		Meshlet meshlet = {};
+		uint32_t vertex_count = 0;
+
+		for (uint32_t i = 0; i < index_count; i += 3) {
+			uint32_t meshlet_index = data.meshlets.size();
+			uint32_t new_vertices = 0;
+
+			for (uint32_t corner = 0; corner < 3; corner++) {
+				uint32_t vertex = data.indices.at(i + corner);
+
+				bool repeated = (corner > 0 && vertex == data.indices.at(i)) ||
+					(corner > 1 && vertex == data.indices.at(i + 1));
+
+				if (vertex_meshlets.at(vertex) != meshlet_index && !repeated) {
+					new_vertices++;
+				}
+			}
+
+			if (vertex_count + new_vertices > max_vertices || meshlet.index_count / 3 >= max_triangles) {
+				ComputeMeshletBounds(data.vertices, data.indices, meshlet);
+				data.meshlets.push_back(meshlet);
+
+				meshlet = {};
+				meshlet.first_index = i;
+				vertex_count = 0;
+				meshlet_index++;
+			}
+
+			for (uint32_t corner = 0; corner < 3; corner++) {
+				uint32_t vertex = data.indices.at(i + corner);
+
+				if (vertex_meshlets.at(vertex) != meshlet_index) {
+					vertex_meshlets.at(vertex) = meshlet_index;
+					vertex_count++;
+				}
+			}
+
+			meshlet.index_count += 3;
+		}
+
+		ComputeMeshletBounds(data.vertices, data.indices, meshlet);
+		data.meshlets.push_back(meshlet);
+	}
+
+
+	std::vector<uint32_t> MeshOptimizer::Simplify(
+		const std::vector<Vertex>& vertices,
+		const std::vector<uint32_t>& indices,
+		uint32_t target_index_count,
+		float& error
+	) {
+		YIB_PROFILE_FUNCTION();
+
+		error = 0.0f;
+
+		std::vector<uint32_t> result = indices;
+		if (result.size() <= target_index_count) {
+			return result;
+		}
+
+		uint32_t vertex_count = vertices.size();
+		std::vector<bool> locked(vertex_count, false);
+
+		// Vertices sharing a position only differ in their normal or uv.
+		// Normal splits are welded and collapse together, a hard edge only
+		// changes shading. Uv seams stay locked, moving one side would open
+		// a crack in the texture.
+		std::unordered_map<PositionKey, uint32_t, PositionKeyHash> position_vertices = {};
+		std::unordered_set<PositionKey, PositionKeyHash> uv_seams = {};
+		std::vector<PositionKey> position_keys(vertex_count);
+
+		for (uint32_t i = 0; i < vertex_count; i++) {
+			const glm::vec3& position = vertices.at(i).position;
+
+			position_keys.at(i).x = std::bit_cast<uint32_t>(position.x);
+			position_keys.at(i).y = std::bit_cast<uint32_t>(position.y);
+			position_keys.at(i).z = std::bit_cast<uint32_t>(position.z);
+
+			uint32_t first = position_vertices.try_emplace(position_keys.at(i), i).first->second;
+			if (vertices.at(i).uv != vertices.at(first).uv) {
+				uv_seams.insert(position_keys.at(i));
+			}
+		}
+
+		// Topology is tracked on the welded vertices, the result keeps the
+		// original ones.
+		std::vector<uint32_t> welded_vertex(vertex_count);
+		std::vector<uint32_t> first_copy(vertex_count + 1, 0);
+
+		for (uint32_t i = 0; i < vertex_count; i++) {
+			if (uv_seams.contains(position_keys.at(i))) {
+				welded_vertex.at(i) = i;
+				locked.at(i) = true;
+			} else {
+				welded_vertex.at(i) = position_vertices.at(position_keys.at(i));
+			}
+
+			first_copy.at(welded_vertex.at(i) + 1)++;
+		}
+
+		for (uint32_t i = 0; i < vertex_count; i++) {
+			first_copy.at(i + 1) += first_copy.at(i);
+		}
+
+		std::vector<uint32_t> copies(vertex_count);
+		std::vector<uint32_t> next_copy = first_copy;
+
+		for (uint32_t i = 0; i < vertex_count; i++) {
+			copies.at(next_copy.at(welded_vertex.at(i))++) = i;
+		}
+
+		std::vector<uint32_t> welded(result.size());
+
+		for (uint32_t i = 0; i < result.size(); i++) {
+			welded.at(i) = welded_vertex.at(result.at(i));
+		}
+
+		// An edge without its opposite is on an open border.
+		std::unordered_set<uint64_t> edges = {};
+		edges.reserve(welded.size());
+
+		for (uint32_t i = 0; i < welded.size(); i++) {
+			uint32_t a = welded.at(i);
+			uint32_t b = welded.at(i - i % 3 + (i + 1) % 3);
+
+			edges.insert((uint64_t)a << 32 | b);
+		}
+
+		for (uint32_t i = 0; i < welded.size(); i++) {
+			uint32_t a = welded.at(i);
+			uint32_t b = welded.at(i - i % 3 + (i + 1) % 3);
+
+			if (!edges.contains((uint64_t)b << 32 | a)) {
+				locked.at(a) = true;
+				locked.at(b) = true;
+			}
+		}
+
+		std::vector<Quadric> quadrics(vertex_count);
+
+		for (uint32_t i = 0; i < welded.size(); i += 3) {
+			const glm::vec3& a = vertices.at(welded.at(i + 0)).position;
+			const glm::vec3& b = vertices.at(welded.at(i + 1)).position;
+			const glm::vec3& c = vertices.at(welded.at(i + 2)).position;
+
+			glm::vec3 normal = glm::cross(b - a, c - a);
+			float length = glm::length(normal);
+			if (length <= 0.0f) {
+				continue;
+			}
+
+			normal /= length;
+
+			for (uint32_t corner = 0; corner < 3; corner++) {
+				quadrics.at(welded.at(i + corner)).AddPlane(
+					normal,
+					-glm::dot(normal, a),
+					length * 0.5f
+				);
+			}
+		}
+
+		std::vector<uint32_t> first_triangle(vertex_count + 1);
+		std::vector<uint32_t> triangles = {};
+		std::vector<EdgeCollapse> collapses = {};
+		std::vector<bool> touched(vertex_count);
+		std::vector<uint32_t> remap(vertex_count);
+
+		double max_cost = 0.0;
+
+		// Each pass collapses a batch of independent edges, cheapest first.
+		while (welded.size() > target_index_count) {
+			// Triangles adjacent to each vertex, for the flip test.
+			std::fill(first_triangle.begin(), first_triangle.end(), 0);
+
+			for (uint32_t index : welded) {
+				first_triangle.at(index + 1)++;
+			}
+
+			for (uint32_t i = 0; i < vertex_count; i++) {
+				first_triangle.at(i + 1) += first_triangle.at(i);
+			}
+
+			std::vector<uint32_t> next_triangle = first_triangle;
+			triangles.resize(welded.size());
+
+			for (uint32_t i = 0; i < welded.size(); i++) {
+				triangles.at(next_triangle.at(welded.at(i))++) = i / 3;
+			}
+
+			collapses.clear();
+
+			for (uint32_t i = 0; i < welded.size(); i++) {
+				uint32_t a = welded.at(i);
+				uint32_t b = welded.at(i - i % 3 + (i + 1) % 3);
+
+				for (uint32_t direction = 0; direction < 2; direction++) {
+					EdgeCollapse collapse = {};
+					collapse.from = direction == 0 ? a : b;
+					collapse.to = direction == 0 ? b : a;
+
+					if (locked.at(collapse.from)) {
+						continue;
+					}
+
+					Quadric quadric = quadrics.at(collapse.from);
+					quadric.Add(quadrics.at(collapse.to));
+
+					collapse.cost = quadric.Evaluate(vertices.at(collapse.to).position);
+
+					collapses.push_back(collapse);
+				}
+			}
+
+			std::sort(
+				collapses.begin(),
+				collapses.end(),
+				[](const EdgeCollapse& a, const EdgeCollapse& b) {
+					return a.cost < b.cost;
+				}
+			);
+
+			// A collapse removes about two triangles.
+			uint32_t triangle_count = welded.size() / 3;
+			uint32_t max_collapses = (triangle_count - target_index_count / 3) / 2 + 1;
+			uint32_t collapse_count = 0;
+
+			std::fill(touched.begin(), touched.end(), false);
+
+			for (uint32_t i = 0; i < vertex_count; i++) {
+				remap.at(i) = i;
+			}
+
+			for (const EdgeCollapse& collapse : collapses) {
+				if (collapse_count >= max_collapses) {
+					break;
+				}
+
+				if (touched.at(collapse.from) || touched.at(collapse.to)) {
+					continue;
+				}
+
+				if (CollapseFlips(vertices, welded, first_triangle, triangles, collapse.from, collapse.to)) {
+					continue;
+				}
+
+				// Triangles around a moved vertex change shape, so their other
+				// collapses wait for the next pass.
+				for (uint32_t j = first_triangle.at(collapse.from); j < first_triangle.at(collapse.from + 1); j++) {
+					uint32_t triangle = triangles.at(j);
+
+					for (uint32_t corner = 0; corner < 3; corner++) {
+						touched.at(welded.at(triangle * 3 + corner)) = true;
+					}
+				}
+
+				touched.at(collapse.to) = true;
+
+				remap.at(collapse.from) = collapse.to;
+				quadrics.at(collapse.to).Add(quadrics.at(collapse.from));
+
+				max_cost = std::max(max_cost, collapse.cost);
+				collapse_count++;
+			}
+
+			if (collapse_count == 0) {
+				break;
+			}
+
+			uint32_t write = 0;
+
+			for (uint32_t i = 0; i < welded.size(); i += 3) {
+				uint32_t a = remap.at(welded.at(i + 0));
+				uint32_t b = remap.at(welded.at(i + 1));
+				uint32_t c = remap.at(welded.at(i + 2));
+
+				if (a == b || b == c || a == c) {
+					continue;
+				}
+
+				// A moved corner takes the copy of its target whose normal
+				// is closest to its own, which keeps hard edges hard.
+				for (uint32_t corner = 0; corner < 3; corner++) {
+					uint32_t vertex = result.at(i + corner);
+					uint32_t target = remap.at(welded.at(i + corner));
+
+					if (target != welded.at(i + corner)) {
+						uint32_t best_copy = copies.at(first_copy.at(target));
+						float best_dot = -2.0f;
+
+						for (uint32_t j = first_copy.at(target); j < first_copy.at(target + 1); j++) {
+							float dot = glm::dot(vertices.at(vertex).normal, vertices.at(copies.at(j)).normal);
+							if (dot > best_dot) {
+								best_dot = dot;
+								best_copy = copies.at(j);
+							}
+						}
+
+						vertex = best_copy;
+					}
+
+					result.at(write + corner) = vertex;
+				}
+
+				welded.at(write++) = a;
+				welded.at(write++) = b;
+				welded.at(write++) = c;
+			}
+
+			welded.resize(write);
+			result.resize(write);
+		}
+
+		error = std::sqrt(max_cost);
+
+		return result;
+	}
+
+
+	VertexCacheStats MeshOptimizer::AnalyzeVertexCache(
+		const std::vector<uint32_t>& indices,
+		uint32_t vertex_count
+	) {
+		VertexCacheStats stats = {};
+
+		uint32_t triangle_count = indices.size() / 3;
+		if (triangle_count == 0) {
+			return stats;
+		}
+
+		std::vector<uint32_t> cache_time(vertex_count, 0);
+		std::vector<bool> referenced(vertex_count, false);
+		uint32_t time = CACHE_SIZE + 1;
+		uint32_t misses = 0;
+		uint32_t referenced_count = 0;
+
+		for (uint32_t i = 0; i < triangle_count; i++) {
+			misses += UpdateCache(&indices[i * 3], cache_time, time);
+		}
+
+		for (uint32_t index : indices) {
+			if (!referenced.at(index)) {
+				referenced.at(index) = true;
+				referenced_count++;
+			}
+		}
+
+		stats.acmr = (float)misses / triangle_count;
+		stats.atvr = (float)misses / referenced_count;
+
+		return stats;
+	}
+
+
+	void MeshOptimizer::ComputeMeshletBounds(
+		const std::vector<Vertex>& vertices,
+		const std::vector<uint32_t>& indices,
+		Meshlet& meshlet
+	) {
+		uint32_t last_index = meshlet.first_index + meshlet.index_count;
+
+		glm::vec3 min = vertices.at(indices.at(meshlet.first_index)).position;
+		glm::vec3 max = min;
+
+		for (uint32_t i = meshlet.first_index; i < last_index; i++) {
+			min = glm::min(min, vertices.at(indices.at(i)).position);
+			max = glm::max(max, vertices.at(indices.at(i)).position);
+		}
+
+		meshlet.center = (min + max) * 0.5f;
+		meshlet.radius = 0.0f;
+
+		for (uint32_t i = meshlet.first_index; i < last_index; i++) {
+			meshlet.radius = std::max(
+				meshlet.radius,
+				glm::length(vertices.at(indices.at(i)).position - meshlet.center)
+			);
+		}
+
+		// The cone axis is the mean normal, the cutoff comes from the
+		// normal furthest away from it. Normals follow the counter clockwise
+		// winding OBJ files use.
+		std::vector<glm::vec3> normals = {};
+		glm::vec3 axis{ 0.0f };
+
+		for (uint32_t i = meshlet.first_index; i < last_index; i += 3) {
+			const glm::vec3& a = vertices.at(indices.at(i + 0)).position;
+			const glm::vec3& b = vertices.at(indices.at(i + 1)).position;
+			const glm::vec3& c = vertices.at(indices.at(i + 2)).position;
+
+			glm::vec3 normal = glm::cross(b - a, c - a);
+			float length = glm::length(normal);
+			if (length <= 0.0f) {
+				normals.push_back(glm::vec3{ 0.0f });
+				continue;
+			}
+
+			normals.push_back(normal / length);
+			axis += normal / length;
+		}
+
+		meshlet.cone_apex = meshlet.center;
+		meshlet.cone_axis = glm::vec3{ 0.0f };
+		meshlet.cone_cutoff = 1.0f;
+
+		float axis_length = glm::length(axis);
+		if (axis_length <= 0.0f) {
+			return;
+		}
+
+		axis /= axis_length;
+
+		float min_dot = 1.0f;
+		for (const glm::vec3& normal : normals) {
+			if (glm::length(normal) > 0.0f) {
+				min_dot = std::min(min_dot, glm::dot(axis, normal));
+			}
+		}
+
+		// Normals spread over nearly a hemisphere or more face the camera
+		// from almost anywhere, such clusters are never cone culled.
+		if (min_dot <= 0.1f) {
+			return;
+		}
+
+		// Moves the apex back until every triangle plane lies in front of
+		// it, which keeps the test conservative for the whole cluster.
+		float max_t = 0.0f;
+
+		for (uint32_t i = meshlet.first_index; i < last_index; i += 3) {
+			const glm::vec3& normal = normals.at((i - meshlet.first_index) / 3);
+			if (glm::length(normal) <= 0.0f) {
+				continue;
+			}
+
+			const glm::vec3& a = vertices.at(indices.at(i)).position;
+
+			float t = glm::dot(meshlet.center - a, normal) / glm::dot(axis, normal);
+			max_t = std::max(max_t, t);
+		}
+
+		meshlet.cone_apex = meshlet.center - axis * max_t;
+		meshlet.cone_axis = axis;
+		meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+	}
+
+	bool MeshOptimizer::CollapseFlips(
+		const std::vector<Vertex>& vertices,
+		const std::vector<uint32_t>& indices,
+		const std::vector<uint32_t>& first_triangle,
+		const std::vector<uint32_t>& triangles,
+		uint32_t from,
+		uint32_t to
+	) {
+		const glm::vec3& target = vertices.at(to).position;
+
+		for (uint32_t i = first_triangle.at(from); i < first_triangle.at(from + 1); i++) {
+			const uint32_t* triangle = &indices.at(triangles.at(i) * 3);
+
+			// Triangles on the collapsed edge disappear.
+			if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+				continue;
+			}
+
+			glm::vec3 positions[3] = {};
+			glm::vec3 moved[3] = {};
+
+			for (uint32_t corner = 0; corner < 3; corner++) {
+				positions[corner] = vertices.at(triangle[corner]).position;
+				moved[corner] = triangle[corner] == from ? target : positions[corner];
+			}
+
+			glm::vec3 normal = glm::cross(positions[1] - positions[0], positions[2] - positions[0]);
+			glm::vec3 moved_normal = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+
+			if (glm::dot(normal, moved_normal) <= 0.0f) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+
+	uint32_t MeshOptimizer::UpdateCache(
+		const uint32_t* triangle,
+		std::vector<uint32_t>& cache_time,
+		uint32_t& time
+	) {
+		uint32_t misses = 0;
+
+		for (uint32_t corner = 0; corner < 3; corner++) {
+			uint32_t vertex = triangle[corner];
+
+			if (time - cache_time[vertex] > CACHE_SIZE) {
+				cache_time[vertex] = time;
+				time++;
+				misses++;
+			}
+		}
+
+		return misses;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "model.h"
+
+namespace yib {
+	struct VertexCacheStats {
+		// Cache misses per triangle, 0.5 is the best a regular grid gets.
+		float acmr = 0.0f;
+		// Cache misses per referenced vertex, 1.0 means every vertex is
+		// transformed once.
+		float atvr = 0.0f;
+	};
+
+	// Reorders indexed meshes so the gpu transforms, shades and fetches
+	// less of them.
+	class MeshOptimizer {
+	public:
+		// Modeled as a fifo, which is close enough for current hardware.
+		static const uint32_t CACHE_SIZE = 16;
+
+		// Runs the vertex cache, overdraw and vertex fetch passes in order,
+		// the result can be handed straight to Model. Has to run before
+		// GenerateLods.
+		static void Optimize(
+			ModelData& data,
+			float overdraw_threshold = 1.05f
+		);
+		// Appends successively simplified copies of the indices, each with
+		// about reduction times the triangles of the one before. Stops early
+		// once the mesh stops shrinking.
+		static void GenerateLods(
+			ModelData& data,
+			uint32_t max_lod_count = 4,
+			float reduction = 0.5f
+		);
+		// Cuts the finest lod into runs of consecutive triangles touching at
+		// most max_vertices vertices, so it should already be in vertex
+		// cache order.
+		static void BuildMeshlets(
+			ModelData& data,
+			uint32_t max_vertices = 64,
+			uint32_t max_triangles = 124
+		);
+
+		// Tipsify, reorders triangles so neighbours hit the post-transform
+		// cache.
+		static void OptimizeVertexCache(
+			std::vector<uint32_t>& indices,
+			uint32_t vertex_count
+		);
+		// Splits the cache ordered triangles into clusters and draws the
+		// outward facing ones first. A cluster may raise the ACMR up to
+		// threshold times its own.
+		static void OptimizeOverdraw(
+			std::vector<uint32_t>& indices,
+			const std::vector<Vertex>& vertices,
+			float threshold
+		);
+		// Moves vertices into the order they are first referenced in and
+		// drops unreferenced ones.
+		static void OptimizeVertexFetch(
+			std::vector<Vertex>& vertices,
+			std::vector<uint32_t>& indices
+		);
+
+		// Quadric error edge collapse towards target_index_count, vertices
+		// only ever move onto existing ones so the result indexes the same
+		// vertices. Vertices on uv seams and open borders never move.
+		// error receives the largest distance a collapse introduced.
+		static std::vector<uint32_t> Simplify(
+			const std::vector<Vertex>& vertices,
+			const std::vector<uint32_t>& indices,
+			uint32_t target_index_count,
+			float& error
+		);
+
+		static VertexCacheStats AnalyzeVertexCache(
+			const std::vector<uint32_t>& indices,
+			uint32_t vertex_count
+		);
+	private:
+		// Bounding sphere and normal cone of one meshlet's triangles.
+		static void ComputeMeshletBounds(
+			const std::vector<Vertex>& vertices,
+			const std::vector<uint32_t>& indices,
+			Meshlet& meshlet
+		);
+		static bool CollapseFlips(
+			const std::vector<Vertex>& vertices,
+			const std::vector<uint32_t>& indices,
+			const std::vector<uint32_t>& first_triangle,
+			const std::vector<uint32_t>& triangles,
+			uint32_t from,
+			uint32_t to
+		);
+
+		// Returns the number of misses, cache_time holds when each vertex
+		// entered the cache.
+		static uint32_t UpdateCache(
+			const uint32_t* triangle,
+			std::vector<uint32_t>& cache_time,
+			uint32_t& time
+		);
+	};
+}
\ No newline at end of file
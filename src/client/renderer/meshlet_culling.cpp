@@ -0,0 +1,462 @@
+#include "meshlet_culling.h"
+
+#include "swapchain.h"
+
+#include <cstddef>
+
+namespace yib {
+	MeshletCulling::MeshletCulling(Device& device) : device(device), success(false) {
+		// The std430 offsets of the Meshlet and Object structs in
+		// meshlet_cull.comp, vec3 members are aligned to 16 bytes.
+		static_assert(offsetof(Meshlet, center) == 0);
+		static_assert(offsetof(Meshlet, radius) == 12);
+		static_assert(offsetof(Meshlet, cone_apex) == 16);
+		static_assert(offsetof(Meshlet, cone_cutoff) == 28);
+		static_assert(offsetof(Meshlet, cone_axis) == 32);
+		static_assert(offsetof(Meshlet, first_index) == 44);
+		static_assert(offsetof(Meshlet, index_count) == 48);
+		static_assert(sizeof(Meshlet) == 64);
+
+		static_assert(offsetof(MeshletObject, model_matrix) == 0);
+		static_assert(offsetof(MeshletObject, camera_position) == 64);
+		static_assert(offsetof(MeshletObject, first_index) == 80);
+		static_assert(sizeof(MeshletObject) == 96);
+
+		static_assert(offsetof(PushConstant, first_object) == 64);
+		static_assert(offsetof(PushConstant, short_indices) == 68);
+
+		if (!CreateDescriptors()) {
+			return;
+		}
+
+		if (!CreatePipeline()) {
+			return;
+		}
+
+		this->frames.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+
+		this->success = true;
+	}
+
+	MeshletCulling::~MeshletCulling() { }
+
+
+	bool MeshletCulling::Prepare(
+		uint32_t frame_index,
+		const glm::mat4& projection_view,
+		const glm::vec3& camera_position,
+		const std::vector<Instance>& instances
+	) {
+		if (!RetireModelSets()) {
+			return false;
+		}
+
+		this->frames.at(frame_index).batches.clear();
+
+		if (instances.empty()) {
+			return true;
+		}
+
+		this->objects.clear();
+		this->instances.clear();
+		this->draws.clear();
+
+		std::vector<Batch> batches = {};
+		const Model* batch_model = nullptr;
+		uint32_t index_count = 0;
+
+		for (uint32_t i = 0; i < instances.size(); i++) {
+			const Instance& instance = instances.at(i);
+
+			if (instance.model != batch_model) {
+				batch_model = instance.model;
+
+				Batch batch = {};
+				batch.meshlet_count = instance.model->GetMeshletCount();
+				batch.push_constant.projection_view = projection_view;
+				batch.push_constant.first_object = i;
+				batch.push_constant.short_indices = instance.model->GetIndexType() == VK_INDEX_TYPE_UINT16;
+
+				if (!GetModelSet(*instance.model, batch.model_set)) {
+					return false;
+				}
+
+				batches.push_back(batch);
+			}
+
+			batches.back().object_count++;
+
+			MeshletObject object = {};
+			object.model_matrix = instance.model_matrix;
+			object.camera_position = glm::inverse(instance.model_matrix) * glm::vec4(camera_position, 1.0f);
+			object.first_index = index_count;
+
+			CullInstance cull_instance = {};
+			cull_instance.model_matrix = instance.model_matrix;
+			cull_instance.texture_index = instance.texture_index;
+
+			// The shader adds the indices of every surviving meshlet.
+			VkDrawIndexedIndirectCommand draw = {};
+			draw.indexCount = 0;
+			draw.instanceCount = 1;
+			draw.firstIndex = index_count;
+			draw.vertexOffset = 0;
+			draw.firstInstance = this->device.SupportsMultiDrawIndirect() ? i : 0;
+
+			this->objects.push_back(object);
+			this->instances.push_back(cull_instance);
+			this->draws.push_back(draw);
+
+			index_count += instance.model->GetLod(0).index_count;
+		}
+
+		if (!ReserveFrame(frame_index, instances.size(), index_count)) {
+			return false;
+		}
+
+		Frame& frame = this->frames.at(frame_index);
+
+		// The frame's fence was waited on before recording began, so the gpu
+		// is done reading these and the submit makes the writes visible.
+		if (
+			!frame.object_buffer->Write((void*)this->objects.data(), sizeof(MeshletObject) * this->objects.size()) ||
+			!frame.instance_buffer->Write((void*)this->instances.data(), sizeof(CullInstance) * this->instances.size()) ||
+			!frame.draw_buffer->Write((void*)this->draws.data(), GpuCulling::DRAW_STRIDE * this->draws.size())
+		) {
+			return false;
+		}
+
+		frame.object_buffer->Flush();
+		frame.instance_buffer->Flush();
+		frame.draw_buffer->Flush();
+
+		frame.batches = std::move(batches);
+
+		return true;
+	}
+
+	void MeshletCulling::Dispatch(
+		VkCommandBuffer command_buffer,
+		uint32_t frame_index
+	) const {
+		const Frame& frame = this->frames.at(frame_index);
+		if (frame.batches.empty()) {
+			return;
+		}
+
+		this->pipeline->BindCommandBuffer(command_buffer);
+
+		vkCmdBindDescriptorSets(
+			command_buffer,
+			VK_PIPELINE_BIND_POINT_COMPUTE,
+			this->pipeline->GetPipelineLayout(),
+			0,
+			1,
+			&frame.descriptor_set,
+			0,
+			nullptr
+		);
+
+		for (const Batch& batch : frame.batches) {
+			vkCmdBindDescriptorSets(
+				command_buffer,
+				VK_PIPELINE_BIND_POINT_COMPUTE,
+				this->pipeline->GetPipelineLayout(),
+				1,
+				1,
+				&batch.model_set,
+				0,
+				nullptr
+			);
+
+			vkCmdPushConstants(
+				command_buffer,
+				this->pipeline->GetPipelineLayout(),
+				VK_SHADER_STAGE_COMPUTE_BIT,
+				0,
+				sizeof(PushConstant),
+				&batch.push_constant
+			);
+
+			vkCmdDispatch(
+				command_buffer,
+				batch.meshlet_count,
+				batch.object_count,
+				1
+			);
+		}
+	}
+
+
+	VkBuffer MeshletCulling::GetDrawBuffer(uint32_t frame_index) const {
+		const Frame& frame = this->frames.at(frame_index);
+		if (frame.draw_buffer == nullptr) {
+			return VK_NULL_HANDLE;
+		}
+
+		return frame.draw_buffer->GetBuffer();
+	}
+
+	VkBuffer MeshletCulling::GetIndexBuffer(uint32_t frame_index) const {
+		const Frame& frame = this->frames.at(frame_index);
+		if (frame.index_buffer == nullptr) {
+			return VK_NULL_HANDLE;
+		}
+
+		return frame.index_buffer->GetBuffer();
+	}
+
+	VkBuffer MeshletCulling::GetInstanceBuffer(uint32_t frame_index) const {
+		const Frame& frame = this->frames.at(frame_index);
+		if (frame.instance_buffer == nullptr) {
+			return VK_NULL_HANDLE;
+		}
+
+		return frame.instance_buffer->GetBuffer();
+	}
+
+
+	bool MeshletCulling::CreateDescriptors() {
+		DescriptorSetLayout::Builder frame_layout_builder = DescriptorSetLayout::Builder(this->device);
+
+		for (uint32_t binding = 0; binding < 3; binding++) {
+			frame_layout_builder.AddBinding(
+				binding,
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_COMPUTE_BIT
+			);
+		}
+
+		this->frame_set_layout = frame_layout_builder.Build();
+		if (!this->frame_set_layout->success) {
+			return false;
+		}
+
+		DescriptorSetLayout::Builder model_layout_builder = DescriptorSetLayout::Builder(this->device);
+
+		for (uint32_t binding = 0; binding < 2; binding++) {
+			model_layout_builder.AddBinding(
+				binding,
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_COMPUTE_BIT
+			);
+		}
+
+		this->model_set_layout = model_layout_builder.Build();
+		if (!this->model_set_layout->success) {
+			return false;
+		}
+
+		DescriptorPool::Builder pool_builder = DescriptorPool::Builder(this->device);
+
+		pool_builder.SetMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT);
+		pool_builder.AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT * 3);
+
+		this->descriptor_pool = pool_builder.Build();
+		if (!this->descriptor_pool->success) {
+			return false;
+		}
+
+		this->model_sets = std::make_unique<DescriptorCache>(this->device);
+		if (!this->model_sets->success) {
+			return false;
+		}
+
+		this->model_generation = Model::GetGeneration();
+
+		return true;
+	}
+
+	bool MeshletCulling::CreatePipeline() {
+		VkPushConstantRange push_constant_range = {};
+
+		push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		push_constant_range.offset = 0;
+		push_constant_range.size = sizeof(PushConstant);
+
+		this->pipeline = std::make_unique<ComputePipeline>(
+			this->device,
+			"D:/documents/projects/Yibengine/src/client/shaders/meshlet_cull.comp.spv",
+			std::vector<VkDescriptorSetLayout>{
+				this->frame_set_layout->GetDescriptorSetLayout(),
+				this->model_set_layout->GetDescriptorSetLayout()
+			},
+			std::vector<VkPushConstantRange>{ push_constant_range }
+		);
+		if (!this->pipeline->success) {
+			return false;
+		}
+
+		return true;
+	}
+
+
+	bool MeshletCulling::ReserveFrame(
+		uint32_t frame_index,
+		uint32_t object_count,
+		uint32_t index_count
+	) {
+		Frame& frame = this->frames.at(frame_index);
+
+		bool objects_fit = frame.object_buffer != nullptr && frame.object_buffer->GetInstanceCount() >= object_count;
+		bool indices_fit = frame.index_buffer != nullptr && frame.index_buffer->GetInstanceCount() >= index_count;
+		if (objects_fit && indices_fit) {
+			return true;
+		}
+
+		if (!objects_fit) {
+			uint32_t capacity = 16;
+			while (capacity < object_count) {
+				capacity *= 2;
+			}
+
+			frame.object_buffer = std::make_unique<Buffer>(
+				this->device,
+				sizeof(MeshletObject),
+				capacity,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+			);
+			frame.draw_buffer = std::make_unique<Buffer>(
+				this->device,
+				GpuCulling::DRAW_STRIDE,
+				capacity,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+			);
+			frame.instance_buffer = std::make_unique<Buffer>(
+				this->device,
+				sizeof(CullInstance),
+				capacity,
+				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+			);
+
+			if (
+				!frame.object_buffer->success || !frame.object_buffer->Map() ||
+				!frame.draw_buffer->success || !frame.draw_buffer->Map() ||
+				!frame.instance_buffer->success || !frame.instance_buffer->Map()
+			) {
+				frame.object_buffer = nullptr;
+				frame.draw_buffer = nullptr;
+				frame.instance_buffer = nullptr;
+				return false;
+			}
+		}
+
+		if (!indices_fit) {
+			uint32_t capacity = 4096;
+			while (capacity < index_count) {
+				capacity *= 2;
+			}
+
+			frame.index_buffer = std::make_unique<Buffer>(
+				this->device,
+				sizeof(uint32_t),
+				capacity,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+			);
+			if (!frame.index_buffer->success) {
+				frame.index_buffer = nullptr;
+				return false;
+			}
+		}
+
+		if (frame.object_buffer == nullptr || frame.index_buffer == nullptr) {
+			return false;
+		}
+
+		VkDescriptorBufferInfo object_info = frame.object_buffer->DescriptorInfo();
+		VkDescriptorBufferInfo draw_info = frame.draw_buffer->DescriptorInfo();
+		VkDescriptorBufferInfo index_info = frame.index_buffer->DescriptorInfo();
+
+		DescriptorWriter writer = DescriptorWriter(
+			*this->frame_set_layout,
+			*this->descriptor_pool
+		);
+
+		if (
+			!writer.WriteBuffer(0, &object_info) ||
+			!writer.WriteBuffer(1, &draw_info) ||
+			!writer.WriteBuffer(2, &index_info)
+		) {
+			return false;
+		}
+
+		if (frame.descriptor_set == VK_NULL_HANDLE) {
+			return writer.Build(frame.descriptor_set);
+		}
+
+		writer.Overwrite(frame.descriptor_set);
+
+		return true;
+	}
+
+	bool MeshletCulling::RetireModelSets() {
+		// Prepare runs once per frame after the frame's slot was waited on,
+		// so a cache retired this many frames ago is no longer in use.
+		std::vector<RetiredSets>::iterator it = this->retired_model_sets.begin();
+
+		while (it != this->retired_model_sets.end()) {
+			if (it->frames_left > 0) {
+				it->frames_left--;
+				it++;
+				continue;
+			}
+
+			it = this->retired_model_sets.erase(it);
+		}
+
+		uint64_t generation = Model::GetGeneration();
+		if (generation == this->model_generation) {
+			return true;
+		}
+
+		RetiredSets retired = {};
+		retired.model_sets = std::move(this->model_sets);
+		retired.frames_left = SwapChain::MAX_FRAMES_IN_FLIGHT;
+
+		this->retired_model_sets.push_back(std::move(retired));
+
+		this->model_sets = std::make_unique<DescriptorCache>(this->device);
+		if (!this->model_sets->success) {
+			return false;
+		}
+
+		this->model_generation = generation;
+
+		return true;
+	}
+
+	bool MeshletCulling::GetModelSet(
+		const Model& model,
+		VkDescriptorSet& set
+	) {
+		VkDescriptorBufferInfo meshlet_info = {};
+
+		meshlet_info.buffer = model.GetMeshletBuffer();
+		meshlet_info.offset = 0;
+		meshlet_info.range = VK_WHOLE_SIZE;
+
+		VkDescriptorBufferInfo index_info = {};
+
+		index_info.buffer = model.GetIndexBuffer();
+		index_info.offset = 0;
+		index_info.range = VK_WHOLE_SIZE;
+
+		DescriptorWriter writer = DescriptorWriter(
+			*this->model_set_layout,
+			*this->model_sets
+		);
+
+		if (
+			!writer.WriteBuffer(0, &meshlet_info) ||
+			!writer.WriteBuffer(1, &index_info)
+		) {
+			return false;
+		}
+
+		return writer.Build(set);
+	}
+}
\ No newline at end of file
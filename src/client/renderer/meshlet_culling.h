@@ -0,0 +1,139 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include "model.h"
+#include "device.h"
+#include "buffer.h"
+#include "gpu_culling.h"
+#include "descriptors.h"
+#include "compute_pipeline.h"
+
+namespace yib {
+	// Matches the Object struct in meshlet_cull.comp, std430 layout.
+	struct MeshletObject {
+		glm::mat4 model_matrix{ 1.0f };
+		// In model space, where the meshlet cones are.
+		glm::vec4 camera_position{ 0.0f };
+		// Where the object's surviving indices start in the index buffer.
+		uint32_t first_index = 0;
+		uint32_t padding[3] = {};
+	};
+
+	// Culls the meshlets of visible objects against the frustum and their
+	// normal cones on the gpu, and appends the indices of the survivors to
+	// one index buffer. Each object gets one indexed draw and one instance,
+	// both at the object's position in the list given to Prepare. With
+	// multi draw indirect every draw also points firstInstance at its
+	// instance, so the draws of one model go out in a single call.
+	class MeshletCulling {
+	public:
+		struct Instance {
+			const Model* model = nullptr;
+			glm::mat4 model_matrix{ 1.0f };
+			uint32_t texture_index = 0;
+		};
+
+		MeshletCulling(Device& device);
+		~MeshletCulling();
+
+		MeshletCulling(const MeshletCulling&) = delete;
+		MeshletCulling& operator=(const MeshletCulling&) = delete;
+
+		// Instances of the same model have to follow each other. May replace
+		// the frame's buffers.
+		bool Prepare(
+			uint32_t frame_index,
+			const glm::mat4& projection_view,
+			const glm::vec3& camera_position,
+			const std::vector<Instance>& instances
+		);
+		// Has to be recorded outside of a render pass. The draws and indices
+		// are written by a compute shader, readers have to wait on it.
+		void Dispatch(
+			VkCommandBuffer command_buffer,
+			uint32_t frame_index
+		) const;
+
+		// Null until the frame first culled something.
+		VkBuffer GetDrawBuffer(uint32_t frame_index) const;
+		VkBuffer GetIndexBuffer(uint32_t frame_index) const;
+		VkBuffer GetInstanceBuffer(uint32_t frame_index) const;
+
+		static constexpr uint32_t WORKGROUP_SIZE = 64;
+
+		bool success;
+	private:
+		struct PushConstant {
+			glm::mat4 projection_view{ 1.0f };
+			uint32_t first_object = 0;
+			// Set when the model's indices are 16 bit.
+			uint32_t short_indices = 0;
+		};
+
+		// Objects sharing a model are culled by one dispatch, one workgroup
+		// per meshlet and object.
+		struct Batch {
+			VkDescriptorSet model_set = VK_NULL_HANDLE;
+			uint32_t meshlet_count = 0;
+			uint32_t object_count = 0;
+			PushConstant push_constant = {};
+		};
+
+		struct Frame {
+			std::unique_ptr<Buffer> object_buffer;
+			std::unique_ptr<Buffer> draw_buffer;
+			std::unique_ptr<Buffer> instance_buffer;
+			std::unique_ptr<Buffer> index_buffer;
+			VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+			std::vector<Batch> batches = {};
+		};
+
+		struct RetiredSets {
+			std::unique_ptr<DescriptorCache> model_sets;
+			uint32_t frames_left = 0;
+		};
+
+		bool CreateDescriptors();
+		bool CreatePipeline();
+
+		bool ReserveFrame(
+			uint32_t frame_index,
+			uint32_t object_count,
+			uint32_t index_count
+		);
+		bool GetModelSet(
+			const Model& model,
+			VkDescriptorSet& set
+		);
+		bool RetireModelSets();
+
+		Device& device;
+
+		std::unique_ptr<DescriptorSetLayout> frame_set_layout;
+		std::unique_ptr<DescriptorSetLayout> model_set_layout;
+		std::unique_ptr<DescriptorPool> descriptor_pool;
+		// Models never change their buffers, so their sets are built once.
+		// Once any model is destroyed its handles may be reused, so the cache
+		// is replaced and the old one kept until no frame in flight can
+		// still bind its sets.
+		std::unique_ptr<DescriptorCache> model_sets;
+		std::vector<RetiredSets> retired_model_sets = {};
+		uint64_t model_generation = 0;
+		std::unique_ptr<ComputePipeline> pipeline;
+
+		std::vector<MeshletObject> objects = {};
+		std::vector<CullInstance> instances = {};
+		std::vector<VkDrawIndexedIndirectCommand> draws = {};
+
+		std::vector<Frame> frames;
+	};
+}
\ No newline at end of file
@@ -1,11 +1,42 @@
 #include "model.h"
 
 #include <cstring>
+#include <unordered_map>
+
+#include "../../shared/profiler.h"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "../../shared/tinyobj/tiny_obj_loader.h"
 
 namespace yib {
+	// An OBJ face corner, corners with the same indices are one vertex.
+	struct ObjCorner {
+		int position = -1;
+		int normal = -1;
+		int uv = -1;
+
+		bool operator==(const ObjCorner& other) const {
+			return this->position == other.position &&
+				this->normal == other.normal &&
+				this->uv == other.uv;
+		}
+	};
+
+	struct ObjCornerHash {
+		size_t operator()(const ObjCorner& corner) const {
+			// FNV-1a over the three indices.
+			uint64_t hash = 14695981039346656037ull;
+
+			for (int index : { corner.position, corner.normal, corner.uv }) {
+				hash ^= (uint32_t)index;
+				hash *= 1099511628211ull;
+			}
+
+			return hash;
+		}
+	};
+
+
 	std::vector<VkVertexInputBindingDescription> Vertex::GetBindingDescription() {
 		std::vector<VkVertexInputBindingDescription> binding_descriptions(1);
 
@@ -17,7 +48,7 @@ namespace yib {
 	}
 
 	std::vector<VkVertexInputAttributeDescription> Vertex::GetAttributeDescriptions() {
-		std::vector<VkVertexInputAttributeDescription> attribute_descriptions(2);
+		std::vector<VkVertexInputAttributeDescription> attribute_descriptions(3);
 
 		attribute_descriptions.at(0).binding = 0;
 		attribute_descriptions.at(0).location = 0;
@@ -29,16 +60,44 @@ namespace yib {
 		attribute_descriptions.at(1).format = VK_FORMAT_R32G32B32_SFLOAT;
 		attribute_descriptions.at(1).offset = offsetof(Vertex, normal);
 
-		attribute_descriptions.at(1).binding = 0;
-		attribute_descriptions.at(1).location = 2;
-		attribute_descriptions.at(1).format = VK_FORMAT_R32G32_SFLOAT;
-		attribute_descriptions.at(1).offset = offsetof(Vertex, uv);
+		attribute_descriptions.at(2).binding = 0;
+		attribute_descriptions.at(2).location = 2;
+		attribute_descriptions.at(2).format = VK_FORMAT_R32G32_SFLOAT;
+		attribute_descriptions.at(2).offset = offsetof(Vertex, uv);
 
 		return attribute_descriptions;
 	}
 
 
+	Bounds Bounds::FromVertices(const std::vector<Vertex>& vertices) {
+		Bounds bounds = {};
+		if (vertices.empty()) {
+			return bounds;
+		}
+
+		bounds.min = vertices.at(0).position;
+		bounds.max = vertices.at(0).position;
+
+		for (const Vertex& vertex : vertices) {
+			bounds.min = glm::min(bounds.min, vertex.position);
+			bounds.max = glm::max(bounds.max, vertex.position);
+		}
+
+		// The box center gives a slightly loose sphere, but only takes one
+		// more pass over the vertices.
+		bounds.center = (bounds.min + bounds.max) * 0.5f;
+
+		for (const Vertex& vertex : vertices) {
+			bounds.radius = glm::max(bounds.radius, glm::length(vertex.position - bounds.center));
+		}
+
+		return bounds;
+	}
+
+
 	std::optional<ModelData> ModelData::LoadModel(const std::string& file) {
+		YIB_PROFILE_FUNCTION();
+
 		std::string warnning, error;
 
 		tinyobj::attrib_t attrib;
@@ -61,8 +120,30 @@ namespace yib {
 		data.vertices = { };
 		data.indices = { };
 
+		size_t corner_count = 0;
+		for (const tinyobj::shape_t& shape : shapes) {
+			corner_count += shape.mesh.indices.size();
+		}
+
+		data.indices.reserve(corner_count);
+
+		std::unordered_map<ObjCorner, uint32_t, ObjCornerHash> corner_vertices = {};
+		corner_vertices.reserve(corner_count);
+
 		for (const tinyobj::shape_t& shape : shapes) {
 			for (const tinyobj::index_t& index : shape.mesh.indices) {
+				ObjCorner corner = {};
+
+				corner.position = index.vertex_index;
+				corner.normal = index.normal_index;
+				corner.uv = index.texcoord_index;
+
+				std::unordered_map<ObjCorner, uint32_t, ObjCornerHash>::iterator it = corner_vertices.find(corner);
+				if (it != corner_vertices.end()) {
+					data.indices.push_back(it->second);
+					continue;
+				}
+
 				Vertex vertex = { };
 
 				if (index.vertex_index >= 0) {
@@ -88,166 +169,404 @@ namespace yib {
 					};
 				}
 
+				uint32_t vertex_index = data.vertices.size();
+
+				corner_vertices.emplace(corner, vertex_index);
+				data.indices.push_back(vertex_index);
 				data.vertices.push_back(vertex);
 			}
 		}
 
+		data.bounds = Bounds::FromVertices(data.vertices);
+
 		return data;
 	}
 
 
+	std::atomic<uint64_t> Model::generation = 0;
+
 	Model::Model(
 		Device& device,
-		ModelData data
-	) : device(device), success(false) {
-		if (!CreateVertexBuffers(data.vertices)) {
+		ModelData data,
+		const VertexLayout& layout
+	) : device(device), layout(layout), success(false) {
+		if (!CreateVertexBuffers(data.vertices, data.bounds)) {
 			return;
 		}
 
-		CreateIndexBuffers(data.indices);
+		if (!data.indices.empty() && !CreateIndexBuffers(data.indices, !data.meshlets.empty())) {
+			return;
+		}
+
+		this->bounds = data.bounds;
+
+		if (this->has_index_buffer && !data.meshlets.empty() && !CreateMeshletBuffer(data.meshlets)) {
+			return;
+		}
+
+		// Without indices only the full vertex range can be drawn.
+		if (this->has_index_buffer && !data.lods.empty()) {
+			this->lods = data.lods;
+		} else {
+			MeshLod lod = {};
+			lod.index_count = this->has_index_buffer ? this->index_count : this->vertex_count;
+
+			this->lods.push_back(lod);
+		}
 
 		this->success = true;
 	}
 
+	Model::~Model() {
+		this->device.GetUploader().Wait(this->upload_token);
+
+		generation++;
+	}
+
+
+	VkDrawIndexedIndirectCommand Model::GetIndirectCommand(uint32_t lod) const {
+		VkDrawIndexedIndirectCommand command = {};
+
+		// Without indices the first four fields line up with
+		// VkDrawIndirectCommand, so both kinds share one stride.
+		command.indexCount = this->lods.at(lod).index_count;
+		command.instanceCount = 0;
+		command.firstIndex = this->lods.at(lod).first_index;
+		command.vertexOffset = 0;
+		command.firstInstance = 0;
+
+		return command;
+	}
+
+	uint32_t Model::GetLodCount() const {
+		return this->lods.size();
+	}
+
+	const MeshLod& Model::GetLod(uint32_t lod) const {
+		return this->lods.at(lod);
+	}
+
+	const Bounds& Model::GetBounds() const {
+		return this->bounds;
+	}
+
+	UploadToken Model::GetUploadToken() const {
+		return this->upload_token;
+	}
+
+	const VertexLayout& Model::GetVertexLayout() const {
+		return this->layout;
+	}
+
+	const VertexDecode& Model::GetVertexDecode() const {
+		return this->decode;
+	}
+
+	uint32_t Model::GetMeshletCount() const {
+		return this->meshlet_count;
+	}
+
+	VkBuffer Model::GetMeshletBuffer() const {
+		if (this->meshlet_buffer == nullptr) {
+			return VK_NULL_HANDLE;
+		}
+
+		return this->meshlet_buffer->GetBuffer();
+	}
+
+	VkBuffer Model::GetIndexBuffer() const {
+		if (this->index_buffer == nullptr) {
+			return VK_NULL_HANDLE;
+		}
+
+		return this->index_buffer->GetBuffer();
+	}
+
+	VkIndexType Model::GetIndexType() const {
+		return this->index_type;
+	}
+
+	uint64_t Model::GetGeneration() {
+		return generation;
+	}
 
-	void Model::Bind(VkCommandBuffer command_buffer) const {
+
+	void Model::Bind(
+		VkCommandBuffer command_buffer,
+		bool bind_indices
+	) const {
+		BindPositions(command_buffer, bind_indices);
+
+		if (this->attribute_buffer != nullptr) {
+			VkBuffer buffers[] = { this->attribute_buffer->GetBuffer() };
+			VkDeviceSize offsets[] = { 0 };
+
+			vkCmdBindVertexBuffers(
+				command_buffer,
+				VertexLayout::ATTRIBUTE_BINDING,
+				1,
+				buffers,
+				offsets
+			);
+		}
+	}
+
+	void Model::BindPositions(
+		VkCommandBuffer command_buffer,
+		bool bind_indices
+	) const {
 		VkBuffer buffers[] = { this->vertex_buffer->GetBuffer() };
 		VkDeviceSize offsets[] = { 0 };
 
 		vkCmdBindVertexBuffers(
 			command_buffer,
-			0,
+			VertexLayout::POSITION_BINDING,
 			1,
 			buffers,
 			offsets
 		);
 
-		if (this->has_index_buffer) {
+		if (this->has_index_buffer && bind_indices) {
 			vkCmdBindIndexBuffer(
 				command_buffer,
 				this->index_buffer->GetBuffer(),
 				0,
-				VK_INDEX_TYPE_UINT32
+				this->index_type
 			);
 		}
 	}
 
-	void Model::Draw(VkCommandBuffer command_buffer) const {
+	void Model::Draw(
+		VkCommandBuffer command_buffer,
+		uint32_t instance_count,
+		uint32_t first_instance
+	) const {
 		if (this->has_index_buffer) {
 			vkCmdDrawIndexed(
 				command_buffer,
-				this->index_count,
-				1,
-				0,
+				this->lods.at(0).index_count,
+				instance_count,
+				this->lods.at(0).first_index,
 				0,
-				0
+				first_instance
 			);
 		} else {
 			vkCmdDraw(
 				command_buffer,
 				this->vertex_count,
-				1,
+				instance_count,
 				0,
-				0
+				first_instance
+			);
+		}
+	}
+
+
+	void Model::DrawIndirect(
+		VkCommandBuffer command_buffer,
+		VkBuffer buffer,
+		VkDeviceSize offset
+	) const {
+		if (this->has_index_buffer) {
+			vkCmdDrawIndexedIndirect(
+				command_buffer,
+				buffer,
+				offset,
+				1,
+				sizeof(VkDrawIndexedIndirectCommand)
+			);
+		} else {
+			vkCmdDrawIndirect(
+				command_buffer,
+				buffer,
+				offset,
+				1,
+				sizeof(VkDrawIndexedIndirectCommand)
 			);
 		}
 	}
 
 
-	bool Model::CreateVertexBuffers(const std::vector<Vertex>& vertices) {
+	bool Model::CreateVertexBuffers(
+		const std::vector<Vertex>& vertices,
+		const Bounds& bounds
+	) {
 		this->vertex_count = vertices.size();
 		if (this->vertex_count < 3) {
 			return false;
 		}
 
-		VkDeviceSize buffer_size = sizeof(vertices[0]) * this->vertex_count;
-		VkDeviceSize vertex_size = sizeof(vertices[0]);
+		// Quantized positions cover the bounding box, flat axes keep a unit
+		// extent so the encoder never divides by zero.
+		if (this->layout.position_format != VertexPositionFormat::FLOAT) {
+			this->decode.position_offset = bounds.min;
+			this->decode.position_scale = bounds.max - bounds.min;
 
-		Buffer staging_buffer = Buffer(
-			this->device,
-			vertex_size,
-			this->vertex_count,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-		);
-		if (!staging_buffer.success) {
+			for (uint32_t i = 0; i < 3; i++) {
+				if (this->decode.position_scale[i] <= 0.0f) {
+					this->decode.position_scale[i] = 1.0f;
+				}
+			}
+		}
+
+		this->decode.octahedral_normals = this->layout.octahedral_normals ? 1 : 0;
+
+		uint32_t position_stride = this->layout.GetPositionStride();
+		uint32_t attribute_stride = this->layout.GetAttributeStride();
+
+		std::vector<uint8_t> position_data(position_stride * this->vertex_count);
+		std::vector<uint8_t> attribute_data(attribute_stride * this->vertex_count);
+
+		for (uint32_t i = 0; i < this->vertex_count; i++) {
+			uint8_t* position = position_data.data() + position_stride * i;
+			uint8_t* attribute = this->layout.separate_positions ?
+				attribute_data.data() + attribute_stride * i :
+				position + this->layout.GetPositionSize();
+
+			this->layout.Pack(
+				vertices.at(i).position,
+				vertices.at(i).normal,
+				vertices.at(i).uv,
+				this->decode,
+				position,
+				attribute
+			);
+		}
+
+		if (!UploadVertexStream(position_data, position_stride, this->vertex_buffer)) {
 			return false;
 		}
 
-		staging_buffer.Map();
-		staging_buffer.Write(
-			(void*)vertices.data()
-		);
+		if (this->layout.separate_positions && !UploadVertexStream(attribute_data, attribute_stride, this->attribute_buffer)) {
+			return false;
+		}
+
+		return true;
+	}
 
-		this->vertex_buffer = std::make_unique<Buffer>(
+	bool Model::UploadVertexStream(
+		const std::vector<uint8_t>& data,
+		uint32_t stride,
+		std::unique_ptr<Buffer>& buffer
+	) {
+		buffer = std::make_unique<Buffer>(
 			this->device,
-			vertex_size,
+			stride,
 			this->vertex_count,
 			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
 		);
-		if (!this->vertex_buffer->success) {
+		if (!buffer->success) {
 			return false;
 		}
-		
-		if (!this->device.CopyBuffer(
-			staging_buffer.GetBuffer(),
-			this->vertex_buffer->GetBuffer(),
-			buffer_size
-		)) {
+
+		std::optional<UploadToken> token = this->device.GetUploader().UploadBuffer(
+			data.data(),
+			data.size(),
+			buffer->GetBuffer()
+		);
+		if (!token.has_value()) {
 			return false;
 		}
 
+		this->upload_token = token.value();
+
 		return true;
 	}
 
 
-	bool Model::CreateIndexBuffers(const std::vector<uint32_t>& indices) {
+	bool Model::CreateIndexBuffers(
+		const std::vector<uint32_t>& indices,
+		bool storage
+	) {
 		this->index_count = indices.size();
 		if (this->index_count < 1) {
 			return false;
 		}
 
-		this->has_index_buffer = true;
+		// Half the index bandwidth whenever every vertex is addressable
+		// with 16 bits.
+		std::vector<uint16_t> short_indices = {};
+		const void* index_data = indices.data();
+		VkDeviceSize index_size = sizeof(uint32_t);
+		VkBufferUsageFlags usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+		uint32_t buffer_index_count = this->index_count;
+
+		if (storage) {
+			usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+		}
+
+		if (this->vertex_count <= UINT16_MAX) {
+			short_indices.assign(
+				indices.begin(),
+				indices.end()
+			);
+
+			// Compute reads 16 bit indices as pairs in 32 bit words, so the
+			// last word has to be whole.
+			if (storage && short_indices.size() % 2 != 0) {
+				short_indices.push_back(0);
+			}
+
+			buffer_index_count = short_indices.size();
+			index_data = short_indices.data();
+			index_size = sizeof(uint16_t);
+			this->index_type = VK_INDEX_TYPE_UINT16;
+		}
 
-		VkDeviceSize buffer_size = sizeof(indices[0]) * this->index_count;
-		VkDeviceSize index_size = sizeof(indices[0]);
+		VkDeviceSize buffer_size = index_size * buffer_index_count;
 
-		Buffer staging_buffer = Buffer(
+		this->index_buffer = std::make_unique<Buffer>(
 			this->device,
 			index_size,
-			this->index_count,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+			buffer_index_count,
+			usage,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
 		);
-		if (!staging_buffer.success) {
+		if (!this->index_buffer->success) {
 			return false;
 		}
 
-		staging_buffer.Map();
-		staging_buffer.Write(
-			(void*)indices.data()
+		std::optional<UploadToken> token = this->device.GetUploader().UploadBuffer(
+			index_data,
+			buffer_size,
+			this->index_buffer->GetBuffer()
 		);
+		if (!token.has_value()) {
+			return false;
+		}
 
-		this->index_buffer = std::make_unique<Buffer>(
+		this->has_index_buffer = true;
+		this->upload_token = token.value();
+
+		return true;
+	}
+
+	bool Model::CreateMeshletBuffer(const std::vector<Meshlet>& meshlets) {
+		this->meshlet_buffer = std::make_unique<Buffer>(
 			this->device,
-			index_size,
-			this->index_count,
-			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			sizeof(Meshlet),
+			meshlets.size(),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
 		);
-		if (!this->index_buffer->success) {
+		if (!this->meshlet_buffer->success) {
 			return false;
 		}
 
-		if (!this->device.CopyBuffer(
-			staging_buffer.GetBuffer(),
-			this->index_buffer->GetBuffer(),
-			buffer_size
-		)) {
+		std::optional<UploadToken> token = this->device.GetUploader().UploadBuffer(
+			meshlets.data(),
+			sizeof(Meshlet) * meshlets.size(),
+			this->meshlet_buffer->GetBuffer()
+		);
+		if (!token.has_value()) {
 			return false;
 		}
 
+		this->meshlet_count = meshlets.size();
+		this->upload_token = token.value();
+
 		return true;
 	}
 }
\ No newline at end of file
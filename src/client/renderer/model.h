@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <cstdint>
 #include <optional>
@@ -12,6 +13,8 @@
 
 #include "device.h"
 #include "buffer.h"
+#include "uploader.h"
+#include "vertex_layout.h"
 
 namespace yib {
 	struct Vertex {
@@ -23,10 +26,51 @@ namespace yib {
 		static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions();
 	};
 
+	struct Bounds {
+		glm::vec3 min{ 0.0f };
+		glm::vec3 max{ 0.0f };
+		glm::vec3 center{ 0.0f };
+		float radius = 0.0f;
+
+		static Bounds FromVertices(const std::vector<Vertex>& vertices);
+	};
+
+	// A range of ModelData::indices drawing the mesh at one level of
+	// detail, all levels share the vertices.
+	struct MeshLod {
+		uint32_t first_index = 0;
+		uint32_t index_count = 0;
+		// Worst case distance to the full detail surface in model space.
+		float error = 0.0f;
+	};
+
+	// A cluster of the finest lod, with the bounds and normal cone
+	// meshlet_cull.comp culls it by. Matches the Meshlet struct there,
+	// std430 layout.
+	struct Meshlet {
+		glm::vec3 center{ 0.0f };
+		float radius = 0.0f;
+		// The cluster faces away from every point inside the cone that
+		// opens backwards from the apex along the axis.
+		glm::vec3 cone_apex{ 0.0f };
+		float cone_cutoff = 1.0f;
+		glm::vec3 cone_axis{ 0.0f };
+		uint32_t first_index = 0;
+		uint32_t index_count = 0;
+		uint32_t padding[3] = {};
+	};
+
 	struct ModelData {
 		std::vector<Vertex> vertices = {};
+		// Narrowed to 16 bits on upload when every vertex fits.
 		std::vector<uint32_t> indices = {};
+		// Finest first, empty means the indices are one full detail level.
+		std::vector<MeshLod> lods = {};
+		std::vector<Meshlet> meshlets = {};
+		Bounds bounds = {};
 
+		// Welds OBJ corners that share position, normal and uv into one
+		// indexed vertex.
 		static std::optional<ModelData> LoadModel(const std::string& file);
 	};
 
@@ -34,24 +78,95 @@ namespace yib {
 	public:
 		Model(
 			Device& device,
-			ModelData data
+			ModelData data,
+			const VertexLayout& layout = {}
 		);
+		~Model();
+
+		// Without indices only the vertex streams are bound, for draws that
+		// read their indices from another buffer.
+		void Bind(
+			VkCommandBuffer command_buffer,
+			bool bind_indices = true
+		) const;
+		// Binds the position stream and indices only, enough for depth
+		// passes when the layout separates positions.
+		void BindPositions(
+			VkCommandBuffer command_buffer,
+			bool bind_indices = true
+		) const;
+		void Draw(
+			VkCommandBuffer command_buffer,
+			uint32_t instance_count = 1,
+			uint32_t first_instance = 0
+		) const;
+		void DrawIndirect(
+			VkCommandBuffer command_buffer,
+			VkBuffer buffer,
+			VkDeviceSize offset
+		) const;
+
+		VkDrawIndexedIndirectCommand GetIndirectCommand(uint32_t lod = 0) const;
+		uint32_t GetLodCount() const;
+		const MeshLod& GetLod(uint32_t lod) const;
+		const Bounds& GetBounds() const;
+		UploadToken GetUploadToken() const;
+		const VertexLayout& GetVertexLayout() const;
+		const VertexDecode& GetVertexDecode() const;
 
-		void Bind(VkCommandBuffer command_buffer) const;
-		void Draw(VkCommandBuffer command_buffer) const;
+		uint32_t GetMeshletCount() const;
+		VkBuffer GetMeshletBuffer() const;
+		// Shaders can only read it when the model has meshlets. 16 bit
+		// indices are packed two to a word, the buffer is padded to whole
+		// words.
+		VkBuffer GetIndexBuffer() const;
+		VkIndexType GetIndexType() const;
+
+		// Changes whenever a model is destroyed. Anything keyed by a model's
+		// buffer handles goes stale with it, since handles get reused.
+		static uint64_t GetGeneration();
 
 		bool success;
 	private:
-		bool CreateVertexBuffers(const std::vector<Vertex>& vertices);
-		bool CreateIndexBuffers(const std::vector<uint32_t>& indices);
+		bool CreateVertexBuffers(
+			const std::vector<Vertex>& vertices,
+			const Bounds& bounds
+		);
+		bool UploadVertexStream(
+			const std::vector<uint8_t>& data,
+			uint32_t stride,
+			std::unique_ptr<Buffer>& buffer
+		);
+		bool CreateIndexBuffers(
+			const std::vector<uint32_t>& indices,
+			bool storage
+		);
+		bool CreateMeshletBuffer(const std::vector<Meshlet>& meshlets);
 
 		Device& device;
 
+		VertexLayout layout = {};
+		VertexDecode decode = {};
+
 		uint32_t vertex_count = 0;
+		// Holds the whole vertex unless the layout separates positions.
 		std::unique_ptr<Buffer> vertex_buffer;
+		std::unique_ptr<Buffer> attribute_buffer;
 
 		bool has_index_buffer = false;
 		uint32_t index_count = 0;
+		VkIndexType index_type = VK_INDEX_TYPE_UINT32;
 		std::unique_ptr<Buffer> index_buffer;
+
+		std::vector<MeshLod> lods = {};
+
+		uint32_t meshlet_count = 0;
+		std::unique_ptr<Buffer> meshlet_buffer;
+
+		Bounds bounds = {};
+
+		UploadToken upload_token = 0;
+
+		static std::atomic<uint64_t> generation;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,165 @@
+#include "offscreen.h"
+
+#include <limits>
+
+namespace yib {
+	OffscreenTarget::OffscreenTarget(
+		Device& device,
+		VkExtent2D extent,
+		FrameSync& frame_sync
+	) :
+		device(device),
+		frame_sync(frame_sync),
+		extent(extent),
+		success(false)
+	{
+		if (!Create()) {
+			return;
+		}
+
+		this->success = true;
+	}
+
+	OffscreenTarget::~OffscreenTarget() {
+		DestroyColorResources();
+	}
+
+
+	VkExtent2D OffscreenTarget::GetExtent() const {
+		return this->extent;
+	}
+
+	uint32_t OffscreenTarget::GetImageCount() const {
+		return this->color_images.size();
+	}
+
+	VkFormat OffscreenTarget::GetColorFormat() const {
+		return this->color_format;
+	}
+
+	VkImage OffscreenTarget::GetColorImage(uint32_t index) const {
+		return this->color_images.at(index);
+	}
+
+	VkImageView OffscreenTarget::GetColorImageView(uint32_t index) const {
+		return this->color_image_views.at(index);
+	}
+
+
+	VkResult OffscreenTarget::GetNextImage(
+		uint32_t frame_index,
+		uint32_t* image_index
+	) {
+		if (!this->frame_sync.WaitForSlot(frame_index)) {
+			return VK_ERROR_DEVICE_LOST;
+		}
+
+		// Every frame slot owns its own color image.
+		*image_index = frame_index;
+
+		return VK_SUCCESS;
+	}
+
+	VkResult OffscreenTarget::SubmitCommandBuffers(
+		uint32_t frame_index,
+		const VkCommandBuffer* buffers,
+		[[maybe_unused]] uint32_t* image_index
+	) {
+		VkSubmitInfo submit_info = {};
+
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.commandBufferCount = 1;
+		submit_info.pCommandBuffers = buffers;
+
+		return this->frame_sync.Submit(
+			this->device.GetGraphicsQueue(),
+			frame_index,
+			submit_info
+		);
+	}
+
+
+	bool OffscreenTarget::Create() {
+		if (!CreateColorResources()) {
+			return false;
+		}
+
+		return true;
+	}
+
+
+	bool OffscreenTarget::CreateColorResources() {
+		this->color_images.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+		this->color_image_views.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+		this->color_image_allocations.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+
+		for (size_t i = 0; i < this->color_images.size(); i++) {
+			VkImageCreateInfo image_info = {};
+
+			image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			image_info.imageType = VK_IMAGE_TYPE_2D;
+			image_info.extent.width = this->extent.width;
+			image_info.extent.height = this->extent.height;
+			image_info.extent.depth = 1;
+			image_info.mipLevels = 1;
+			image_info.arrayLayers = 1;
+			image_info.format = this->color_format;
+			image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+			image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			image_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+			image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+			image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			image_info.flags = 0;
+
+			if (!this->device.CreateImageWithInfo(
+				image_info,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				this->color_image_allocations[i],
+				this->color_images[i]
+			)) {
+				return false;
+			}
+
+			VkImageViewCreateInfo view_info = {};
+
+			view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			view_info.image = this->color_images[i];
+			view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			view_info.format = this->color_format;
+			view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			view_info.subresourceRange.baseMipLevel = 0;
+			view_info.subresourceRange.levelCount = 1;
+			view_info.subresourceRange.baseArrayLayer = 0;
+			view_info.subresourceRange.layerCount = 1;
+
+			if (vkCreateImageView(
+				this->device.GetDevice(),
+				&view_info,
+				nullptr,
+				&this->color_image_views[i]
+			) != VK_SUCCESS) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void OffscreenTarget::DestroyColorResources() {
+		for (size_t i = 0; i < this->color_images.size(); i++) {
+			vkDestroyImageView(
+				this->device.GetDevice(),
+				this->color_image_views[i],
+				nullptr
+			);
+
+			vkDestroyImage(
+				this->device.GetDevice(),
+				this->color_images[i],
+				nullptr
+			);
+
+			this->device.GetAllocator().Free(this->color_image_allocations[i]);
+		}
+	}
+}
\ No newline at end of file
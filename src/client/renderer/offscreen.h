@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "device.h"
+#include "swapchain.h"
+#include "frame_sync.h"
+
+namespace yib {
+	class OffscreenTarget {
+	public:
+		OffscreenTarget(
+			Device& device,
+			VkExtent2D extent,
+			FrameSync& frame_sync
+		);
+		~OffscreenTarget();
+
+		OffscreenTarget(const OffscreenTarget&) = delete;
+		OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+
+		VkExtent2D GetExtent() const;
+		uint32_t GetImageCount() const;
+		VkFormat GetColorFormat() const;
+		VkImage GetColorImage(uint32_t index) const;
+		VkImageView GetColorImageView(uint32_t index) const;
+
+		VkResult GetNextImage(
+			uint32_t frame_index,
+			uint32_t* image_index
+		);
+		VkResult SubmitCommandBuffers(
+			uint32_t frame_index,
+			const VkCommandBuffer* buffers,
+			uint32_t* image_index
+		);
+
+		bool success;
+	private:
+		bool Create();
+
+		bool CreateColorResources();
+		void DestroyColorResources();
+
+		VkExtent2D extent = {};
+
+		VkFormat color_format = VK_FORMAT_R8G8B8A8_SRGB;
+		std::vector<VkImage> color_images = {};
+		std::vector<VkImageView> color_image_views = {};
+		std::vector<Allocation> color_image_allocations = {};
+
+		Device& device;
+		FrameSync& frame_sync;
+	};
+}
\ No newline at end of file
@@ -1,19 +1,251 @@
 #include "pipeline.h"
 
+#include <chrono>
+#include <cstring>
+#include <algorithm>
 #include <iostream>
 #include <filesystem>
 
 #include "model.h"
 #include "../../shared/file.h"
 
+template <typename T>
+static void HashCombine(size_t& seed, const T& value) {
+	seed ^= std::hash<T>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
 namespace yib {
+	void PipelineConfig::UpdatePointers() {
+		this->color_blend_info.attachmentCount = 1;
+		this->color_blend_info.pAttachments = &this->color_blend_attachment;
+
+		this->dynamic_state_info.dynamicStateCount = this->dynamic_states.size();
+		this->dynamic_state_info.pDynamicStates = this->dynamic_states.data();
+
+		this->pipeline_layout_info.setLayoutCount = this->set_layouts.size();
+		this->pipeline_layout_info.pSetLayouts = this->set_layouts.data();
+
+		this->pipeline_layout_info.pushConstantRangeCount = this->push_constant_ranges.size();
+		this->pipeline_layout_info.pPushConstantRanges = this->push_constant_ranges.data();
+	}
+
+	size_t PipelineConfig::Hash() const {
+		size_t seed = 0;
+
+		HashCombine(seed, this->input_assembly_info.topology);
+		HashCombine(seed, this->input_assembly_info.primitiveRestartEnable);
+
+		HashCombine(seed, this->viewport_info.viewportCount);
+		HashCombine(seed, this->viewport_info.scissorCount);
+
+		HashCombine(seed, this->rasterization_info.depthClampEnable);
+		HashCombine(seed, this->rasterization_info.rasterizerDiscardEnable);
+		HashCombine(seed, this->rasterization_info.polygonMode);
+		HashCombine(seed, this->rasterization_info.cullMode);
+		HashCombine(seed, this->rasterization_info.frontFace);
+		HashCombine(seed, this->rasterization_info.depthBiasEnable);
+		HashCombine(seed, this->rasterization_info.depthBiasConstantFactor);
+		HashCombine(seed, this->rasterization_info.depthBiasClamp);
+		HashCombine(seed, this->rasterization_info.depthBiasSlopeFactor);
+		HashCombine(seed, this->rasterization_info.lineWidth);
+
+		HashCombine(seed, this->multisample_info.rasterizationSamples);
+		HashCombine(seed, this->multisample_info.sampleShadingEnable);
+		HashCombine(seed, this->multisample_info.minSampleShading);
+		HashCombine(seed, this->multisample_info.alphaToCoverageEnable);
+		HashCombine(seed, this->multisample_info.alphaToOneEnable);
+
+		HashCombine(seed, this->color_blend_attachment.blendEnable);
+		HashCombine(seed, this->color_blend_attachment.srcColorBlendFactor);
+		HashCombine(seed, this->color_blend_attachment.dstColorBlendFactor);
+		HashCombine(seed, this->color_blend_attachment.colorBlendOp);
+		HashCombine(seed, this->color_blend_attachment.srcAlphaBlendFactor);
+		HashCombine(seed, this->color_blend_attachment.dstAlphaBlendFactor);
+		HashCombine(seed, this->color_blend_attachment.alphaBlendOp);
+		HashCombine(seed, this->color_blend_attachment.colorWriteMask);
+
+		HashCombine(seed, this->color_blend_info.logicOpEnable);
+		HashCombine(seed, this->color_blend_info.logicOp);
+		for (float constant : this->color_blend_info.blendConstants) {
+			HashCombine(seed, constant);
+		}
+
+		HashCombine(seed, this->depth_stencil_info.depthTestEnable);
+		HashCombine(seed, this->depth_stencil_info.depthWriteEnable);
+		HashCombine(seed, this->depth_stencil_info.depthCompareOp);
+		HashCombine(seed, this->depth_stencil_info.depthBoundsTestEnable);
+		HashCombine(seed, this->depth_stencil_info.stencilTestEnable);
+		HashCombine(seed, this->depth_stencil_info.minDepthBounds);
+		HashCombine(seed, this->depth_stencil_info.maxDepthBounds);
+
+		for (const VkVertexInputBindingDescription& binding : this->binding_descriptions) {
+			HashCombine(seed, binding.binding);
+			HashCombine(seed, binding.stride);
+			HashCombine(seed, binding.inputRate);
+		}
+
+		for (const VkVertexInputAttributeDescription& attribute : this->attribute_descriptions) {
+			HashCombine(seed, attribute.location);
+			HashCombine(seed, attribute.binding);
+			HashCombine(seed, attribute.format);
+			HashCombine(seed, attribute.offset);
+		}
+
+		for (VkDynamicState dynamic_state : this->dynamic_states) {
+			HashCombine(seed, dynamic_state);
+		}
+
+		for (const VkPushConstantRange& range : this->push_constant_ranges) {
+			HashCombine(seed, range.stageFlags);
+			HashCombine(seed, range.offset);
+			HashCombine(seed, range.size);
+		}
+
+		for (VkDescriptorSetLayout set_layout : this->set_layouts) {
+			HashCombine(seed, set_layout);
+		}
+
+		HashCombine(seed, this->subpass);
+		HashCombine(seed, this->render_pass);
+
+		return seed;
+	}
+
+	bool PipelineConfig::operator==(const PipelineConfig& other) const {
+		if (
+			this->input_assembly_info.topology != other.input_assembly_info.topology ||
+			this->input_assembly_info.primitiveRestartEnable != other.input_assembly_info.primitiveRestartEnable
+		) {
+			return false;
+		}
+
+		if (
+			this->viewport_info.viewportCount != other.viewport_info.viewportCount ||
+			this->viewport_info.scissorCount != other.viewport_info.scissorCount
+		) {
+			return false;
+		}
+
+		if (
+			this->rasterization_info.depthClampEnable != other.rasterization_info.depthClampEnable ||
+			this->rasterization_info.rasterizerDiscardEnable != other.rasterization_info.rasterizerDiscardEnable ||
+			this->rasterization_info.polygonMode != other.rasterization_info.polygonMode ||
+			this->rasterization_info.cullMode != other.rasterization_info.cullMode ||
+			this->rasterization_info.frontFace != other.rasterization_info.frontFace ||
+			this->rasterization_info.depthBiasEnable != other.rasterization_info.depthBiasEnable ||
+			this->rasterization_info.depthBiasConstantFactor != other.rasterization_info.depthBiasConstantFactor ||
+			this->rasterization_info.depthBiasClamp != other.rasterization_info.depthBiasClamp ||
+			this->rasterization_info.depthBiasSlopeFactor != other.rasterization_info.depthBiasSlopeFactor ||
+			this->rasterization_info.lineWidth != other.rasterization_info.lineWidth
+		) {
+			return false;
+		}
+
+		if (
+			this->multisample_info.rasterizationSamples != other.multisample_info.rasterizationSamples ||
+			this->multisample_info.sampleShadingEnable != other.multisample_info.sampleShadingEnable ||
+			this->multisample_info.minSampleShading != other.multisample_info.minSampleShading ||
+			this->multisample_info.alphaToCoverageEnable != other.multisample_info.alphaToCoverageEnable ||
+			this->multisample_info.alphaToOneEnable != other.multisample_info.alphaToOneEnable
+		) {
+			return false;
+		}
+
+		if (
+			this->color_blend_attachment.blendEnable != other.color_blend_attachment.blendEnable ||
+			this->color_blend_attachment.srcColorBlendFactor != other.color_blend_attachment.srcColorBlendFactor ||
+			this->color_blend_attachment.dstColorBlendFactor != other.color_blend_attachment.dstColorBlendFactor ||
+			this->color_blend_attachment.colorBlendOp != other.color_blend_attachment.colorBlendOp ||
+			this->color_blend_attachment.srcAlphaBlendFactor != other.color_blend_attachment.srcAlphaBlendFactor ||
+			this->color_blend_attachment.dstAlphaBlendFactor != other.color_blend_attachment.dstAlphaBlendFactor ||
+			this->color_blend_attachment.alphaBlendOp != other.color_blend_attachment.alphaBlendOp ||
+			this->color_blend_attachment.colorWriteMask != other.color_blend_attachment.colorWriteMask
+		) {
+			return false;
+		}
+
+		if (
+			this->color_blend_info.logicOpEnable != other.color_blend_info.logicOpEnable ||
+			this->color_blend_info.logicOp != other.color_blend_info.logicOp ||
+			memcmp(
+				this->color_blend_info.blendConstants,
+				other.color_blend_info.blendConstants,
+				sizeof(this->color_blend_info.blendConstants)
+			) != 0
+		) {
+			return false;
+		}
+
+		if (
+			this->depth_stencil_info.depthTestEnable != other.depth_stencil_info.depthTestEnable ||
+			this->depth_stencil_info.depthWriteEnable != other.depth_stencil_info.depthWriteEnable ||
+			this->depth_stencil_info.depthCompareOp != other.depth_stencil_info.depthCompareOp ||
+			this->depth_stencil_info.depthBoundsTestEnable != other.depth_stencil_info.depthBoundsTestEnable ||
+			this->depth_stencil_info.stencilTestEnable != other.depth_stencil_info.stencilTestEnable ||
+			this->depth_stencil_info.minDepthBounds != other.depth_stencil_info.minDepthBounds ||
+			this->depth_stencil_info.maxDepthBounds != other.depth_stencil_info.maxDepthBounds
+		) {
+			return false;
+		}
+
+		if (!std::equal(
+			this->binding_descriptions.begin(),
+			this->binding_descriptions.end(),
+			other.binding_descriptions.begin(),
+			other.binding_descriptions.end(),
+			[](const VkVertexInputBindingDescription& a, const VkVertexInputBindingDescription& b) {
+				return a.binding == b.binding &&
+					a.stride == b.stride &&
+					a.inputRate == b.inputRate;
+			}
+		)) {
+			return false;
+		}
+
+		if (!std::equal(
+			this->attribute_descriptions.begin(),
+			this->attribute_descriptions.end(),
+			other.attribute_descriptions.begin(),
+			other.attribute_descriptions.end(),
+			[](const VkVertexInputAttributeDescription& a, const VkVertexInputAttributeDescription& b) {
+				return a.location == b.location &&
+					a.binding == b.binding &&
+					a.format == b.format &&
+					a.offset == b.offset;
+			}
+		)) {
+			return false;
+		}
+
+		if (!std::equal(
+			this->push_constant_ranges.begin(),
+			this->push_constant_ranges.end(),
+			other.push_constant_ranges.begin(),
+			other.push_constant_ranges.end(),
+			[](const VkPushConstantRange& a, const VkPushConstantRange& b) {
+				return a.stageFlags == b.stageFlags &&
+					a.offset == b.offset &&
+					a.size == b.size;
+			}
+		)) {
+			return false;
+		}
+
+		return this->dynamic_states == other.dynamic_states &&
+			this->set_layouts == other.set_layouts &&
+			this->subpass == other.subpass &&
+			this->render_pass == other.render_pass;
+	}
+
+
 	Pipeline::Pipeline(
 		Device& device,
 		const uint32_t width,
 		const uint32_t height,
 		const std::string vertex_shader,
 		const std::string fragmnet_sahder,
-		PipelineConfig config
+		PipelineConfig config,
+		bool deferred
 	) :
 		device(device),
 		width(width),
@@ -27,11 +259,13 @@ namespace yib {
 			return;
 		}
 
+		this->config.UpdatePointers();
+
 		if (!CreatePipelineLayout()) {
 			return;
 		}
 
-		if (!CreatePipeline()) {
+		if (!deferred && !Compile()) {
 			return;
 		}
 
@@ -49,6 +283,30 @@ namespace yib {
 		return this->pipeline_layout;
 	}
 
+	bool Pipeline::IsReady() const {
+		return this->ready;
+	}
+
+	bool Pipeline::HasFailed() const {
+		return this->failed;
+	}
+
+
+	bool Pipeline::Compile() {
+		if (this->ready) {
+			return true;
+		}
+
+		if (!CreatePipeline()) {
+			this->failed = true;
+			return false;
+		}
+
+		this->ready = true;
+
+		return true;
+	}
+
 
 	PipelineConfig Pipeline::CreateDefaultConfig(VkRenderPass render_pass) {
 		PipelineConfig config = {};
@@ -139,6 +397,9 @@ namespace yib {
 		config.dynamic_state_info.pDynamicStates = config.dynamic_states.data();
 		config.dynamic_state_info.flags = 0;
 
+		config.binding_descriptions = Vertex::GetBindingDescription();
+		config.attribute_descriptions = Vertex::GetAttributeDescriptions();
+
 		config.pipeline_layout_info = {};
 
 		config.pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -148,6 +409,7 @@ namespace yib {
 		config.pipeline_layout_info.pPushConstantRanges = nullptr;
 
 		config.render_pass = render_pass;
+		config.subpass = 0;
 
 		return config;
 	}
@@ -250,16 +512,13 @@ namespace yib {
 		shader_stages[1].pNext = nullptr;
 		shader_stages[1].pSpecializationInfo = nullptr;
 
-		std::vector<VkVertexInputAttributeDescription> attribute_descriptions = Vertex::GetAttributeDescriptions();
-		std::vector<VkVertexInputBindingDescription> binding_descriptions = Vertex::GetBindingDescription();
-
 		VkPipelineVertexInputStateCreateInfo vertex_input_info = {};
 
 		vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-		vertex_input_info.vertexAttributeDescriptionCount = attribute_descriptions.size();
-		vertex_input_info.vertexBindingDescriptionCount = binding_descriptions.size();
-		vertex_input_info.pVertexAttributeDescriptions = attribute_descriptions.data();
-		vertex_input_info.pVertexBindingDescriptions = binding_descriptions.data();
+		vertex_input_info.vertexAttributeDescriptionCount = this->config.attribute_descriptions.size();
+		vertex_input_info.vertexBindingDescriptionCount = this->config.binding_descriptions.size();
+		vertex_input_info.pVertexAttributeDescriptions = this->config.attribute_descriptions.data();
+		vertex_input_info.pVertexBindingDescriptions = this->config.binding_descriptions.data();
 
 		VkGraphicsPipelineCreateInfo pipeline_info = {};
 
@@ -282,9 +541,11 @@ namespace yib {
 		pipeline_info.basePipelineIndex = -1;
 		pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
 
+		std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
 		if (vkCreateGraphicsPipelines(
 			this->device.GetDevice(),
-			VK_NULL_HANDLE,
+			this->device.GetPipelineCache(),
 			1,
 			&pipeline_info,
 			nullptr,
@@ -293,6 +554,10 @@ namespace yib {
 			return false;
 		}
 
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start_time;
+
+		this->device.RecordPipelineCreation(elapsed.count());
+
 		return true;
 	}
 
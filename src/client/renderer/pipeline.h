@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <string>
 
 #include <vulkan/vulkan.h>
@@ -11,6 +12,13 @@ namespace yib {
 	struct PipelineConfig {
 		PipelineConfig() = default;
 
+		// The create infos point into the vectors above them, which a copy
+		// does not carry over, so this has to run after every copy.
+		void UpdatePointers();
+		size_t Hash() const;
+		// Compares the same state Hash covers.
+		bool operator==(const PipelineConfig& other) const;
+
 		VkPipelineInputAssemblyStateCreateInfo input_assembly_info;
 		VkPipelineViewportStateCreateInfo viewport_info;
 		VkPipelineRasterizationStateCreateInfo rasterization_info;
@@ -19,6 +27,8 @@ namespace yib {
 		VkPipelineColorBlendStateCreateInfo color_blend_info;
 		VkPipelineDepthStencilStateCreateInfo depth_stencil_info;
 		VkPipelineDynamicStateCreateInfo dynamic_state_info;
+		std::vector<VkVertexInputBindingDescription> binding_descriptions;
+		std::vector<VkVertexInputAttributeDescription> attribute_descriptions;
 		std::vector<VkPushConstantRange> push_constant_ranges;
 		std::vector<VkDescriptorSetLayout> set_layouts;
 		VkPipelineLayoutCreateInfo pipeline_layout_info;
@@ -36,7 +46,8 @@ namespace yib {
 			const uint32_t height,
 			const std::string vertex_shader,
 			const std::string fragmnet_sahder,
-			PipelineConfig config
+			PipelineConfig config,
+			bool deferred = false
 		);
 		~Pipeline();
 
@@ -44,6 +55,12 @@ namespace yib {
 		Pipeline& operator=(const Pipeline&) = delete;
 
 		VkPipelineLayout GetPipelineLayout() const;
+		bool IsReady() const;
+		// Set once a deferred compile has failed, the pipeline then never
+		// becomes ready.
+		bool HasFailed() const;
+
+		bool Compile();
 
 		static PipelineConfig CreateDefaultConfig(VkRenderPass render_pass);
 		void BindCommandBuffer(VkCommandBuffer command_buffer) const;
@@ -72,5 +89,8 @@ namespace yib {
 		VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
 		VkShaderModule vertex_shader_module = VK_NULL_HANDLE;
 		VkShaderModule fragment_shader_module = VK_NULL_HANDLE;
+
+		std::atomic<bool> ready = false;
+		std::atomic<bool> failed = false;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "pipeline_registry.h"
+
+#include <cstdio>
+
+namespace yib {
+	PipelineRegistry::PipelineRegistry(
+		Device& device,
+		uint32_t thread_count
+	) : device(device), thread_pool(thread_count) { }
+
+	PipelineRegistry::~PipelineRegistry() {
+		Wait();
+	}
+
+
+	std::shared_ptr<Pipeline> PipelineRegistry::Get(
+		const uint32_t width,
+		const uint32_t height,
+		const std::string& vertex_shader,
+		const std::string& fragment_shader,
+		const PipelineConfig& config,
+		bool async
+	) {
+		PipelineKey key = {};
+
+		key.vertex_shader = vertex_shader;
+		key.fragment_shader = fragment_shader;
+		key.config = config;
+
+		std::unique_lock<std::mutex> lock(this->mutex);
+
+		std::unordered_map<PipelineKey, std::shared_ptr<Pipeline>, PipelineKeyHash>::iterator it = this->pipelines.find(key);
+		if (it != this->pipelines.end()) {
+			if (it->second->HasFailed()) {
+				return nullptr;
+			}
+
+			return it->second;
+		}
+
+		std::shared_ptr<Pipeline> pipeline = std::make_shared<Pipeline>(
+			this->device,
+			width,
+			height,
+			vertex_shader,
+			fragment_shader,
+			config,
+			async
+		);
+		if (!pipeline->success) {
+			return nullptr;
+		}
+
+		this->pipelines[std::move(key)] = pipeline;
+
+		if (async) {
+			this->thread_pool.Submit([pipeline, vertex_shader] {
+				if (!pipeline->Compile()) {
+					printf("Failed to compile pipeline %s\n", vertex_shader.c_str());
+				}
+			});
+		}
+
+		return pipeline;
+	}
+
+	bool PipelineRegistry::Wait() {
+		this->thread_pool.Wait();
+
+		std::unique_lock<std::mutex> lock(this->mutex);
+
+		for (const std::pair<const PipelineKey, std::shared_ptr<Pipeline>>& pipeline : this->pipelines) {
+			if (pipeline.second->HasFailed()) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	size_t PipelineRegistry::GetPipelineCount() const {
+		std::unique_lock<std::mutex> lock(this->mutex);
+
+		return this->pipelines.size();
+	}
+
+
+	bool PipelineKey::operator==(const PipelineKey& other) const {
+		return this->vertex_shader == other.vertex_shader &&
+			this->fragment_shader == other.fragment_shader &&
+			this->config == other.config;
+	}
+
+	size_t PipelineKeyHash::operator()(const PipelineKey& key) const {
+		size_t seed = key.config.Hash();
+
+		seed ^= std::hash<std::string>()(key.vertex_shader) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+		seed ^= std::hash<std::string>()(key.fragment_shader) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+
+		return seed;
+	}
+}
\ No newline at end of file
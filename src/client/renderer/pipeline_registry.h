@@ -0,0 +1,66 @@
+#pragma once
+
+#include <mutex>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <unordered_map>
+
+#include <vulkan/vulkan.h>
+
+#include "device.h"
+#include "pipeline.h"
+#include "../../shared/thread_pool.h"
+
+namespace yib {
+	// Everything a registered pipeline is looked up by. The config is kept
+	// whole so a hash collision compares unequal instead of handing out
+	// another pipeline.
+	struct PipelineKey {
+		std::string vertex_shader;
+		std::string fragment_shader;
+		PipelineConfig config;
+
+		bool operator==(const PipelineKey& other) const;
+	};
+
+	struct PipelineKeyHash {
+		size_t operator()(const PipelineKey& key) const;
+	};
+
+	class PipelineRegistry {
+	public:
+		PipelineRegistry(
+			Device& device,
+			uint32_t thread_count = 0
+		);
+		~PipelineRegistry();
+
+		PipelineRegistry(const PipelineRegistry&) = delete;
+		PipelineRegistry& operator=(const PipelineRegistry&) = delete;
+
+		// Returns the pipeline already registered for this state and these
+		// shaders, or creates it. An async pipeline is returned right away
+		// and compiles on a worker thread, check IsReady before drawing and
+		// HasFailed to catch a compile that went wrong. A pipeline whose
+		// compile failed is returned as null.
+		std::shared_ptr<Pipeline> Get(
+			const uint32_t width,
+			const uint32_t height,
+			const std::string& vertex_shader,
+			const std::string& fragment_shader,
+			const PipelineConfig& config,
+			bool async = false
+		);
+
+		// False if any pipeline failed to compile.
+		bool Wait();
+		size_t GetPipelineCount() const;
+	private:
+		Device& device;
+		ThreadPool thread_pool;
+
+		mutable std::mutex mutex;
+		std::unordered_map<PipelineKey, std::shared_ptr<Pipeline>, PipelineKeyHash> pipelines = {};
+	};
+}
\ No newline at end of file
@@ -0,0 +1,1303 @@
+#include "render_graph.h"
+
+#include <array>
+#include <algorithm>
+
+#include "../../shared/profiler.h"
+
+namespace yib {
+	RenderGraph::PassBuilder::PassBuilder(
+		RenderGraph& graph,
+		uint32_t pass
+	) :
+		graph(graph),
+		pass(pass)
+	{ }
+
+	bool RenderGraph::PassBuilder::WriteColor(
+		Resource resource,
+		std::optional<VkClearColorValue> clear
+	) {
+		Use use = {};
+
+		use.resource = resource;
+		use.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		use.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		use.access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		use.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		use.read = !clear.has_value();
+		use.write = true;
+
+		if (clear.has_value()) {
+			VkClearValue clear_value = {};
+			clear_value.color = clear.value();
+
+			use.clear = clear_value;
+		}
+
+		return this->graph.AddUse(this->pass, use);
+	}
+
+	bool RenderGraph::PassBuilder::WriteDepth(
+		Resource resource,
+		std::optional<VkClearDepthStencilValue> clear
+	) {
+		Use use = {};
+
+		use.resource = resource;
+		use.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		use.stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		use.access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		use.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		use.read = !clear.has_value();
+		use.write = true;
+
+		if (clear.has_value()) {
+			VkClearValue clear_value = {};
+			clear_value.depthStencil = clear.value();
+
+			use.clear = clear_value;
+		}
+
+		return this->graph.AddUse(this->pass, use);
+	}
+
+	bool RenderGraph::PassBuilder::ReadImage(
+		Resource resource,
+		VkPipelineStageFlags stages
+	) {
+		Use use = {};
+
+		use.resource = resource;
+		use.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		use.stages = stages;
+		use.access = VK_ACCESS_SHADER_READ_BIT;
+		use.usage = VK_IMAGE_USAGE_SAMPLED_BIT;
+		use.read = true;
+
+		return this->graph.AddUse(this->pass, use);
+	}
+
+	bool RenderGraph::PassBuilder::ReadBuffer(
+		Resource resource,
+		VkPipelineStageFlags stages,
+		VkAccessFlags access
+	) {
+		Use use = {};
+
+		use.resource = resource;
+		use.stages = stages;
+		use.access = access;
+		use.read = true;
+
+		return this->graph.AddUse(this->pass, use);
+	}
+
+	bool RenderGraph::PassBuilder::WriteBuffer(
+		Resource resource,
+		VkPipelineStageFlags stages,
+		VkAccessFlags access
+	) {
+		Use use = {};
+
+		use.resource = resource;
+		use.stages = stages;
+		use.access = access;
+		use.write = true;
+
+		return this->graph.AddUse(this->pass, use);
+	}
+
+	void RenderGraph::PassBuilder::UseSecondaryCommandBuffers() {
+		this->graph.passes.at(this->pass).secondary = true;
+	}
+
+	void RenderGraph::PassBuilder::KeepAlive() {
+		this->graph.passes.at(this->pass).keep_alive = true;
+	}
+
+	void RenderGraph::PassBuilder::SetRecord(RecordFunction record) {
+		this->graph.passes.at(this->pass).record = std::move(record);
+	}
+
+
+	RenderGraph::RenderGraph(
+		Device& device,
+		FrameSync& frame_sync,
+		GpuProfiler* gpu_profiler
+	) :
+		device(device),
+		frame_sync(frame_sync),
+		gpu_profiler(gpu_profiler),
+		success(true)
+	{ }
+
+	RenderGraph::~RenderGraph() {
+		DestroyRetired(true);
+		DestroyPlacement(this->placement);
+
+		for (std::pair<const Key, CachedFramebuffer>& framebuffer : this->framebuffers) {
+			vkDestroyFramebuffer(
+				this->device.GetDevice(),
+				framebuffer.second.framebuffer,
+				nullptr
+			);
+		}
+
+		for (std::pair<const Key, VkRenderPass>& render_pass : this->render_passes) {
+			vkDestroyRenderPass(
+				this->device.GetDevice(),
+				render_pass.second,
+				nullptr
+			);
+		}
+	}
+
+
+	void RenderGraph::Reset() {
+		this->passes.clear();
+		this->resources.clear();
+	}
+
+	RenderGraph::Resource RenderGraph::CreateImage(
+		const std::string& name,
+		const RenderGraphImageInfo& info
+	) {
+		ResourceNode resource = {};
+
+		resource.name = name;
+		resource.is_image = true;
+		resource.info = info;
+
+		this->resources.push_back(resource);
+
+		return this->resources.size() - 1;
+	}
+
+	RenderGraph::Resource RenderGraph::ImportImage(
+		const std::string& name,
+		VkImage image,
+		VkImageView image_view,
+		const RenderGraphImageInfo& info,
+		const RenderGraphState& initial_state,
+		const RenderGraphState& final_state
+	) {
+		ResourceNode resource = {};
+
+		resource.name = name;
+		resource.is_image = true;
+		resource.imported = true;
+		resource.info = info;
+		resource.image = image;
+		resource.image_view = image_view;
+		resource.initial_state = initial_state;
+		resource.final_state = final_state;
+
+		this->resources.push_back(resource);
+
+		return this->resources.size() - 1;
+	}
+
+	RenderGraph::Resource RenderGraph::ImportBuffer(
+		const std::string& name,
+		VkBuffer buffer,
+		const RenderGraphState& initial_state,
+		const RenderGraphState& final_state
+	) {
+		ResourceNode resource = {};
+
+		resource.name = name;
+		resource.imported = true;
+		resource.buffer = buffer;
+		resource.initial_state = initial_state;
+		resource.final_state = final_state;
+
+		this->resources.push_back(resource);
+
+		return this->resources.size() - 1;
+	}
+
+	RenderGraph::PassBuilder RenderGraph::AddPass(
+		const std::string& name,
+		VkPipelineBindPoint bind_point
+	) {
+		Pass pass = {};
+
+		pass.name = name;
+		pass.bind_point = bind_point;
+
+		this->passes.push_back(pass);
+
+		return PassBuilder(*this, this->passes.size() - 1);
+	}
+
+
+	VkImage RenderGraph::GetImage(Resource resource) const {
+		return this->resources.at(resource).image;
+	}
+
+	VkImageView RenderGraph::GetImageView(Resource resource) const {
+		return this->resources.at(resource).image_view;
+	}
+
+	VkBuffer RenderGraph::GetBuffer(Resource resource) const {
+		return this->resources.at(resource).buffer;
+	}
+
+
+	bool RenderGraph::Execute(VkCommandBuffer command_buffer) {
+		YIB_PROFILE_FUNCTION();
+
+		DestroyRetired(false);
+		this->execute_count++;
+
+		CullPasses();
+		ComputeLifetimes();
+
+		if (!PlaceTransientImages()) {
+			return false;
+		}
+
+		for (uint32_t i = 0; i < this->passes.size(); i++) {
+			if (this->passes.at(i).culled) {
+				continue;
+			}
+
+			if (!RecordPass(command_buffer, i)) {
+				return false;
+			}
+		}
+
+		// Imported images are left how the caller expects them, even when
+		// every pass touching them was culled.
+		Barriers barriers = {};
+
+		for (ResourceNode& resource : this->resources) {
+			if (!resource.imported) {
+				continue;
+			}
+
+			if (
+				(resource.is_image && resource.state.layout != resource.final_state.layout) ||
+				resource.final_state.access != 0
+			) {
+				Transition(
+					resource,
+					resource.final_state.layout,
+					resource.final_state.stages,
+					resource.final_state.access,
+					false,
+					barriers
+				);
+			}
+		}
+
+		FlushBarriers(command_buffer, barriers);
+
+		RetireUnusedFramebuffers();
+
+		return true;
+	}
+
+	void RenderGraph::RetireFramebuffers() {
+		for (std::pair<const Key, CachedFramebuffer>& framebuffer : this->framebuffers) {
+			Retired retired = {};
+
+			retired.frame = this->frame_sync.GetSubmittedFrame();
+			retired.framebuffer = framebuffer.second.framebuffer;
+
+			this->retired.push_back(std::move(retired));
+		}
+
+		this->framebuffers.clear();
+	}
+
+	VkRenderPass RenderGraph::GetCompatibleRenderPass(
+		const std::vector<VkFormat>& color_formats,
+		VkFormat depth_format
+	) {
+		std::vector<Attachment> attachments = {};
+
+		for (VkFormat color_format : color_formats) {
+			Attachment attachment = {};
+
+			attachment.format = color_format;
+			attachment.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			attachment.load_op = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			attachment.store_op = VK_ATTACHMENT_STORE_OP_STORE;
+
+			attachments.push_back(attachment);
+		}
+
+		if (depth_format != VK_FORMAT_UNDEFINED) {
+			Attachment attachment = {};
+
+			attachment.format = depth_format;
+			attachment.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			attachment.load_op = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			attachment.store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+			attachments.push_back(attachment);
+		}
+
+		return FindRenderPass(attachments);
+	}
+
+	uint32_t RenderGraph::GetCulledPassCount() const {
+		return this->culled_pass_count;
+	}
+
+	VkDeviceSize RenderGraph::GetTransientMemorySize() const {
+		VkDeviceSize size = 0;
+
+		for (const Heap& heap : this->placement.heaps) {
+			size += heap.size;
+		}
+
+		return size;
+	}
+
+	VkDeviceSize RenderGraph::GetTransientImageSize() const {
+		VkDeviceSize size = 0;
+
+		for (const TransientImage& image : this->placement.images) {
+			size += image.size;
+		}
+
+		return size;
+	}
+
+
+	size_t RenderGraph::KeyHash::operator()(const Key& key) const {
+		// FNV-1a over every word.
+		uint64_t hash = 14695981039346656037ull;
+
+		for (uint64_t word : key) {
+			hash ^= word;
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+
+	bool RenderGraph::AddUse(
+		uint32_t pass,
+		const Use& use
+	) {
+		if (use.resource >= this->resources.size()) {
+			return false;
+		}
+
+		ResourceNode& resource = this->resources.at(use.resource);
+		if (resource.is_image != (use.usage != 0)) {
+			return false;
+		}
+
+		resource.usage |= use.usage;
+
+		for (Use& other : this->passes.at(pass).uses) {
+			if (other.resource != use.resource) {
+				continue;
+			}
+
+			// One resource has to stay in one layout for the whole pass.
+			if (other.layout != use.layout) {
+				other.layout = VK_IMAGE_LAYOUT_GENERAL;
+			}
+
+			other.stages |= use.stages;
+			other.access |= use.access;
+			other.usage |= use.usage;
+			other.read = other.read || use.read;
+			other.write = other.write || use.write;
+
+			if (use.clear.has_value()) {
+				other.clear = use.clear;
+			}
+
+			return true;
+		}
+
+		this->passes.at(pass).uses.push_back(use);
+
+		return true;
+	}
+
+
+	void RenderGraph::CullPasses() {
+		// Imported resources are read by whoever imported them, everything
+		// else only lives as long as some pass reads it.
+		for (ResourceNode& resource : this->resources) {
+			resource.ref_count = resource.imported ? 1 : 0;
+		}
+
+		std::vector<uint32_t> unused_passes = {};
+
+		for (uint32_t i = 0; i < this->passes.size(); i++) {
+			Pass& pass = this->passes.at(i);
+
+			pass.culled = false;
+			pass.ref_count = pass.keep_alive ? 1 : 0;
+
+			for (const Use& use : pass.uses) {
+				if (use.write) {
+					pass.ref_count++;
+				}
+
+				if (use.read) {
+					this->resources.at(use.resource).ref_count++;
+				}
+			}
+
+			if (pass.ref_count == 0) {
+				unused_passes.push_back(i);
+			}
+		}
+
+		std::vector<Resource> unused_resources = {};
+
+		for (Resource i = 0; i < this->resources.size(); i++) {
+			if (this->resources.at(i).ref_count == 0) {
+				unused_resources.push_back(i);
+			}
+		}
+
+		while (!unused_passes.empty() || !unused_resources.empty()) {
+			while (!unused_resources.empty()) {
+				Resource resource = unused_resources.back();
+				unused_resources.pop_back();
+
+				for (uint32_t i = 0; i < this->passes.size(); i++) {
+					Pass& pass = this->passes.at(i);
+					if (pass.culled || pass.ref_count == 0) {
+						continue;
+					}
+
+					for (const Use& use : pass.uses) {
+						if (use.resource == resource && use.write && --pass.ref_count == 0) {
+							unused_passes.push_back(i);
+						}
+					}
+				}
+			}
+
+			while (!unused_passes.empty()) {
+				Pass& pass = this->passes.at(unused_passes.back());
+				unused_passes.pop_back();
+
+				pass.culled = true;
+
+				for (const Use& use : pass.uses) {
+					if (use.read && --this->resources.at(use.resource).ref_count == 0) {
+						unused_resources.push_back(use.resource);
+					}
+				}
+			}
+		}
+
+		this->culled_pass_count = std::count_if(
+			this->passes.begin(),
+			this->passes.end(),
+			[](const Pass& pass) { return pass.culled; }
+		);
+	}
+
+	void RenderGraph::ComputeLifetimes() {
+		for (uint32_t i = 0; i < this->passes.size(); i++) {
+			const Pass& pass = this->passes.at(i);
+			if (pass.culled) {
+				continue;
+			}
+
+			for (const Use& use : pass.uses) {
+				ResourceNode& resource = this->resources.at(use.resource);
+
+				resource.first_pass = std::min(resource.first_pass, i);
+				resource.last_pass = std::max(resource.last_pass, i);
+			}
+		}
+
+		for (ResourceNode& resource : this->resources) {
+			resource.state = {};
+
+			if (resource.imported) {
+				resource.state.layout = resource.initial_state.layout;
+				resource.state.write_stages = resource.initial_state.stages;
+				resource.state.write_access = resource.initial_state.access;
+			}
+		}
+	}
+
+
+	bool RenderGraph::PlaceTransientImages() {
+		// Transient images are matched to the last placement by their
+		// description and lifetime, a graph that keeps its shape reuses the
+		// same images every frame.
+		Key key = {};
+		uint32_t transient_count = 0;
+
+		for (ResourceNode& resource : this->resources) {
+			if (resource.imported || resource.first_pass == UINT32_MAX) {
+				continue;
+			}
+
+			resource.transient = transient_count++;
+
+			key.push_back(resource.info.format);
+			key.push_back(resource.info.extent.width);
+			key.push_back(resource.info.extent.height);
+			key.push_back(resource.usage);
+			key.push_back(resource.first_pass);
+			key.push_back(resource.last_pass);
+		}
+
+		if (key != this->placement.key) {
+			if (!this->placement.images.empty()) {
+				Retired retired = {};
+
+				retired.frame = this->frame_sync.GetSubmittedFrame();
+				retired.placement = std::move(this->placement);
+
+				this->retired.push_back(std::move(retired));
+
+				// A new view could reuse the handle of a retired one.
+				RetireFramebuffers();
+			}
+
+			this->placement = {};
+			this->placement.key = key;
+
+			if (!CreatePlacement(this->placement)) {
+				DestroyPlacement(this->placement);
+				return false;
+			}
+		}
+
+		for (ResourceNode& resource : this->resources) {
+			if (resource.transient == UINT32_MAX) {
+				continue;
+			}
+
+			const TransientImage& image = this->placement.images.at(resource.transient);
+
+			resource.image = image.image;
+			resource.image_view = image.image_view;
+		}
+
+		return true;
+	}
+
+	bool RenderGraph::CreatePlacement(Placement& placement) {
+		std::vector<VkMemoryRequirements> requirements = {};
+
+		for (ResourceNode& resource : this->resources) {
+			if (resource.transient == UINT32_MAX) {
+				continue;
+			}
+
+			TransientImage image = {};
+
+			image.first_pass = resource.first_pass;
+			image.last_pass = resource.last_pass;
+
+			VkImageCreateInfo image_info = {};
+
+			image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			image_info.imageType = VK_IMAGE_TYPE_2D;
+			image_info.extent.width = resource.info.extent.width;
+			image_info.extent.height = resource.info.extent.height;
+			image_info.extent.depth = 1;
+			image_info.mipLevels = 1;
+			image_info.arrayLayers = 1;
+			image_info.format = resource.info.format;
+			image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+			image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			image_info.usage = resource.usage;
+			image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+			image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			image_info.flags = 0;
+
+			if (vkCreateImage(
+				this->device.GetDevice(),
+				&image_info,
+				nullptr,
+				&image.image
+			) != VK_SUCCESS) {
+				return false;
+			}
+
+			placement.images.push_back(image);
+
+			VkMemoryRequirements memory_requirements = {};
+			vkGetImageMemoryRequirements(
+				this->device.GetDevice(),
+				image.image,
+				&memory_requirements
+			);
+
+			placement.images.back().size = memory_requirements.size;
+			requirements.push_back(memory_requirements);
+		}
+
+		// Largest first, every image goes into the first heap it is
+		// compatible with and whose images are all dead by the time it is
+		// first used.
+		std::vector<uint32_t> order(placement.images.size());
+		for (uint32_t i = 0; i < order.size(); i++) {
+			order.at(i) = i;
+		}
+
+		std::sort(
+			order.begin(),
+			order.end(),
+			[&placement](uint32_t a, uint32_t b) {
+				return placement.images.at(a).size > placement.images.at(b).size;
+			}
+		);
+
+		for (uint32_t i : order) {
+			TransientImage& image = placement.images.at(i);
+			const VkMemoryRequirements& image_requirements = requirements.at(i);
+
+			for (uint32_t heap_index = 0; heap_index < placement.heaps.size() && image.heap == UINT32_MAX; heap_index++) {
+				if ((placement.heaps.at(heap_index).memory_type_bits & image_requirements.memoryTypeBits) == 0) {
+					continue;
+				}
+
+				bool overlaps = false;
+				for (const TransientImage& other : placement.images) {
+					if (
+						other.heap == heap_index &&
+						other.first_pass <= image.last_pass &&
+						image.first_pass <= other.last_pass
+					) {
+						overlaps = true;
+						break;
+					}
+				}
+
+				if (!overlaps) {
+					image.heap = heap_index;
+				}
+			}
+
+			if (image.heap == UINT32_MAX) {
+				image.heap = placement.heaps.size();
+				placement.heaps.push_back({});
+			}
+
+			Heap& heap = placement.heaps.at(image.heap);
+
+			heap.size = std::max(heap.size, image_requirements.size);
+			heap.alignment = std::max(heap.alignment, image_requirements.alignment);
+			heap.memory_type_bits &= image_requirements.memoryTypeBits;
+		}
+
+		for (Heap& heap : placement.heaps) {
+			std::optional<uint32_t> memory_type = this->device.FindMemoryType(
+				heap.memory_type_bits,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+			);
+			if (!memory_type.has_value()) {
+				return false;
+			}
+
+			VkMemoryRequirements heap_requirements = {};
+
+			heap_requirements.size = heap.size;
+			heap_requirements.alignment = heap.alignment;
+			heap_requirements.memoryTypeBits = heap.memory_type_bits;
+
+			if (!this->device.GetAllocator().Allocate(
+				heap_requirements,
+				memory_type.value(),
+				false,
+				heap.allocation
+			)) {
+				return false;
+			}
+		}
+
+		for (uint32_t i = 0; i < placement.images.size(); i++) {
+			TransientImage& image = placement.images.at(i);
+			const Heap& heap = placement.heaps.at(image.heap);
+
+			if (vkBindImageMemory(
+				this->device.GetDevice(),
+				image.image,
+				heap.allocation.memory,
+				heap.allocation.offset
+			) != VK_SUCCESS) {
+				return false;
+			}
+
+			VkFormat format = VK_FORMAT_UNDEFINED;
+			for (const ResourceNode& resource : this->resources) {
+				if (resource.transient == i) {
+					format = resource.info.format;
+				}
+			}
+
+			VkImageViewCreateInfo view_info = {};
+
+			view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			view_info.image = image.image;
+			view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			view_info.format = format;
+			view_info.subresourceRange.aspectMask = IsDepthFormat(format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+			view_info.subresourceRange.baseMipLevel = 0;
+			view_info.subresourceRange.levelCount = 1;
+			view_info.subresourceRange.baseArrayLayer = 0;
+			view_info.subresourceRange.layerCount = 1;
+
+			if (vkCreateImageView(
+				this->device.GetDevice(),
+				&view_info,
+				nullptr,
+				&image.image_view
+			) != VK_SUCCESS) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void RenderGraph::DestroyPlacement(Placement& placement) {
+		for (TransientImage& image : placement.images) {
+			if (image.image_view != VK_NULL_HANDLE) {
+				vkDestroyImageView(
+					this->device.GetDevice(),
+					image.image_view,
+					nullptr
+				);
+			}
+
+			vkDestroyImage(
+				this->device.GetDevice(),
+				image.image,
+				nullptr
+			);
+		}
+
+		for (Heap& heap : placement.heaps) {
+			if (heap.allocation.memory != VK_NULL_HANDLE) {
+				this->device.GetAllocator().Free(heap.allocation);
+			}
+		}
+
+		placement = {};
+	}
+
+
+	bool RenderGraph::RecordPass(
+		VkCommandBuffer command_buffer,
+		uint32_t pass_index
+	) {
+		Pass& pass = this->passes.at(pass_index);
+
+		if (this->gpu_profiler != nullptr) {
+			this->gpu_profiler->BeginZone(
+				command_buffer,
+				pass.name
+			);
+		}
+
+		// Whatever used the memory last has to finish before a transient
+		// image is transitioned out of UNDEFINED. The heap only knows that
+		// once the passes before this one were recorded.
+		for (const Use& use : pass.uses) {
+			ResourceNode& resource = this->resources.at(use.resource);
+			if (resource.transient == UINT32_MAX || resource.first_pass != pass_index) {
+				continue;
+			}
+
+			const Heap& heap = this->placement.heaps.at(this->placement.images.at(resource.transient).heap);
+
+			resource.state.write_stages = heap.stages;
+			resource.state.write_access = heap.access;
+		}
+
+		Barriers barriers = {};
+
+		for (const Use& use : pass.uses) {
+			Transition(
+				this->resources.at(use.resource),
+				use.layout,
+				use.stages,
+				use.access,
+				use.write,
+				barriers
+			);
+		}
+
+		FlushBarriers(command_buffer, barriers);
+
+		PassContext context = {};
+		context.command_buffer = command_buffer;
+
+		if (
+			pass.bind_point == VK_PIPELINE_BIND_POINT_GRAPHICS &&
+			!BeginRenderPass(pass_index, context)
+		) {
+			return false;
+		}
+
+		bool recorded = pass.record == nullptr || pass.record(context);
+
+		if (context.render_pass != VK_NULL_HANDLE) {
+			vkCmdEndRenderPass(command_buffer);
+		}
+
+		for (const Use& use : pass.uses) {
+			const ResourceNode& resource = this->resources.at(use.resource);
+			if (resource.transient == UINT32_MAX) {
+				continue;
+			}
+
+			Heap& heap = this->placement.heaps.at(this->placement.images.at(resource.transient).heap);
+
+			heap.stages = resource.state.write_stages | resource.state.read_stages;
+			heap.access = resource.state.write_access;
+		}
+
+		if (this->gpu_profiler != nullptr) {
+			this->gpu_profiler->EndZone(command_buffer);
+		}
+
+		return recorded;
+	}
+
+	bool RenderGraph::BeginRenderPass(
+		uint32_t pass_index,
+		PassContext& context
+	) {
+		const Pass& pass = this->passes.at(pass_index);
+
+		std::vector<Attachment> attachments = {};
+		std::vector<VkImageView> image_views = {};
+		std::vector<VkClearValue> clear_values = {};
+
+		// Color attachments come first, the depth attachment last.
+		for (VkImageUsageFlags usage : { VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT }) {
+			for (const Use& use : pass.uses) {
+				if ((use.usage & usage) == 0) {
+					continue;
+				}
+
+				const ResourceNode& resource = this->resources.at(use.resource);
+
+				bool has_contents = resource.first_pass < pass_index ||
+					(resource.imported && resource.initial_state.layout != VK_IMAGE_LAYOUT_UNDEFINED);
+				bool is_read_later = resource.imported || resource.last_pass > pass_index;
+
+				Attachment attachment = {};
+
+				attachment.format = resource.info.format;
+				attachment.layout = use.layout;
+				attachment.store_op = is_read_later ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+				if (use.clear.has_value()) {
+					attachment.load_op = VK_ATTACHMENT_LOAD_OP_CLEAR;
+				} else if (has_contents) {
+					attachment.load_op = VK_ATTACHMENT_LOAD_OP_LOAD;
+				}
+
+				attachments.push_back(attachment);
+				image_views.push_back(resource.image_view);
+				clear_values.push_back(use.clear.value_or(VkClearValue()));
+
+				context.extent = resource.info.extent;
+			}
+		}
+
+		context.render_pass = FindRenderPass(attachments);
+		if (context.render_pass == VK_NULL_HANDLE) {
+			return false;
+		}
+
+		context.framebuffer = FindFramebuffer(
+			context.render_pass,
+			image_views,
+			context.extent
+		);
+		if (context.framebuffer == VK_NULL_HANDLE) {
+			context.render_pass = VK_NULL_HANDLE;
+			return false;
+		}
+
+		VkRenderPassBeginInfo render_pass_begin_info = {};
+
+		render_pass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		render_pass_begin_info.renderPass = context.render_pass;
+		render_pass_begin_info.framebuffer = context.framebuffer;
+
+		render_pass_begin_info.renderArea.offset = { 0, 0 };
+		render_pass_begin_info.renderArea.extent = context.extent;
+
+		render_pass_begin_info.clearValueCount = clear_values.size();
+		render_pass_begin_info.pClearValues = clear_values.data();
+
+		if (pass.secondary) {
+			vkCmdBeginRenderPass(
+				context.command_buffer,
+				&render_pass_begin_info,
+				VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+			);
+
+			return true;
+		}
+
+		vkCmdBeginRenderPass(
+			context.command_buffer,
+			&render_pass_begin_info,
+			VK_SUBPASS_CONTENTS_INLINE
+		);
+
+		VkViewport viewport = {};
+
+		viewport.x = 0.0f;
+		viewport.y = 0.0f;
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+		viewport.width = context.extent.width;
+		viewport.height = context.extent.height;
+
+		vkCmdSetViewport(
+			context.command_buffer,
+			0,
+			1,
+			&viewport
+		);
+
+		VkRect2D scissor = {};
+
+		scissor.offset = { 0, 0 };
+		scissor.extent = context.extent;
+
+		vkCmdSetScissor(
+			context.command_buffer,
+			0,
+			1,
+			&scissor
+		);
+
+		return true;
+	}
+
+
+	void RenderGraph::Transition(
+		ResourceNode& resource,
+		VkImageLayout layout,
+		VkPipelineStageFlags stages,
+		VkAccessFlags access,
+		bool write,
+		Barriers& barriers
+	) const {
+		State& state = resource.state;
+
+		bool layout_change = resource.is_image && state.layout != layout;
+
+		if (!layout_change && !write) {
+			// Reads only wait once per stage for the last write, earlier
+			// readers already made it visible to theirs.
+			bool waited = (stages & ~state.read_stages) == 0 && (access & ~state.read_access) == 0;
+			bool written = state.write_access != 0 || state.read_stages != 0;
+
+			if (!waited && written) {
+				barriers.src_stages |= state.write_stages | state.read_stages;
+				barriers.dst_stages |= stages;
+				barriers.src_access |= state.write_access;
+				barriers.dst_access |= access;
+			}
+
+			state.read_stages |= stages;
+			state.read_access |= access;
+
+			return;
+		}
+
+		// Writes and layout transitions wait for every earlier access.
+		VkPipelineStageFlags src_stages = state.write_stages | state.read_stages;
+		VkAccessFlags src_access = state.write_access;
+
+		if (layout_change) {
+			VkImageMemoryBarrier barrier = {};
+
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.oldLayout = state.layout;
+			barrier.newLayout = layout;
+			barrier.srcAccessMask = src_access;
+			barrier.dstAccessMask = access;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = resource.image;
+			barrier.subresourceRange.aspectMask = GetAspectMask(resource.info.format);
+			barrier.subresourceRange.baseMipLevel = 0;
+			barrier.subresourceRange.levelCount = 1;
+			barrier.subresourceRange.baseArrayLayer = 0;
+			barrier.subresourceRange.layerCount = 1;
+
+			barriers.src_stages |= src_stages;
+			barriers.dst_stages |= stages;
+			barriers.image_barriers.push_back(barrier);
+		} else if (src_access != 0 || (src_stages & ~VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT) != 0) {
+			barriers.src_stages |= src_stages;
+			barriers.dst_stages |= stages;
+			barriers.src_access |= src_access;
+			barriers.dst_access |= access;
+		}
+
+		state.layout = layout;
+
+		if (write) {
+			state.write_stages = stages;
+			state.write_access = access;
+			state.read_stages = 0;
+			state.read_access = 0;
+		} else {
+			// The transition is the last write, its barrier already made it
+			// visible to this read.
+			state.write_stages = stages;
+			state.write_access = 0;
+			state.read_stages = stages;
+			state.read_access = access;
+		}
+	}
+
+	void RenderGraph::FlushBarriers(
+		VkCommandBuffer command_buffer,
+		Barriers& barriers
+	) const {
+		if (barriers.src_stages == 0 && barriers.dst_stages == 0) {
+			return;
+		}
+
+		// Buffers are covered by a single global barrier, drivers gain
+		// nothing from per buffer ranges.
+		VkMemoryBarrier memory_barrier = {};
+
+		memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memory_barrier.srcAccessMask = barriers.src_access;
+		memory_barrier.dstAccessMask = barriers.dst_access;
+
+		bool has_memory_barrier = barriers.src_access != 0 || barriers.dst_access != 0;
+
+		vkCmdPipelineBarrier(
+			command_buffer,
+			barriers.src_stages != 0 ? barriers.src_stages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			barriers.dst_stages != 0 ? barriers.dst_stages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0,
+			has_memory_barrier ? 1 : 0,
+			has_memory_barrier ? &memory_barrier : nullptr,
+			0,
+			nullptr,
+			barriers.image_barriers.size(),
+			barriers.image_barriers.data()
+		);
+
+		barriers = {};
+	}
+
+
+	VkRenderPass RenderGraph::FindRenderPass(const std::vector<Attachment>& attachments) {
+		Key key = {};
+
+		for (const Attachment& attachment : attachments) {
+			key.push_back(attachment.format);
+			key.push_back(attachment.layout);
+			key.push_back(attachment.load_op);
+			key.push_back(attachment.store_op);
+		}
+
+		std::unordered_map<Key, VkRenderPass, KeyHash>::iterator it = this->render_passes.find(key);
+		if (it != this->render_passes.end()) {
+			return it->second;
+		}
+
+		std::vector<VkAttachmentDescription> descriptions = {};
+		std::vector<VkAttachmentReference> color_references = {};
+		VkAttachmentReference depth_reference = {};
+		bool has_depth = false;
+
+		for (uint32_t i = 0; i < attachments.size(); i++) {
+			const Attachment& attachment = attachments.at(i);
+
+			// The graph transitions every attachment before the pass, so
+			// the render pass itself never changes layouts.
+			VkAttachmentDescription description = {};
+
+			description.format = attachment.format;
+			description.samples = VK_SAMPLE_COUNT_1_BIT;
+			description.loadOp = attachment.load_op;
+			description.storeOp = attachment.store_op;
+			description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			description.initialLayout = attachment.layout;
+			description.finalLayout = attachment.layout;
+
+			descriptions.push_back(description);
+
+			VkAttachmentReference reference = {};
+
+			reference.attachment = i;
+			reference.layout = attachment.layout;
+
+			if (IsDepthFormat(attachment.format)) {
+				depth_reference = reference;
+				has_depth = true;
+			} else {
+				color_references.push_back(reference);
+			}
+		}
+
+		VkSubpassDescription subpass = {};
+
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = color_references.size();
+		subpass.pColorAttachments = color_references.data();
+		subpass.pDepthStencilAttachment = has_depth ? &depth_reference : nullptr;
+
+		VkRenderPassCreateInfo render_pass_info = {};
+
+		render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		render_pass_info.attachmentCount = descriptions.size();
+		render_pass_info.pAttachments = descriptions.data();
+		render_pass_info.subpassCount = 1;
+		render_pass_info.pSubpasses = &subpass;
+
+		VkRenderPass render_pass = VK_NULL_HANDLE;
+
+		if (vkCreateRenderPass(
+			this->device.GetDevice(),
+			&render_pass_info,
+			nullptr,
+			&render_pass
+		) != VK_SUCCESS) {
+			return VK_NULL_HANDLE;
+		}
+
+		this->render_passes.emplace(key, render_pass);
+
+		return render_pass;
+	}
+
+	VkFramebuffer RenderGraph::FindFramebuffer(
+		VkRenderPass render_pass,
+		const std::vector<VkImageView>& image_views,
+		VkExtent2D extent
+	) {
+		Key key = {};
+
+		key.push_back((uint64_t)render_pass);
+		for (VkImageView image_view : image_views) {
+			key.push_back((uint64_t)image_view);
+		}
+		key.push_back(extent.width);
+		key.push_back(extent.height);
+
+		std::unordered_map<Key, CachedFramebuffer, KeyHash>::iterator it = this->framebuffers.find(key);
+		if (it != this->framebuffers.end()) {
+			it->second.last_used = this->execute_count;
+
+			return it->second.framebuffer;
+		}
+
+		VkFramebufferCreateInfo frame_buffer_info = {};
+
+		frame_buffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		frame_buffer_info.renderPass = render_pass;
+		frame_buffer_info.attachmentCount = image_views.size();
+		frame_buffer_info.pAttachments = image_views.data();
+		frame_buffer_info.width = extent.width;
+		frame_buffer_info.height = extent.height;
+		frame_buffer_info.layers = 1;
+
+		CachedFramebuffer framebuffer = {};
+		framebuffer.last_used = this->execute_count;
+
+		if (vkCreateFramebuffer(
+			this->device.GetDevice(),
+			&frame_buffer_info,
+			nullptr,
+			&framebuffer.framebuffer
+		) != VK_SUCCESS) {
+			return VK_NULL_HANDLE;
+		}
+
+		this->framebuffers.emplace(key, framebuffer);
+
+		return framebuffer.framebuffer;
+	}
+
+
+	void RenderGraph::RetireUnusedFramebuffers() {
+		std::unordered_map<Key, CachedFramebuffer, KeyHash>::iterator it = this->framebuffers.begin();
+
+		while (it != this->framebuffers.end()) {
+			if (it->second.last_used + FRAMEBUFFER_LIFETIME > this->execute_count) {
+				it++;
+				continue;
+			}
+
+			Retired retired = {};
+
+			retired.frame = this->frame_sync.GetSubmittedFrame();
+			retired.framebuffer = it->second.framebuffer;
+
+			this->retired.push_back(std::move(retired));
+
+			it = this->framebuffers.erase(it);
+		}
+	}
+
+	void RenderGraph::DestroyRetired(bool wait) {
+		std::vector<Retired>::iterator it = this->retired.begin();
+
+		while (it != this->retired.end()) {
+			if (!wait && !this->frame_sync.IsFrameComplete(it->frame)) {
+				it++;
+				continue;
+			}
+
+			DestroyPlacement(it->placement);
+
+			if (it->framebuffer != VK_NULL_HANDLE) {
+				vkDestroyFramebuffer(
+					this->device.GetDevice(),
+					it->framebuffer,
+					nullptr
+				);
+			}
+
+			it = this->retired.erase(it);
+		}
+	}
+
+
+	bool RenderGraph::IsDepthFormat(VkFormat format) {
+		switch (format) {
+		case VK_FORMAT_D16_UNORM:
+		case VK_FORMAT_X8_D24_UNORM_PACK32:
+		case VK_FORMAT_D32_SFLOAT:
+		case VK_FORMAT_D16_UNORM_S8_UINT:
+		case VK_FORMAT_D24_UNORM_S8_UINT:
+		case VK_FORMAT_D32_SFLOAT_S8_UINT:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	VkImageAspectFlags RenderGraph::GetAspectMask(VkFormat format) {
+		switch (format) {
+		case VK_FORMAT_D16_UNORM_S8_UINT:
+		case VK_FORMAT_D24_UNORM_S8_UINT:
+		case VK_FORMAT_D32_SFLOAT_S8_UINT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+		default:
+			return IsDepthFormat(format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,337 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <functional>
+#include <unordered_map>
+
+#include <vulkan/vulkan.h>
+
+#include "device.h"
+#include "allocator.h"
+#include "frame_sync.h"
+#include "gpu_profiler.h"
+
+namespace yib {
+	struct RenderGraphImageInfo {
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		VkExtent2D extent = {};
+	};
+
+	// The state an imported resource is in before the graph runs, or has to
+	// be left in once it is done.
+	struct RenderGraphState {
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		VkAccessFlags access = 0;
+	};
+
+	// Passes are declared every frame in the order they run, together with
+	// the resources they read and write. Executing the graph culls passes
+	// that contribute nothing to an imported resource, places transient
+	// images whose lifetimes don't overlap in the same memory and records
+	// the remaining passes with the barriers between them.
+	class RenderGraph {
+	public:
+		typedef uint32_t Resource;
+
+		struct PassContext {
+			VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+			// Null for compute passes.
+			VkRenderPass render_pass = VK_NULL_HANDLE;
+			VkFramebuffer framebuffer = VK_NULL_HANDLE;
+			VkExtent2D extent = {};
+		};
+
+		typedef std::function<bool(const PassContext& context)> RecordFunction;
+
+		class PassBuilder {
+		public:
+			// Without a clear value the previous contents are loaded.
+			bool WriteColor(
+				Resource resource,
+				std::optional<VkClearColorValue> clear = std::nullopt
+			);
+			bool WriteDepth(
+				Resource resource,
+				std::optional<VkClearDepthStencilValue> clear = std::nullopt
+			);
+			bool ReadImage(
+				Resource resource,
+				VkPipelineStageFlags stages
+			);
+			bool ReadBuffer(
+				Resource resource,
+				VkPipelineStageFlags stages,
+				VkAccessFlags access
+			);
+			bool WriteBuffer(
+				Resource resource,
+				VkPipelineStageFlags stages,
+				VkAccessFlags access
+			);
+
+			// The render pass then only takes secondary command buffers.
+			void UseSecondaryCommandBuffers();
+			// Keeps the pass even when nothing reads what it writes.
+			void KeepAlive();
+			void SetRecord(RecordFunction record);
+		private:
+			PassBuilder(
+				RenderGraph& graph,
+				uint32_t pass
+			);
+
+			RenderGraph& graph;
+			uint32_t pass;
+
+			friend class RenderGraph;
+		};
+
+		RenderGraph(
+			Device& device,
+			FrameSync& frame_sync,
+			GpuProfiler* gpu_profiler = nullptr
+		);
+		~RenderGraph();
+
+		RenderGraph(const RenderGraph&) = delete;
+		RenderGraph& operator=(const RenderGraph&) = delete;
+
+		// Forgets the passes and resources of the last frame, the images,
+		// render passes and framebuffers behind them stay cached.
+		void Reset();
+
+		Resource CreateImage(
+			const std::string& name,
+			const RenderGraphImageInfo& info
+		);
+		Resource ImportImage(
+			const std::string& name,
+			VkImage image,
+			VkImageView image_view,
+			const RenderGraphImageInfo& info,
+			const RenderGraphState& initial_state,
+			const RenderGraphState& final_state
+		);
+		Resource ImportBuffer(
+			const std::string& name,
+			VkBuffer buffer,
+			const RenderGraphState& initial_state = {},
+			const RenderGraphState& final_state = {}
+		);
+
+		PassBuilder AddPass(
+			const std::string& name,
+			VkPipelineBindPoint bind_point
+		);
+
+		// Transient images only exist while their passes are recorded.
+		VkImage GetImage(Resource resource) const;
+		VkImageView GetImageView(Resource resource) const;
+		VkBuffer GetBuffer(Resource resource) const;
+
+		// Has to be recorded outside of a render pass, once per frame.
+		bool Execute(VkCommandBuffer command_buffer);
+
+		// Destroys every cached framebuffer once the frames using it are
+		// done, has to be called before imported image views are destroyed.
+		void RetireFramebuffers();
+
+		// Compatible with every graphics pass writing these formats, so
+		// pipelines can be created before the graph first runs.
+		VkRenderPass GetCompatibleRenderPass(
+			const std::vector<VkFormat>& color_formats,
+			VkFormat depth_format
+		);
+
+		uint32_t GetCulledPassCount() const;
+		// Memory bound to transient images, and what they would take up
+		// without aliasing.
+		VkDeviceSize GetTransientMemorySize() const;
+		VkDeviceSize GetTransientImageSize() const;
+
+		bool success;
+	private:
+		typedef std::vector<uint64_t> Key;
+
+		struct KeyHash {
+			size_t operator()(const Key& key) const;
+		};
+
+		struct Use {
+			Resource resource = 0;
+			VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkPipelineStageFlags stages = 0;
+			VkAccessFlags access = 0;
+			VkImageUsageFlags usage = 0;
+			bool read = false;
+			bool write = false;
+			std::optional<VkClearValue> clear = std::nullopt;
+		};
+
+		struct Pass {
+			std::string name;
+			VkPipelineBindPoint bind_point = VK_PIPELINE_BIND_POINT_GRAPHICS;
+			std::vector<Use> uses = {};
+			RecordFunction record = nullptr;
+			bool secondary = false;
+			bool keep_alive = false;
+			bool culled = false;
+			uint32_t ref_count = 0;
+		};
+
+		// Readers that already waited on the last write are tracked, so
+		// further readers in the same stages need no barrier.
+		struct State {
+			VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkPipelineStageFlags write_stages = 0;
+			VkAccessFlags write_access = 0;
+			VkPipelineStageFlags read_stages = 0;
+			VkAccessFlags read_access = 0;
+		};
+
+		struct ResourceNode {
+			std::string name;
+			bool is_image = false;
+			bool imported = false;
+			RenderGraphImageInfo info = {};
+			VkImageUsageFlags usage = 0;
+
+			VkImage image = VK_NULL_HANDLE;
+			VkImageView image_view = VK_NULL_HANDLE;
+			VkBuffer buffer = VK_NULL_HANDLE;
+
+			RenderGraphState initial_state = {};
+			RenderGraphState final_state = {};
+			State state = {};
+
+			uint32_t ref_count = 0;
+			uint32_t first_pass = UINT32_MAX;
+			uint32_t last_pass = 0;
+			// Index of the placed image, UINT32_MAX for imported resources.
+			uint32_t transient = UINT32_MAX;
+		};
+
+		// Memory shared by transient images that are never alive at once.
+		struct Heap {
+			Allocation allocation = {};
+			VkDeviceSize size = 0;
+			VkDeviceSize alignment = 1;
+			uint32_t memory_type_bits = UINT32_MAX;
+			// How the last image placed here was used, across frames too,
+			// the next one has to wait for it.
+			VkPipelineStageFlags stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+			VkAccessFlags access = 0;
+		};
+
+		struct TransientImage {
+			VkImage image = VK_NULL_HANDLE;
+			VkImageView image_view = VK_NULL_HANDLE;
+			VkDeviceSize size = 0;
+			uint32_t heap = UINT32_MAX;
+			uint32_t first_pass = 0;
+			uint32_t last_pass = 0;
+		};
+
+		struct Placement {
+			Key key = {};
+			std::vector<TransientImage> images = {};
+			std::vector<Heap> heaps = {};
+		};
+
+		struct Attachment {
+			VkFormat format = VK_FORMAT_UNDEFINED;
+			VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkAttachmentLoadOp load_op = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			VkAttachmentStoreOp store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		};
+
+		struct CachedFramebuffer {
+			VkFramebuffer framebuffer = VK_NULL_HANDLE;
+			uint64_t last_used = 0;
+		};
+
+		struct Barriers {
+			VkPipelineStageFlags src_stages = 0;
+			VkPipelineStageFlags dst_stages = 0;
+			VkAccessFlags src_access = 0;
+			VkAccessFlags dst_access = 0;
+			std::vector<VkImageMemoryBarrier> image_barriers = {};
+		};
+
+		// Destroyed once the last frame that may still use it completed.
+		struct Retired {
+			uint64_t frame = 0;
+			Placement placement = {};
+			VkFramebuffer framebuffer = VK_NULL_HANDLE;
+		};
+
+		bool AddUse(
+			uint32_t pass,
+			const Use& use
+		);
+
+		void CullPasses();
+		void ComputeLifetimes();
+
+		bool PlaceTransientImages();
+		bool CreatePlacement(Placement& placement);
+		void DestroyPlacement(Placement& placement);
+
+		bool RecordPass(
+			VkCommandBuffer command_buffer,
+			uint32_t pass
+		);
+		bool BeginRenderPass(
+			uint32_t pass,
+			PassContext& context
+		);
+
+		void Transition(
+			ResourceNode& resource,
+			VkImageLayout layout,
+			VkPipelineStageFlags stages,
+			VkAccessFlags access,
+			bool write,
+			Barriers& barriers
+		) const;
+		void FlushBarriers(
+			VkCommandBuffer command_buffer,
+			Barriers& barriers
+		) const;
+
+		VkRenderPass FindRenderPass(const std::vector<Attachment>& attachments);
+		VkFramebuffer FindFramebuffer(
+			VkRenderPass render_pass,
+			const std::vector<VkImageView>& image_views,
+			VkExtent2D extent
+		);
+
+		void RetireUnusedFramebuffers();
+		void DestroyRetired(bool wait);
+
+		static bool IsDepthFormat(VkFormat format);
+		static VkImageAspectFlags GetAspectMask(VkFormat format);
+
+		// Framebuffers unused for this many executions are destroyed, which
+		// drops the ones of a recreated swap chain.
+		static constexpr uint32_t FRAMEBUFFER_LIFETIME = 8;
+
+		Device& device;
+		FrameSync& frame_sync;
+		GpuProfiler* gpu_profiler;
+
+		std::vector<Pass> passes = {};
+		std::vector<ResourceNode> resources = {};
+		uint32_t culled_pass_count = 0;
+
+		Placement placement = {};
+		std::unordered_map<Key, VkRenderPass, KeyHash> render_passes = {};
+		std::unordered_map<Key, CachedFramebuffer, KeyHash> framebuffers = {};
+		std::vector<Retired> retired = {};
+		uint64_t execute_count = 0;
+	};
+}
\ No newline at end of file
@@ -1,26 +1,50 @@
 #include "render_system.h"
 
+#include <map>
+#include <algorithm>
+
+#include "../../shared/profiler.h"
+
 namespace yib {
 	RenderSystem::RenderSystem(
 		Device& device,
+		PipelineRegistry& pipeline_registry,
 		uint32_t width,
 		uint32_t height,
 		VkRenderPass render_pass,
-		VkDescriptorSetLayout set_layout
+		VkDescriptorSetLayout set_layout,
+		const VertexLayout& vertex_layout
 	) :
 	device(device),
 	render_pass(render_pass),
-	pipeline(std::make_unique<Pipeline>(
-		device,
-		width,
-		height,
-		"D:/documents/projects/Yibengine/src/client/shaders/simple.vert.spv",
-		"D:/documents/projects/Yibengine/src/client/shaders/simple.frag.spv",
-		CreatePipelineConfig(set_layout)
-	)),
+	vertex_layout(vertex_layout),
+	bindless_textures(device.GetBindlessTextures()),
+	max_draw_indirect_count(device.GetPhysicalDeviceProperties().limits.maxDrawIndirectCount),
+	gpu_culling(device),
+	meshlet_culling(device),
 	success(false)
 	{
-		if (!this->pipeline->success) {
+		if (!this->gpu_culling.success) {
+			return;
+		}
+
+		if (!this->meshlet_culling.success) {
+			return;
+		}
+
+		// Without descriptor indexing every object samples the texture bound
+		// at set 0.
+		this->pipeline = pipeline_registry.Get(
+			width,
+			height,
+			"D:/documents/projects/Yibengine/src/client/shaders/simple.vert.spv",
+			this->bindless_textures != nullptr ?
+				"D:/documents/projects/Yibengine/src/client/shaders/bindless.frag.spv" :
+				"D:/documents/projects/Yibengine/src/client/shaders/simple.frag.spv",
+			CreatePipelineConfig(set_layout),
+			true
+		);
+		if (this->pipeline == nullptr) {
 			return;
 		}
 
@@ -28,12 +52,240 @@ namespace yib {
 	}
 
 
-	void RenderSystem::RenderModels(
-		VkCommandBuffer command_buffer,
+	std::vector<VkVertexInputBindingDescription> RenderSystem::InstanceData::GetBindingDescription() {
+		std::vector<VkVertexInputBindingDescription> binding_descriptions(1);
+
+		binding_descriptions.at(0).binding = 1;
+		binding_descriptions.at(0).stride = sizeof(InstanceData);
+		binding_descriptions.at(0).inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+		return binding_descriptions;
+	}
+
+	std::vector<VkVertexInputAttributeDescription> RenderSystem::InstanceData::GetAttributeDescriptions() {
+		static_assert(sizeof(InstanceData) == sizeof(CullInstance));
+
+		std::vector<VkVertexInputAttributeDescription> attribute_descriptions(5);
+
+		// A mat4 attribute takes one location per column.
+		for (uint32_t i = 0; i < 4; i++) {
+			attribute_descriptions.at(i).binding = 1;
+			attribute_descriptions.at(i).location = 3 + i;
+			attribute_descriptions.at(i).format = VK_FORMAT_R32G32B32A32_SFLOAT;
+			attribute_descriptions.at(i).offset = offsetof(InstanceData, model_matrix) + sizeof(glm::vec4) * i;
+		}
+
+		attribute_descriptions.at(4).binding = 1;
+		attribute_descriptions.at(4).location = 7;
+		attribute_descriptions.at(4).format = VK_FORMAT_R32_UINT;
+		attribute_descriptions.at(4).offset = offsetof(InstanceData, texture_index);
+
+		return attribute_descriptions;
+	}
+
+
+	bool RenderSystem::CullModels(
+		uint32_t frame_index,
 		std::vector<std::shared_ptr<Object>> objects,
 		const Camera& camera,
-		VkDescriptorSet descriptor_set
+		const VkExtent2D& extent
 	) {
+		YIB_PROFILE_FUNCTION();
+
+		// The pipeline compiles asynchronously, a failed compile would
+		// otherwise just skip every draw.
+		if (this->pipeline->HasFailed()) {
+			return false;
+		}
+
+		this->draw_models.clear();
+		this->draw_first_instances.clear();
+		this->draws.clear();
+		this->cull_objects.clear();
+		this->meshlet_instances.clear();
+		this->model_matrices.clear();
+		this->model_scales.clear();
+		this->bounding_spheres.Clear();
+		this->triangle_count = 0;
+
+		glm::mat4 projection_view = camera.GetProjectionMatrix() * camera.GetViewMatrix();
+
+		for (std::shared_ptr<Object> object : objects) {
+			object->transform.rotation.y = glm::mod(
+				object->transform.rotation.y + 0.001f,
+				glm::two_pi<float>()
+			);
+			object->transform.rotation.x = glm::mod(
+				object->transform.rotation.x + 0.0005f,
+				glm::two_pi<float>()
+			);
+
+			glm::mat4 model_matrix = object->transform.GetMatrix();
+			const Bounds& bounds = object->model->GetBounds();
+
+			float scale = glm::max(
+				glm::length(glm::vec3(model_matrix[0])),
+				glm::max(glm::length(glm::vec3(model_matrix[1])), glm::length(glm::vec3(model_matrix[2])))
+			);
+
+			this->model_matrices.push_back(model_matrix);
+			this->model_scales.push_back(scale);
+			this->bounding_spheres.Add(
+				glm::vec3(model_matrix * glm::vec4(bounds.center, 1.0f)),
+				bounds.radius * scale
+			);
+		}
+
+		// Objects outside the frustum are dropped here and never reach the
+		// gpu, which then only has to compact the survivors.
+		Frustum frustum = Frustum(projection_view);
+		frustum.Cull(this->bounding_spheres, this->visible_objects);
+
+		// Height of the viewport in pixels over the height of the view at
+		// distance one.
+		float pixels_per_unit = glm::abs(camera.GetProjectionMatrix()[1][1]) * extent.height * 0.5f;
+
+		// Every lod of a model is its own draw.
+		std::map<std::pair<Model*, uint32_t>, uint32_t> draw_indices = {};
+
+		for (uint32_t index : this->visible_objects) {
+			const std::shared_ptr<Object>& object = objects.at(index);
+
+			glm::vec3 center = glm::vec3(
+				this->bounding_spheres.x.at(index),
+				this->bounding_spheres.y.at(index),
+				this->bounding_spheres.z.at(index)
+			);
+			glm::vec3 view_center = glm::vec3(camera.GetViewMatrix() * glm::vec4(center, 1.0f));
+
+			object->lod = SelectLod(
+				*object->model,
+				object->lod,
+				this->model_scales.at(index),
+				glm::length(view_center) - this->bounding_spheres.radius.at(index),
+				pixels_per_unit
+			);
+
+			uint32_t texture_index = 0;
+			if (object->texture != nullptr && object->texture->GetBindlessIndex().has_value()) {
+				texture_index = object->texture->GetBindlessIndex().value();
+			}
+
+			if (object->lod == 0 && object->model->GetMeshletCount() != 0) {
+				MeshletCulling::Instance instance = {};
+				instance.model = object->model.get();
+				instance.model_matrix = this->model_matrices.at(index);
+				instance.texture_index = texture_index;
+
+				this->meshlet_instances.push_back(instance);
+				this->triangle_count += object->model->GetLod(0).index_count / 3;
+
+				continue;
+			}
+
+			std::pair<Model*, uint32_t> draw_key = { object->model.get(), object->lod };
+
+			std::map<std::pair<Model*, uint32_t>, uint32_t>::iterator it = draw_indices.find(draw_key);
+			if (it == draw_indices.end()) {
+				it = draw_indices.emplace(draw_key, this->draws.size()).first;
+
+				this->draw_models.push_back(object->model.get());
+				this->draw_first_instances.push_back(0);
+				this->draws.push_back(object->model->GetIndirectCommand(object->lod));
+			}
+
+			this->triangle_count += this->draws.at(it->second).indexCount / 3;
+
+			CullObject cull_object = {};
+			cull_object.model_matrix = this->model_matrices.at(index);
+			cull_object.bounding_sphere = glm::vec4(
+				object->model->GetBounds().center,
+				object->model->GetBounds().radius
+			);
+			cull_object.draw_index = it->second;
+			cull_object.texture_index = texture_index;
+
+			this->cull_objects.push_back(cull_object);
+
+			// Counts objects per draw for now, turned into offsets below.
+			this->draw_first_instances.at(it->second)++;
+		}
+
+		uint32_t first_instance = 0;
+		for (uint32_t& draw_first_instance : this->draw_first_instances) {
+			uint32_t instance_count = draw_first_instance;
+
+			draw_first_instance = first_instance;
+			first_instance += instance_count;
+		}
+
+		for (CullObject& cull_object : this->cull_objects) {
+			cull_object.first_instance = this->draw_first_instances.at(cull_object.draw_index);
+		}
+
+		if (!this->gpu_culling.Prepare(
+			frame_index,
+			projection_view,
+			this->cull_objects,
+			this->draws
+		)) {
+			this->draw_models.clear();
+			return false;
+		}
+
+		// Each model's meshlets are culled by one dispatch.
+		std::stable_sort(
+			this->meshlet_instances.begin(),
+			this->meshlet_instances.end(),
+			[](const MeshletCulling::Instance& a, const MeshletCulling::Instance& b) {
+				return a.model < b.model;
+			}
+		);
+
+		if (!this->meshlet_culling.Prepare(
+			frame_index,
+			projection_view,
+			glm::vec3(glm::inverse(camera.GetViewMatrix())[3]),
+			this->meshlet_instances
+		)) {
+			this->draw_models.clear();
+			this->meshlet_instances.clear();
+			return false;
+		}
+
+		return true;
+	}
+
+	void RenderSystem::RecordCulling(
+		VkCommandBuffer command_buffer,
+		uint32_t frame_index
+	) const {
+		this->gpu_culling.Dispatch(
+			command_buffer,
+			frame_index
+		);
+		this->meshlet_culling.Dispatch(
+			command_buffer,
+			frame_index
+		);
+	}
+
+	void RenderSystem::RenderModels(
+		VkCommandBuffer command_buffer,
+		uint32_t frame_index,
+		VkDescriptorSet descriptor_set,
+		uint32_t global_offset,
+		uint32_t first_draw,
+		uint32_t last_draw
+	) const {
+		YIB_PROFILE_FUNCTION();
+
+		last_draw = std::min<uint32_t>(last_draw, GetDrawCount());
+
+		if (!this->pipeline->IsReady() || first_draw >= last_draw) {
+			return;
+		}
+
 		this->pipeline->BindCommandBuffer(command_buffer);
 
 		vkCmdBindDescriptorSets(
@@ -43,61 +295,254 @@ namespace yib {
 			0,
 			1,
 			&descriptor_set,
-			0,
-			nullptr
+			1,
+			&global_offset
 		);
 
-		for (std::shared_ptr<Object> object : objects) {
-			object->transform.rotation.y = glm::mod(
-				object->transform.rotation.y + 0.001f,
-				glm::two_pi<float>()
+		if (this->bindless_textures != nullptr) {
+			VkDescriptorSet bindless_set = this->bindless_textures->GetDescriptorSet();
+
+			vkCmdBindDescriptorSets(
+				command_buffer,
+				VK_PIPELINE_BIND_POINT_GRAPHICS,
+				this->pipeline->GetPipelineLayout(),
+				1,
+				1,
+				&bindless_set,
+				0,
+				nullptr
 			);
-			object->transform.rotation.x = glm::mod(
-				object->transform.rotation.x + 0.0005f,
-				glm::two_pi<float>()
+		}
+
+		VkBuffer instance_buffer = this->gpu_culling.GetInstanceBuffer(frame_index);
+		VkBuffer draw_buffer = this->gpu_culling.GetDrawBuffer(frame_index);
+
+		// Each draw reads its instances from an offset binding instead of
+		// through firstInstance, which indirect draws only allow with the
+		// drawIndirectFirstInstance feature.
+		uint32_t last_model_draw = std::min<uint32_t>(last_draw, this->draw_models.size());
+
+		for (uint32_t i = first_draw; i < last_model_draw; i++) {
+			VkDeviceSize offsets[] = { sizeof(InstanceData) * this->draw_first_instances.at(i) };
+
+			this->draw_models.at(i)->Bind(command_buffer);
+
+			vkCmdPushConstants(
+				command_buffer,
+				this->pipeline->GetPipelineLayout(),
+				VK_SHADER_STAGE_VERTEX_BIT,
+				0,
+				sizeof(VertexDecode),
+				&this->draw_models.at(i)->GetVertexDecode()
+			);
+
+			vkCmdBindVertexBuffers(
+				command_buffer,
+				1,
+				1,
+				&instance_buffer,
+				offsets
+			);
+
+			this->draw_models.at(i)->DrawIndirect(
+				command_buffer,
+				draw_buffer,
+				GpuCulling::DRAW_STRIDE * i
 			);
+		}
+
+		if (last_draw <= this->draw_models.size()) {
+			return;
+		}
+
+		VkBuffer meshlet_instance_buffer = this->meshlet_culling.GetInstanceBuffer(frame_index);
+		VkBuffer meshlet_draw_buffer = this->meshlet_culling.GetDrawBuffer(frame_index);
+		VkBuffer meshlet_index_buffer = this->meshlet_culling.GetIndexBuffer(frame_index);
+
+		// Every meshlet draw reads the compacted indices, the models only
+		// bind their vertex streams.
+		vkCmdBindIndexBuffer(
+			command_buffer,
+			meshlet_index_buffer,
+			0,
+			VK_INDEX_TYPE_UINT32
+		);
+
+		bool multi_draw = this->device.SupportsMultiDrawIndirect();
+
+		if (multi_draw) {
+			VkDeviceSize offsets[] = { 0 };
+
+			vkCmdBindVertexBuffers(
+				command_buffer,
+				1,
+				1,
+				&meshlet_instance_buffer,
+				offsets
+			);
+		}
+
+		uint32_t first_meshlet_draw = std::max<uint32_t>(first_draw, this->draw_models.size()) - this->draw_models.size();
+		uint32_t last_meshlet_draw = last_draw - this->draw_models.size();
 
-			PushConstant push_constant = { };
-			push_constant.model_matrix = object->transform.GetMatrix();
+		// Instances of one model follow each other, so each model binds its
+		// state once for its whole run of draws.
+		for (uint32_t run_start = first_meshlet_draw; run_start < last_meshlet_draw;) {
+			const Model* model = this->meshlet_instances.at(run_start).model;
+
+			uint32_t run_end = run_start + 1;
+			while (run_end < last_meshlet_draw && this->meshlet_instances.at(run_end).model == model) {
+				run_end++;
+			}
+
+			model->Bind(command_buffer, false);
 
 			vkCmdPushConstants(
 				command_buffer,
 				this->pipeline->GetPipelineLayout(),
 				VK_SHADER_STAGE_VERTEX_BIT,
 				0,
-				sizeof(PushConstant),
-				&push_constant
+				sizeof(VertexDecode),
+				&model->GetVertexDecode()
 			);
 
-			object->model->Bind(command_buffer);
-			object->model->Draw(command_buffer);
+			if (multi_draw) {
+				for (uint32_t first = run_start; first < run_end; first += this->max_draw_indirect_count) {
+					vkCmdDrawIndexedIndirect(
+						command_buffer,
+						meshlet_draw_buffer,
+						GpuCulling::DRAW_STRIDE * first,
+						std::min(run_end - first, this->max_draw_indirect_count),
+						GpuCulling::DRAW_STRIDE
+					);
+				}
+			} else {
+				// Without firstInstance each draw reads its instance from an
+				// offset binding.
+				for (uint32_t meshlet_draw = run_start; meshlet_draw < run_end; meshlet_draw++) {
+					VkDeviceSize offsets[] = { sizeof(InstanceData) * meshlet_draw };
+
+					vkCmdBindVertexBuffers(
+						command_buffer,
+						1,
+						1,
+						&meshlet_instance_buffer,
+						offsets
+					);
+
+					vkCmdDrawIndexedIndirect(
+						command_buffer,
+						meshlet_draw_buffer,
+						GpuCulling::DRAW_STRIDE * meshlet_draw,
+						1,
+						GpuCulling::DRAW_STRIDE
+					);
+				}
+			}
+
+			run_start = run_end;
 		}
 	}
 
 
+	uint32_t RenderSystem::GetDrawCount() const {
+		return this->draw_models.size() + this->meshlet_instances.size();
+	}
+
+	uint64_t RenderSystem::GetTriangleCount() const {
+		return this->triangle_count;
+	}
+
+	VkBuffer RenderSystem::GetDrawBuffer(uint32_t frame_index) const {
+		return this->gpu_culling.GetDrawBuffer(frame_index);
+	}
+
+	VkBuffer RenderSystem::GetInstanceBuffer(uint32_t frame_index) const {
+		return this->gpu_culling.GetInstanceBuffer(frame_index);
+	}
+
+	VkBuffer RenderSystem::GetMeshletDrawBuffer(uint32_t frame_index) const {
+		return this->meshlet_culling.GetDrawBuffer(frame_index);
+	}
+
+	VkBuffer RenderSystem::GetMeshletIndexBuffer(uint32_t frame_index) const {
+		return this->meshlet_culling.GetIndexBuffer(frame_index);
+	}
+
+
 	PipelineConfig RenderSystem::CreatePipelineConfig(VkDescriptorSetLayout set_layout) const {
 		PipelineConfig config = Pipeline::CreateDefaultConfig(this->render_pass);
 
+		config.binding_descriptions = this->vertex_layout.GetBindingDescriptions();
+		config.attribute_descriptions = this->vertex_layout.GetAttributeDescriptions();
+
+		std::vector<VkVertexInputBindingDescription> instance_bindings = InstanceData::GetBindingDescription();
+		std::vector<VkVertexInputAttributeDescription> instance_attributes = InstanceData::GetAttributeDescriptions();
+
+		config.binding_descriptions.insert(
+			config.binding_descriptions.end(),
+			instance_bindings.begin(),
+			instance_bindings.end()
+		);
+		config.attribute_descriptions.insert(
+			config.attribute_descriptions.end(),
+			instance_attributes.begin(),
+			instance_attributes.end()
+		);
+
+		config.set_layouts = {
+			set_layout
+		};
+
+		if (this->bindless_textures != nullptr) {
+			config.set_layouts.push_back(this->bindless_textures->GetDescriptorSetLayout());
+		}
+
 		VkPushConstantRange push_constant_range = {};
 
 		push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 		push_constant_range.offset = 0;
-		push_constant_range.size = sizeof(PushConstant);
+		push_constant_range.size = sizeof(VertexDecode);
 
 		config.push_constant_ranges = {
 			push_constant_range
 		};
 
+		config.pipeline_layout_info.setLayoutCount = config.set_layouts.size();
+		config.pipeline_layout_info.pSetLayouts = config.set_layouts.data();
 		config.pipeline_layout_info.pushConstantRangeCount = config.push_constant_ranges.size();
 		config.pipeline_layout_info.pPushConstantRanges = config.push_constant_ranges.data();
 
-		config.set_layouts = {
-			set_layout
-		};
+		return config;
+	}
 
-		config.pipeline_layout_info.setLayoutCount = config.set_layouts.size();
-		config.pipeline_layout_info.pSetLayouts = config.set_layouts.data();
+	uint32_t RenderSystem::SelectLod(
+		const Model& model,
+		uint32_t current_lod,
+		float scale,
+		float distance,
+		float pixels_per_unit
+	) const {
+		// The camera is inside the bounds.
+		if (distance <= 0.0f) {
+			return 0;
+		}
 
-		return config;
+		current_lod = std::min(current_lod, model.GetLodCount() - 1);
+
+		for (uint32_t lod = model.GetLodCount() - 1; lod > 0; lod--) {
+			float screen_error = model.GetLod(lod).error * scale / distance * pixels_per_unit;
+
+			float limit = LOD_ERROR_PIXELS;
+			if (lod > current_lod) {
+				limit *= 1.0f - LOD_HYSTERESIS;
+			}
+
+			if (screen_error <= limit) {
+				return lod;
+			}
+		}
+
+		return 0;
 	}
 }
\ No newline at end of file
@@ -9,43 +9,123 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "model.h"
+#include "buffer.h"
 #include "camera.h"
 #include "device.h"
 #include "pipeline.h"
+#include "swapchain.h"
+#include "frustum.h"
+#include "gpu_culling.h"
+#include "meshlet_culling.h"
+#include "bindless_textures.h"
+#include "pipeline_registry.h"
 #include "descriptors.h"
 #include "../object.h"
 
 namespace yib {
 	class RenderSystem {
 	public:
-		struct PushConstant {
+		// Written by the culling pass, so it has to match CullInstance.
+		struct InstanceData {
 			glm::mat4 model_matrix{ 1.0f };
+			uint32_t texture_index = 0;
+			uint32_t padding[3] = {};
+
+			static std::vector<VkVertexInputBindingDescription> GetBindingDescription();
+			static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions();
 		};
 
 		RenderSystem(
 			Device& device,
+			PipelineRegistry& pipeline_registry,
 			uint32_t width,
 			uint32_t height,
 			VkRenderPass render_pass,
-			VkDescriptorSetLayout set_layout
+			VkDescriptorSetLayout set_layout,
+			const VertexLayout& vertex_layout
 		);
 
 		RenderSystem(const RenderSystem&) = delete;
 		RenderSystem& operator=(const RenderSystem&) = delete;
 
-		void RenderModels(
-			VkCommandBuffer command_buffer,
+		// Culls on the cpu, picks each survivor's lod and uploads them for
+		// RecordCulling to compact on the gpu.
+		bool CullModels(
+			uint32_t frame_index,
 			std::vector<std::shared_ptr<Object>> objects,
 			const Camera& camera,
-			VkDescriptorSet descriptor_set
+			const VkExtent2D& extent
 		);
+		// Writes the draw, instance and meshlet index buffers, has to be
+		// recorded outside of a render pass.
+		void RecordCulling(
+			VkCommandBuffer command_buffer,
+			uint32_t frame_index
+		) const;
+		// Only reads state written by CullModels, so several threads can
+		// record separate draw ranges at once.
+		void RenderModels(
+			VkCommandBuffer command_buffer,
+			uint32_t frame_index,
+			VkDescriptorSet descriptor_set,
+			uint32_t global_offset,
+			uint32_t first_draw = 0,
+			uint32_t last_draw = UINT32_MAX
+		) const;
+
+		// Counts meshlet draws after the regular ones.
+		uint32_t GetDrawCount() const;
+		// Triangles the last CullModels sent to the gpu, before gpu culling.
+		uint64_t GetTriangleCount() const;
+		// Both change when CullModels outgrows them.
+		VkBuffer GetDrawBuffer(uint32_t frame_index) const;
+		VkBuffer GetInstanceBuffer(uint32_t frame_index) const;
+		VkBuffer GetMeshletDrawBuffer(uint32_t frame_index) const;
+		VkBuffer GetMeshletIndexBuffer(uint32_t frame_index) const;
+
+		// Largest error in pixels a lod may show on screen.
+		static constexpr float LOD_ERROR_PIXELS = 1.0f;
+		// Switching to a coarser lod needs its error this much below the
+		// limit, so objects near a switch distance don't flicker.
+		static constexpr float LOD_HYSTERESIS = 0.25f;
 
 		bool success;
 	private:
 		PipelineConfig CreatePipelineConfig(VkDescriptorSetLayout set_layout) const;
+		uint32_t SelectLod(
+			const Model& model,
+			uint32_t current_lod,
+			float scale,
+			float distance,
+			float pixels_per_unit
+		) const;
 
 		Device& device;
 		VkRenderPass render_pass;
+		// Every model drawn has to be built with this layout.
+		VertexLayout vertex_layout;
+		BindlessTextures* bindless_textures;
+		// Only matters with multi draw indirect, which guarantees at least
+		// 2^16 - 1.
+		uint32_t max_draw_indirect_count;
 		std::shared_ptr<Pipeline> pipeline;
+		GpuCulling gpu_culling;
+		MeshletCulling meshlet_culling;
+
+		std::vector<Model*> draw_models = {};
+		std::vector<uint32_t> draw_first_instances = {};
+		std::vector<VkDrawIndexedIndirectCommand> draws = {};
+		std::vector<CullObject> cull_objects = {};
+
+		// Objects close enough for their finest lod draw only the meshlets
+		// that survive culling.
+		std::vector<MeshletCulling::Instance> meshlet_instances = {};
+
+		std::vector<glm::mat4> model_matrices = {};
+		std::vector<float> model_scales = {};
+		BoundingSpheres bounding_spheres = {};
+		std::vector<uint32_t> visible_objects = {};
+
+		uint64_t triangle_count = 0;
 	};
 }
\ No newline at end of file
@@ -1,57 +1,158 @@
 #include "renderer.h"
 
-#include <array>
+#include "uploader.h"
+#include "../../shared/profiler.h"
+
+#include <chrono>
+#include <cstdio>
 
 namespace yib {
 	Renderer::Renderer(
 		const std::string name,
 		uint32_t width,
 		uint32_t height,
-		Window& window,
-		Device& device
+		Window* window,
+		Device& device,
+		uint32_t record_threads,
+		const FramePacing& pacing
 	) :
 		window(window),
 		device(device),
-		swap_chain(std::make_unique<SwapChain>(
-			device,
-			VkExtent2D(
-				window.GetWidth(),
-				window.GetHeight()
-			)
-		)),
+		frame_pacer(pacing),
 		image_index(0),
 		frame_index(0),
 		frame_began(false),
 		success(false)
 	{
-		if (!this->swap_chain->success) {
+		this->frame_sync = std::make_unique<FrameSync>(
+			device,
+			SwapChain::MAX_FRAMES_IN_FLIGHT
+		);
+
+		if (!this->frame_sync->success) {
 			return;
 		}
 
+		if (IsHeadless()) {
+			this->offscreen = std::make_unique<OffscreenTarget>(
+				device,
+				VkExtent2D(
+					width,
+					height
+				),
+				*this->frame_sync
+			);
+
+			if (!this->offscreen->success) {
+				return;
+			}
+		} else {
+			this->swap_chain = std::make_unique<SwapChain>(
+				device,
+				VkExtent2D(
+					window->GetWidth(),
+					window->GetHeight()
+				),
+				this->frame_pacer.GetPacing(),
+				*this->frame_sync
+			);
+
+			if (!this->swap_chain->success) {
+				return;
+			}
+
+			printf(
+				"Presenting with %s, %u images, %u frames in flight\n",
+				FramePacing::GetPresentModeName(this->swap_chain->GetPresentMode()),
+				this->swap_chain->GetImageCount(),
+				this->frame_pacer.GetFramesInFlight()
+			);
+		}
+
 		if (!CreateCommandBuffers()) {
 			return;
 		}
 
+		if (!CreateDescriptorAllocators()) {
+			return;
+		}
+
+		this->uniform_ring = std::make_unique<UniformRing>(device);
+
+		if (!this->uniform_ring->success) {
+			return;
+		}
+
+		this->gpu_profiler = std::make_unique<GpuProfiler>(device);
+
+		if (!this->gpu_profiler->success) {
+			return;
+		}
+
+		this->depth_format = ChooseDepthFormat();
+
+		this->render_graph = std::make_unique<RenderGraph>(
+			device,
+			*this->frame_sync,
+			this->gpu_profiler.get()
+		);
+
+		if (!this->render_graph->success) {
+			return;
+		}
+
+		device.SetFrameSync(this->frame_sync.get());
+
+		if (record_threads != 0) {
+			this->command_recorder = std::make_unique<CommandRecorder>(
+				device,
+				record_threads
+			);
+
+			if (!this->command_recorder->success) {
+				return;
+			}
+		}
+
 		this->success = true;
 	}
 
 	Renderer::~Renderer() {
-		DestroyCommandBuffers();
-
 		vkDeviceWaitIdle(this->device.GetDevice());
+
+		this->device.SetFrameSync(nullptr);
+
+		this->command_recorder = nullptr;
+		this->render_graph = nullptr;
+		this->gpu_profiler = nullptr;
+		this->frame_descriptor_allocators.clear();
+		this->uniform_ring = nullptr;
+
+		DestroyCommandBuffers();
 	}
 
 
+	bool Renderer::IsHeadless() const {
+		return this->window == nullptr;
+	}
+
 	bool Renderer::HasFrameBegan() const {
 		return this->frame_began;
 	}
 
 	VkExtent2D Renderer::GetExtent() const {
+		if (IsHeadless()) {
+			return this->offscreen->GetExtent();
+		}
+
 		return this->swap_chain->GetExtent();
 	}
 
 	VkRenderPass Renderer::GetRenderPass() const {
-		return this->swap_chain->GetRenderPass();
+		return this->render_graph->GetCompatibleRenderPass(
+			{ GetColorFormat() },
+			this->depth_format
+		);
 	}
 
 	VkCommandBuffer Renderer::GetCurrentCommandBuffer() {
@@ -70,13 +171,79 @@ namespace yib {
 		return this->frame_index;
 	}
 
+	bool Renderer::IsRecordingInParallel() const {
+		return this->command_recorder != nullptr;
+	}
+
+	const FramePacer& Renderer::GetFramePacer() const {
+		return this->frame_pacer;
+	}
+
+	FrameSync& Renderer::GetFrameSync() {
+		return *this->frame_sync;
+	}
+
+	GpuProfiler& Renderer::GetGpuProfiler() {
+		return *this->gpu_profiler;
+	}
+
+	DescriptorAllocator* Renderer::GetFrameDescriptorAllocator() {
+		if (!this->frame_began) {
+			return nullptr;
+		}
+
+		return this->frame_descriptor_allocators.at(this->frame_index).get();
+	}
+
+	UniformRing& Renderer::GetUniformRing() {
+		return *this->uniform_ring;
+	}
+
+	RenderGraph& Renderer::GetRenderGraph() {
+		return *this->render_graph;
+	}
+
+	RenderGraph::Resource Renderer::GetBackBuffer() const {
+		return this->back_buffer;
+	}
+
+	RenderGraph::Resource Renderer::GetDepthBuffer() const {
+		return this->depth_buffer;
+	}
+
 
 	std::optional<VkCommandBuffer> Renderer::BeginFrame() {
+		YIB_PROFILE_FUNCTION();
+
 		if (this->frame_began) {
 			return std::nullopt;
 		}
 
-		VkResult result = this->swap_chain->GetNextImage(&this->image_index);
+		// Nothing is acquired or submitted while minimized, the frame is
+		// skipped like one with an out of date swap chain.
+		if (!IsHeadless() && this->window->IsMinimized()) {
+			return VK_NULL_HANDLE;
+		}
+
+		if (this->swap_chain_outdated) {
+			if (!RecreateSwapChain()) {
+				return std::nullopt;
+			}
+		}
+
+		{
+			YIB_PROFILE_ZONE("Limit");
+			this->frame_pacer.Limit();
+		}
+
+		PollCompletedFrames();
+		this->device.DestroyRetiredImages(false);
+
+		std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+		VkResult result = IsHeadless() ?
+			this->offscreen->GetNextImage(this->frame_index, &this->image_index) :
+			this->swap_chain->GetNextImage(this->frame_index, &this->image_index);
 		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
 			if (!RecreateSwapChain()) {
 				return std::nullopt;
@@ -84,10 +251,21 @@ namespace yib {
 
 			return VK_NULL_HANDLE;
 		}
-		if (result != VK_SUCCESS) {
+		// A suboptimal image still gets presented, EndFrame recreates the
+		// swap chain afterwards.
+		if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
 			return std::nullopt;
 		}
 
+		// The last frame submitted from this slot was just waited on.
+		this->frame_pacer.CompleteFrame(this->frame_index);
+		this->frame_pacer.BeginFrame(this->frame_index, start_time);
+
+		this->frame_descriptor_allocators.at(this->frame_index)->Reset();
+		this->uniform_ring->BeginFrame(this->frame_index);
+
+		ImportFrameResources();
+
 		this->frame_began = true;
 
 		VkCommandBuffer command_buffer = GetCurrentCommandBuffer();
@@ -102,36 +280,78 @@ namespace yib {
 			return std::nullopt;
 		}
 
+		this->gpu_profiler->BeginFrame(
+			command_buffer,
+			this->frame_index
+		);
+		this->gpu_profiler->BeginZone(
+			command_buffer,
+			"frame"
+		);
+
 		return command_buffer;
 	}
 
 	bool Renderer::EndFrame() {
+		YIB_PROFILE_FUNCTION();
+
 		if (!this->frame_began) {
 			return false;
 		}
 
 		VkCommandBuffer command_buffer = GetCurrentCommandBuffer();
 
+		if (!this->render_graph->Execute(command_buffer)) {
+			return false;
+		}
+
+		this->gpu_profiler->EndZone(command_buffer);
+
 		if (vkEndCommandBuffer(
 			command_buffer
 		) != VK_SUCCESS) {
 			return false;
 		}
 
+		if (!this->device.GetUploader().Flush().has_value()) {
+			return false;
+		}
+
+		if (!this->uniform_ring->Flush()) {
+			return false;
+		}
+
+		if (IsHeadless()) {
+			if (this->offscreen->SubmitCommandBuffers(
+				this->frame_index,
+				&command_buffer,
+				&this->image_index
+			) != VK_SUCCESS) {
+				return false;
+			}
+
+			this->frame_began = false;
+			this->frame_index = (this->frame_index + 1) % this->frame_pacer.GetFramesInFlight();
+
+			return true;
+		}
+
 		VkResult result = this->swap_chain->SubmitCommandBuffers(
+			this->frame_index,
 			&command_buffer,
 			&this->image_index
 		);
 		if (
 			result == VK_ERROR_OUT_OF_DATE_KHR ||
 			result == VK_SUBOPTIMAL_KHR ||
-			this->window.GetResized()
+			this->window->GetResized()
 		) {
 			if (!RecreateSwapChain()) {
 				return false;
 			}
-			this->window.ResetResized();
+			this->window->ResetResized();
 			this->frame_began = false;
+			this->frame_index = (this->frame_index + 1) % this->frame_pacer.GetFramesInFlight();
 
 			return true;
 		}
@@ -141,83 +361,47 @@ namespace yib {
 		}
 
 		this->frame_began = false;
-		this->frame_index = (this->frame_index + 1) % SwapChain::MAX_FRAMES_IN_FLIGHT;
+		this->frame_index = (this->frame_index + 1) % this->frame_pacer.GetFramesInFlight();
 
 		return true;
 	}
 
 
-	bool Renderer::BeginRenderPass(VkCommandBuffer command_buffer) {
+	bool Renderer::RecordInParallel(
+		const RenderGraph::PassContext& context,
+		uint32_t count,
+		const CommandRecorder::RecordFunction& record
+	) {
 		if (
 			!this->frame_began ||
-			command_buffer != GetCurrentCommandBuffer()
+			!IsRecordingInParallel() ||
+			context.render_pass == VK_NULL_HANDLE ||
+			context.command_buffer != GetCurrentCommandBuffer()
 		) {
 			return false;
 		}
 
-		VkRenderPassBeginInfo render_pass_begin_info = {};
-
-		render_pass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		render_pass_begin_info.renderPass = this->swap_chain->GetRenderPass();
-		render_pass_begin_info.framebuffer = this->swap_chain->GetFrameBuffer(this->image_index);
-
-		render_pass_begin_info.renderArea.offset = { 0, 0 };
-		render_pass_begin_info.renderArea.extent = this->swap_chain->GetExtent();
-
-		std::array<VkClearValue, 2> clear_values = {};
-
-		clear_values.at(0).color = { 0.1f, 0.1f, 0.1f, 1.0f };
-		clear_values.at(1).depthStencil = { 1.0f, 0 };
-
-		render_pass_begin_info.clearValueCount = clear_values.size();
-		render_pass_begin_info.pClearValues = clear_values.data();
-
-		vkCmdBeginRenderPass(
-			command_buffer,
-			&render_pass_begin_info,
-			VK_SUBPASS_CONTENTS_INLINE
-		);
-
-		VkViewport viewport = {};
-
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
-		viewport.width = this->swap_chain->GetExtent().width;
-		viewport.height = this->swap_chain->GetExtent().height;
-
-		vkCmdSetViewport(
-			command_buffer,
-			0,
-			1,
-			&viewport
+		std::optional<std::vector<VkCommandBuffer>> secondary_command_buffers = this->command_recorder->Record(
+			this->frame_index,
+			context.render_pass,
+			context.framebuffer,
+			context.extent,
+			count,
+			record
 		);
-
-		VkRect2D scissor = {};
-
-		scissor.offset = { 0, 0 };
-		scissor.extent = this->swap_chain->GetExtent();
-
-		vkCmdSetScissor(
-			command_buffer,
-			0,
-			1,
-			&scissor
-		);
-
-		return true;
-	}
-
-	bool Renderer::EndRenderPass(VkCommandBuffer command_buffer) {
-		if (
-			!this->frame_began ||
-			command_buffer != GetCurrentCommandBuffer()
-			) {
+		if (!secondary_command_buffers.has_value()) {
 			return false;
 		}
 
-		vkCmdEndRenderPass(command_buffer);
+		if (secondary_command_buffers.value().empty()) {
+			return true;
+		}
+
+		vkCmdExecuteCommands(
+			context.command_buffer,
+			secondary_command_buffers.value().size(),
+			secondary_command_buffers.value().data()
+		);
 
 		return true;
 	}
@@ -244,6 +428,19 @@ namespace yib {
 		return true;
 	}
 
+	bool Renderer::CreateDescriptorAllocators() {
+		this->frame_descriptor_allocators.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+
+		for (std::unique_ptr<DescriptorAllocator>& allocator : this->frame_descriptor_allocators) {
+			allocator = std::make_unique<DescriptorAllocator>(this->device);
+			if (!allocator->success) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
 	void Renderer::DestroyCommandBuffers() {
 		vkFreeCommandBuffers(
 			this->device.GetDevice(),
@@ -254,26 +451,31 @@ namespace yib {
 	}
 
 	bool Renderer::RecreateSwapChain() {
-		VkExtent2D extent = VkExtent2D(
-			this->window.GetWidth(),
-			this->window.GetHeight()
-		);
+		// A zero sized swap chain can't be created, BeginFrame tries again
+		// once the window is restored.
+		if (this->window->IsMinimized()) {
+			this->swap_chain_outdated = true;
+			return true;
+		}
 
-		while (extent.width == 0 || extent.height == 0) {
-			extent = VkExtent2D(
-				this->window.GetWidth(),
-				this->window.GetHeight()
-			);
+		this->swap_chain_outdated = false;
 
-			glfwWaitEvents();
-		}
+		VkExtent2D extent = VkExtent2D(
+			this->window->GetWidth(),
+			this->window->GetHeight()
+		);
 
-		vkDeviceWaitIdle(this->device.GetDevice());
+		// Frames in flight keep running. The old swap chain is passed as
+		// oldSwapchain and lives until its frames completed, the graph does
+		// the same for the framebuffers built from its image views.
+		this->render_graph->RetireFramebuffers();
 
 		if (this->swap_chain == VK_NULL_HANDLE) {
 			this->swap_chain = std::make_unique<SwapChain>(
 				this->device,
-				extent
+				extent,
+				this->frame_pacer.GetPacing(),
+				*this->frame_sync
 			);
 
 			if (!this->swap_chain->success) {
@@ -285,6 +487,8 @@ namespace yib {
 			this->swap_chain = std::make_unique<SwapChain>(
 				this->device,
 				extent,
+				this->frame_pacer.GetPacing(),
+				*this->frame_sync,
 				old_swap_chain
 			);
 
@@ -299,4 +503,88 @@ namespace yib {
 
 		return true;
 	}
+
+	void Renderer::PollCompletedFrames() {
+		for (uint32_t i = 0; i < this->frame_pacer.GetFramesInFlight(); i++) {
+			if (this->frame_pacer.IsFramePending(i) && this->frame_sync->IsSlotComplete(i)) {
+				this->frame_pacer.CompleteFrame(i);
+			}
+		}
+	}
+
+	void Renderer::ImportFrameResources() {
+		this->render_graph->Reset();
+
+		RenderGraphImageInfo back_buffer_info = {};
+
+		back_buffer_info.format = GetColorFormat();
+		back_buffer_info.extent = GetExtent();
+
+		// The acquire semaphore is waited on at color attachment output, the
+		// first transition has to wait there as well.
+		RenderGraphState initial_state = {};
+
+		initial_state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		initial_state.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+		RenderGraphState final_state = {};
+
+		if (IsHeadless()) {
+			final_state.layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			final_state.stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+			final_state.access = VK_ACCESS_TRANSFER_READ_BIT;
+
+			this->back_buffer = this->render_graph->ImportImage(
+				"back buffer",
+				this->offscreen->GetColorImage(this->image_index),
+				this->offscreen->GetColorImageView(this->image_index),
+				back_buffer_info,
+				initial_state,
+				final_state
+			);
+		} else {
+			final_state.layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+			final_state.stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+			final_state.access = 0;
+
+			this->back_buffer = this->render_graph->ImportImage(
+				"back buffer",
+				this->swap_chain->GetImage(this->image_index),
+				this->swap_chain->GetImageView(this->image_index),
+				back_buffer_info,
+				initial_state,
+				final_state
+			);
+		}
+
+		RenderGraphImageInfo depth_info = {};
+
+		depth_info.format = this->depth_format;
+		depth_info.extent = GetExtent();
+
+		this->depth_buffer = this->render_graph->CreateImage(
+			"depth",
+			depth_info
+		);
+	}
+
+	VkFormat Renderer::GetColorFormat() const {
+		if (IsHeadless()) {
+			return this->offscreen->GetColorFormat();
+		}
+
+		return this->swap_chain->GetImageFormat();
+	}
+
+	VkFormat Renderer::ChooseDepthFormat() const {
+		return this->device.FindSupportedFormat(
+			std::vector<VkFormat>{
+				VK_FORMAT_D32_SFLOAT,
+				VK_FORMAT_D32_SFLOAT_S8_UINT,
+				VK_FORMAT_D24_UNORM_S8_UINT
+			},
+			VK_IMAGE_TILING_OPTIMAL,
+			VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
+		);
+	}
 }
\ No newline at end of file
@@ -9,7 +9,15 @@
 #include "window.h"
 #include "device.h"
 #include "pipeline.h"
+#include "descriptors.h"
+#include "uniform_ring.h"
+#include "offscreen.h"
 #include "swapchain.h"
+#include "frame_sync.h"
+#include "frame_pacer.h"
+#include "gpu_profiler.h"
+#include "render_graph.h"
+#include "command_recorder.h"
 
 namespace yib {
 	class Renderer {
@@ -18,40 +26,89 @@ namespace yib {
 			const std::string name,
 			uint32_t width,
 			uint32_t height,
-			Window& window,
-			Device& device
+			Window* window,
+			Device& device,
+			uint32_t record_threads = 0,
+			const FramePacing& pacing = {}
 		);
 		~Renderer();
 
 		Renderer(const Renderer&) = delete;
 		Renderer& operator=(const Renderer&) = delete;
 
+		bool IsHeadless() const;
 		bool HasFrameBegan() const;
 		VkExtent2D GetExtent() const;
+		// Compatible with graph passes writing the back and depth buffer.
 		VkRenderPass GetRenderPass() const;
 		VkCommandBuffer GetCurrentCommandBuffer();
 		std::optional<uint32_t> GetFrameIndex() const;
+		bool IsRecordingInParallel() const;
+		const FramePacer& GetFramePacer() const;
+		// Frames are numbered by submission, so uploads, deferred deletions
+		// and readbacks can wait for exactly the frame that used them.
+		FrameSync& GetFrameSync();
+		// Every frame is a "frame" zone with a nested zone per graph pass,
+		// further zones can be added while recording the primary buffer.
+		GpuProfiler& GetGpuProfiler();
+		// Sets from it live until the frame slot comes around again, then
+		// the whole allocator is reset at once. Null outside of a frame.
+		DescriptorAllocator* GetFrameDescriptorAllocator();
+		// Slices written during a frame are flushed by EndFrame.
+		UniformRing& GetUniformRing();
+		// Passes are added between BeginFrame and EndFrame, which executes
+		// the graph into the frame's command buffer.
+		RenderGraph& GetRenderGraph();
+		// Only valid while a frame is recorded. The depth buffer is a
+		// transient image that only takes up memory when a pass uses it.
+		RenderGraph::Resource GetBackBuffer() const;
+		RenderGraph::Resource GetDepthBuffer() const;
 
 		std::optional<VkCommandBuffer> BeginFrame();
 		bool EndFrame();
 
-		bool BeginRenderPass(VkCommandBuffer command_buffer);
-		bool EndRenderPass(VkCommandBuffer command_buffer);
+		// Only valid inside a graph pass that uses secondary command buffers
+		// and only when recording in parallel.
+		bool RecordInParallel(
+			const RenderGraph::PassContext& context,
+			uint32_t count,
+			const CommandRecorder::RecordFunction& record
+		);
 
 		bool success;
 	private:
 		bool CreateCommandBuffers();
 		void DestroyCommandBuffers();
+
+		bool CreateDescriptorAllocators();
 	
 		bool RecreateSwapChain();
+		void PollCompletedFrames();
+		void ImportFrameResources();
+		VkFormat GetColorFormat() const;
+		VkFormat ChooseDepthFormat() const;
 
 		uint32_t image_index;
 		uint32_t frame_index;
 		bool frame_began;
+		// Set when the swap chain went out of date while minimized.
+		bool swap_chain_outdated = false;
 
-		Window& window;
+		Window* window;
 		Device& device;
+		std::unique_ptr<FrameSync> frame_sync;
 		std::unique_ptr<SwapChain> swap_chain;
+		std::unique_ptr<OffscreenTarget> offscreen;
 		std::vector<VkCommandBuffer> command_buffers;
+		std::unique_ptr<CommandRecorder> command_recorder;
+		FramePacer frame_pacer;
+		std::unique_ptr<GpuProfiler> gpu_profiler;
+		std::vector<std::unique_ptr<DescriptorAllocator>> frame_descriptor_allocators;
+		std::unique_ptr<UniformRing> uniform_ring;
+		std::unique_ptr<RenderGraph> render_graph;
+
+		VkFormat depth_format = VK_FORMAT_UNDEFINED;
+		RenderGraph::Resource back_buffer = 0;
+		RenderGraph::Resource depth_buffer = 0;
 	};
 }
\ No newline at end of file
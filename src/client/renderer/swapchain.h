@@ -6,17 +6,23 @@
 #include <vulkan/vulkan.h>
 
 #include "device.h"
+#include "frame_sync.h"
+#include "frame_pacer.h"
 
 namespace yib {
 	class SwapChain {
 	public:
 		SwapChain(
 			Device& device,
-			VkExtent2D window_extent
+			VkExtent2D window_extent,
+			const FramePacing& pacing,
+			FrameSync& frame_sync
 		);
 		SwapChain(
 			Device& device,
 			VkExtent2D window_extent,
+			const FramePacing& pacing,
+			FrameSync& frame_sync,
 			std::shared_ptr<SwapChain> prev
 		);
 		~SwapChain();
@@ -26,15 +32,27 @@ namespace yib {
 
 		VkExtent2D GetExtent() const;
 		uint32_t GetImageCount() const;
-		VkRenderPass GetRenderPass() const;
+		VkFormat GetImageFormat() const;
 		VkSwapchainKHR GetSwapChain() const;
-		VkFramebuffer GetFrameBuffer(uint32_t index) const;
+		VkImage GetImage(uint32_t index) const;
+		VkImageView GetImageView(uint32_t index) const;
+		VkPresentModeKHR GetPresentMode() const;
 		bool CompareSwapChainFormats(const SwapChain& swap_chain) const;
 
-		VkResult GetNextImage(uint32_t* image_index);
-		VkResult SubmitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* image_index);
+		// Also destroys the previous swap chain once the frames that used
+		// it completed.
+		VkResult GetNextImage(
+			uint32_t frame_index,
+			uint32_t* image_index
+		);
+		VkResult SubmitCommandBuffers(
+			uint32_t frame_index,
+			const VkCommandBuffer* buffers,
+			uint32_t* image_index
+		);
 
-		static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+		// Upper bound for FramePacing::frames_in_flight.
+		static constexpr int MAX_FRAMES_IN_FLIGHT = 3;
 
 		bool success;
 	private:
@@ -46,43 +64,33 @@ namespace yib {
 		bool CreateImageViews();
 		void DestoryImageViews();
 
-		bool CreateRenderPass();
-		void DestroyRenderPass();
-
-		bool CreateDepthResources();
-		void DestroyDepthResources();
-
-		bool CreateFrameBuffer();
-		void DestoryFrameBuffer();
-
 		bool CreateSyncObjects();
 		void DestroySyncObjects();
 
-		VkFormat ChooseDepthFormat();
 		VkExtent2D ChooseSwapExtent(VkSurfaceCapabilitiesKHR capabilities);
 		VkSurfaceFormatKHR ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& avail_formats);
 		VkPresentModeKHR ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& avail_present_modes);
+		uint32_t ChooseImageCount(VkSurfaceCapabilitiesKHR capabilities);
+
+		FramePacing pacing;
+		VkPresentModeKHR present_mode = VK_PRESENT_MODE_FIFO_KHR;
 
 		VkExtent2D extent = {};
 		VkFormat image_format = {};
 		std::vector<VkImage> images = {};
 		std::vector<VkImageView> image_views = {};
-		std::vector<VkFramebuffer> frame_buffers = {};
-
-		VkFormat depth_format = {};
-		std::vector<VkImage> depth_images = {};
-		std::vector<VkImageView> depth_image_views = {};
-		std::vector<VkDeviceMemory> depth_image_memorys = {};
 
-		size_t current_frame = 0;
-		std::vector<VkFence> in_flight_fences = {};
-		std::vector<VkFence> images_in_flight = {};
+		// The frame that last rendered to each image.
+		std::vector<uint64_t> image_frames = {};
 		std::vector<VkSemaphore> render_finished_semaphores = {};
 		std::vector<VkSemaphore> image_available_semaphores = {};
 
 		Device& device;
+		FrameSync& frame_sync;
+		// Kept alive until prev_frame completed, frames in flight may still
+		// render to or present its images.
 		std::shared_ptr<SwapChain> prev_swapchain;
-		VkRenderPass render_pass = VK_NULL_HANDLE;
+		uint64_t prev_frame = 0;
 		VkSwapchainKHR swap_chain = VK_NULL_HANDLE;
 	};
 };
\ No newline at end of file
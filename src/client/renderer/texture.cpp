@@ -3,6 +3,8 @@
 #include <cmath>
 
 #include "buffer.h"
+#include "bindless_textures.h"
+#include "../../shared/profiler.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "../../shared/stb/stb_image.h"
@@ -12,6 +14,8 @@ namespace yib {
 		Device& device,
 		const std::string& file
 	) : device(device), success(false) {
+		YIB_PROFILE_ZONE("LoadTexture");
+
 		int width, height, channels, bytes_per_pixel;
 		stbi_uc* data = stbi_load(
 			file.c_str(),
@@ -28,20 +32,6 @@ namespace yib {
 		this->height = static_cast<uint32_t>(height);
 		this->mip_levels = std::floor(std::log2(std::max(width, height))) + 1;
 
-		Buffer staging_buffer = Buffer(
-			this->device,
-			4,
-			width * height,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-		);
-		if (!staging_buffer.success) {
-			return;
-		}
-
-		staging_buffer.Map();
-		staging_buffer.Write(data);
-
 		this->format = VK_FORMAT_R8G8B8A8_SRGB;
 
 		VkImageCreateInfo image_info = { };
@@ -61,32 +51,42 @@ namespace yib {
 		if (!this->device.CreateImageWithInfo(
 			image_info,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			this->memory,
+			this->allocation,
 			this->image
 		)) {
 			return;
 		}
 
+		Uploader& uploader = this->device.GetUploader();
+
 		if (!TransitionImageLayout(
+			uploader.GetTransferCommandBuffer(),
 			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
 		)) {
 			return;
 		}
 
-		if (!this->device.CopyBufferToImage(
-			staging_buffer.GetBuffer(),
+		std::optional<UploadToken> token = uploader.UploadImage(
+			data,
+			static_cast<VkDeviceSize>(width) * height * 4,
 			this->image,
 			width,
 			height,
-			1
-		)) {
+			1,
+			this->mip_levels
+		);
+		stbi_image_free(data);
+
+		if (!token.has_value()) {
 			return;
 		}
 
-		if (!GenerateMipmaps()) {
+		if (!GenerateMipmaps(uploader.GetCommandBuffer())) {
 			return;
 		}
 
+		this->upload_token = uploader.GetToken();
+
 		VkSamplerCreateInfo sampler_info = { };
 
 		sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -140,34 +140,29 @@ namespace yib {
 			return;
 		}
 
-		stbi_image_free(data);
+		BindlessTextures* bindless_textures = this->device.GetBindlessTextures();
+		if (bindless_textures != nullptr) {
+			this->bindless_index = bindless_textures->Register(GetDescriptorInfo());
+			if (!this->bindless_index.has_value()) {
+				return;
+			}
+		}
 
 		this->success = true;
 	}
 
 	Texture::~Texture() {
-		vkDestroyImage(
-			this->device.GetDevice(),
-			this->image,
-			nullptr
-		);
+		this->device.GetUploader().Wait(this->upload_token);
 
-		vkFreeMemory(
-			this->device.GetDevice(),
-			this->memory,
-			nullptr
-		);
+		if (this->bindless_index.has_value()) {
+			this->device.GetBindlessTextures()->Unregister(this->bindless_index.value());
+		}
 
-		vkDestroyImageView(
-			this->device.GetDevice(),
+		this->device.RetireImage(
+			this->image,
+			this->allocation,
 			this->view,
-			nullptr
-		);
-
-		vkDestroySampler(
-			this->device.GetDevice(),
-			this->sampler,
-			nullptr
+			this->sampler
 		);
 	}
 
@@ -206,15 +201,19 @@ namespace yib {
 		return image_info;
 	}
 
+	UploadToken Texture::GetUploadToken() const {
+		return this->upload_token;
+	}
+
+	std::optional<uint32_t> Texture::GetBindlessIndex() const {
+		return this->bindless_index;
+	}
+
 
 	bool Texture::TransitionImageLayout(
+		VkCommandBuffer command_buffer,
 		VkImageLayout layout
 	) {
-		VkCommandBuffer command_buffer = this->device.BeginSingleTimeCommands();
-		if (command_buffer == VK_NULL_HANDLE) {
-			return false;
-		}
-
 		VkImageMemoryBarrier barrier = { };
 		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
 		barrier.oldLayout = this->layout;
@@ -266,14 +265,10 @@ namespace yib {
 			&barrier
 		);
 
-		if (!this->device.EndSingleTimeCommands(command_buffer)) {
-			return false;
-		}
-
 		return true;
 	}
 
-	bool Texture::GenerateMipmaps() {
+	bool Texture::GenerateMipmaps(VkCommandBuffer command_buffer) {
 		VkFormatProperties format_properties;
 		vkGetPhysicalDeviceFormatProperties(
 			this->device.GetPhysicalDevice(),
@@ -285,11 +280,6 @@ namespace yib {
 			return false;
 		}
 
-		VkCommandBuffer command_buffer = this->device.BeginSingleTimeCommands();
-		if (command_buffer == VK_NULL_HANDLE) {
-			return false;
-		}
-
 		VkImageMemoryBarrier barrier = { };
 
 		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -395,10 +385,6 @@ namespace yib {
 
 		this->layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-		if (!this->device.EndSingleTimeCommands(command_buffer)) {
-			return false;
-		}
-
 		return true;
 	}
 }
\ No newline at end of file
@@ -2,10 +2,12 @@
 
 #include <string>
 #include <cstdint>
+#include <optional>
 
 #include <vulkan/vulkan.h>
 
 #include "device.h"
+#include "uploader.h"
 
 namespace yib {
 	class Texture {
@@ -26,13 +28,17 @@ namespace yib {
 		uint32_t GetMipLevels() const;
 		VkImageLayout GetImageLayout() const;
 		VkDescriptorImageInfo GetDescriptorInfo() const;
+		UploadToken GetUploadToken() const;
+		// Slot in the device's bindless texture array, if it has one.
+		std::optional<uint32_t> GetBindlessIndex() const;
 
 		bool success;
 	private:
 		bool TransitionImageLayout(
+			VkCommandBuffer command_buffer,
 			VkImageLayout layout
 		);
-		bool GenerateMipmaps();
+		bool GenerateMipmaps(VkCommandBuffer command_buffer);
 
 		Device& device;
 
@@ -41,10 +47,13 @@ namespace yib {
 		uint32_t mip_levels = 0;
 
 		VkImage image = VK_NULL_HANDLE;
-		VkDeviceMemory memory = VK_NULL_HANDLE;
+		Allocation allocation = {};
 		VkImageView view = VK_NULL_HANDLE;
 		VkSampler sampler = VK_NULL_HANDLE;
 		VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
 		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		UploadToken upload_token = 0;
+		std::optional<uint32_t> bindless_index = std::nullopt;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "uniform_ring.h"
+
+#include <cstring>
+
+#include "swapchain.h"
+
+namespace yib {
+	UniformRing::UniformRing(
+		Device& device,
+		VkDeviceSize frame_size
+	) :
+		device(device),
+		success(false)
+	{
+		this->alignment = device.GetPhysicalDeviceProperties().limits.minUniformBufferOffsetAlignment;
+
+		// Segments start aligned, so slice offsets only depend on the head.
+		this->frame_size = Buffer::GetAlignment(
+			frame_size,
+			this->alignment
+		);
+
+		this->buffer = std::make_unique<Buffer>(
+			device,
+			this->frame_size,
+			SwapChain::MAX_FRAMES_IN_FLIGHT,
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+		);
+		if (!this->buffer->success) {
+			return;
+		}
+
+		if (!this->buffer->Map()) {
+			return;
+		}
+
+		this->success = true;
+	}
+
+
+	void UniformRing::BeginFrame(uint32_t frame_index) {
+		this->frame_offset = this->frame_size * frame_index;
+		this->head = 0;
+	}
+
+	bool UniformRing::Flush() {
+		if (this->head == 0) {
+			return true;
+		}
+
+		return this->buffer->Flush(
+			this->head,
+			this->frame_offset
+		);
+	}
+
+	std::optional<UniformSlice> UniformRing::Allocate(VkDeviceSize size) {
+		VkDeviceSize offset = Buffer::GetAlignment(
+			this->head,
+			this->alignment
+		);
+		if (offset + size > this->frame_size) {
+			return std::nullopt;
+		}
+
+		this->head = offset + size;
+
+		UniformSlice slice = {};
+		slice.offset = this->frame_offset + offset;
+		slice.size = size;
+		slice.data = static_cast<char*>(this->buffer->GetMappedMemory()) + slice.offset;
+
+		return slice;
+	}
+
+	std::optional<UniformSlice> UniformRing::Write(
+		const void* data,
+		VkDeviceSize size
+	) {
+		std::optional<UniformSlice> slice = Allocate(size);
+		if (!slice.has_value()) {
+			return std::nullopt;
+		}
+
+		memcpy(
+			slice.value().data,
+			data,
+			size
+		);
+
+		return slice;
+	}
+
+	VkBuffer UniformRing::GetBuffer() const {
+		return this->buffer->GetBuffer();
+	}
+
+	VkDescriptorBufferInfo UniformRing::GetDescriptorInfo(VkDeviceSize range) const {
+		VkDescriptorBufferInfo buffer_info = {};
+
+		buffer_info.buffer = this->buffer->GetBuffer();
+		buffer_info.offset = 0;
+		buffer_info.range = range;
+
+		return buffer_info;
+	}
+
+	VkDeviceSize UniformRing::GetUsedSize() const {
+		return this->head;
+	}
+}
\ No newline at end of file
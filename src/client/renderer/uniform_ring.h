@@ -0,0 +1,62 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <optional>
+
+#include <vulkan/vulkan.h>
+
+#include "device.h"
+#include "buffer.h"
+
+namespace yib {
+	struct UniformSlice {
+		// Passed as the dynamic offset of the slice's descriptor.
+		uint32_t offset = 0;
+		VkDeviceSize size = 0;
+		void* data = nullptr;
+	};
+
+	// A persistently mapped uniform buffer split into one segment per frame
+	// slot. Every frame bump allocates aligned slices from its segment, which
+	// are bound through UNIFORM_BUFFER_DYNAMIC descriptors, so one descriptor
+	// set serves every slice of every frame.
+	class UniformRing {
+	public:
+		UniformRing(
+			Device& device,
+			VkDeviceSize frame_size = 1024 * 1024
+		);
+
+		UniformRing(const UniformRing&) = delete;
+		UniformRing& operator=(const UniformRing&) = delete;
+
+		// Has to be called once the frame slot's previous submit completed.
+		void BeginFrame(uint32_t frame_index);
+		// Makes this frame's writes visible before it is submitted.
+		bool Flush();
+
+		std::optional<UniformSlice> Allocate(VkDeviceSize size);
+		std::optional<UniformSlice> Write(
+			const void* data,
+			VkDeviceSize size
+		);
+
+		VkBuffer GetBuffer() const;
+		// The range has to match the size of the slices bound through it.
+		VkDescriptorBufferInfo GetDescriptorInfo(VkDeviceSize range) const;
+		VkDeviceSize GetUsedSize() const;
+
+		bool success;
+	private:
+		Device& device;
+		std::unique_ptr<Buffer> buffer;
+
+		VkDeviceSize frame_size;
+		VkDeviceSize alignment;
+
+		VkDeviceSize frame_offset = 0;
+		VkDeviceSize head = 0;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,695 @@
+#include "uploader.h"
+
+#include <cstring>
+
+namespace yib {
+	Uploader::Uploader(
+		Device& device,
+		VkDeviceSize capacity
+	) : device(device), capacity(capacity), success(false) {
+		if (!CreateCommandPool()) {
+			return;
+		}
+
+		if (!CreateRing()) {
+			return;
+		}
+
+		if (!BeginBatch()) {
+			return;
+		}
+
+		this->success = true;
+	}
+
+	Uploader::~Uploader() {
+		WaitIdle();
+
+		std::vector<Batch*> batches = {};
+		if (this->open_batch) {
+			batches.push_back(this->open_batch.get());
+		}
+		for (std::unique_ptr<Batch>& batch : this->in_flight) {
+			batches.push_back(batch.get());
+		}
+		for (std::unique_ptr<Batch>& batch : this->free_batches) {
+			batches.push_back(batch.get());
+		}
+
+		for (Batch* batch : batches) {
+			vkDestroyFence(
+				this->device.GetDevice(),
+				batch->fence,
+				nullptr
+			);
+
+			if (batch->semaphore != VK_NULL_HANDLE) {
+				vkDestroySemaphore(
+					this->device.GetDevice(),
+					batch->semaphore,
+					nullptr
+				);
+			}
+		}
+
+		this->open_batch.reset();
+		this->in_flight.clear();
+		this->free_batches.clear();
+		this->ring.reset();
+
+		DestroyCommandPool();
+	}
+
+
+	std::optional<UploadToken> Uploader::UploadBuffer(
+		const void* data,
+		VkDeviceSize size,
+		VkBuffer destination,
+		VkDeviceSize destination_offset
+	) {
+		VkDeviceSize offset = 0;
+		std::optional<VkBuffer> source = Stage(
+			data,
+			size,
+			offset
+		);
+		if (!source.has_value()) {
+			return std::nullopt;
+		}
+
+		VkBufferCopy copy_region = {};
+
+		copy_region.size = size;
+		copy_region.srcOffset = offset;
+		copy_region.dstOffset = destination_offset;
+
+		vkCmdCopyBuffer(
+			GetTransferCommandBuffer(),
+			source.value(),
+			destination,
+			1,
+			&copy_region
+		);
+
+		if (UsesTransferQueue()) {
+			VkBufferMemoryBarrier barrier = {};
+
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.buffer = destination;
+			barrier.offset = destination_offset;
+			barrier.size = size;
+
+			TransferOwnership(&barrier, nullptr);
+		}
+
+		return GetToken();
+	}
+
+	std::optional<UploadToken> Uploader::UploadImage(
+		const void* data,
+		VkDeviceSize size,
+		VkImage destination,
+		uint32_t width,
+		uint32_t height,
+		uint32_t layer_count,
+		uint32_t mip_levels
+	) {
+		VkDeviceSize offset = 0;
+		std::optional<VkBuffer> source = Stage(
+			data,
+			size,
+			offset
+		);
+		if (!source.has_value()) {
+			return std::nullopt;
+		}
+
+		VkBufferImageCopy region = {};
+
+		region.bufferOffset = offset;
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = 0;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = layer_count;
+
+		region.imageOffset = { 0, 0, 0 };
+		region.imageExtent = { width, height, 1 };
+
+		vkCmdCopyBufferToImage(
+			GetTransferCommandBuffer(),
+			source.value(),
+			destination,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1,
+			&region
+		);
+
+		if (UsesTransferQueue()) {
+			VkImageMemoryBarrier barrier = {};
+
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.image = destination;
+			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			barrier.subresourceRange.baseMipLevel = 0;
+			barrier.subresourceRange.levelCount = mip_levels;
+			barrier.subresourceRange.baseArrayLayer = 0;
+			barrier.subresourceRange.layerCount = layer_count;
+
+			TransferOwnership(nullptr, &barrier);
+		}
+
+		return GetToken();
+	}
+
+
+	VkCommandBuffer Uploader::GetTransferCommandBuffer() {
+		this->open_batch_used = true;
+
+		if (UsesTransferQueue()) {
+			return this->open_batch->transfer_command_buffer;
+		}
+
+		return this->open_batch->command_buffer;
+	}
+
+	VkCommandBuffer Uploader::GetCommandBuffer() {
+		this->open_batch_used = true;
+
+		return this->open_batch->command_buffer;
+	}
+
+	UploadToken Uploader::GetToken() const {
+		return this->open_batch->token;
+	}
+
+
+	std::optional<UploadToken> Uploader::Flush() {
+		if (!this->open_batch_used) {
+			return this->submitted_token;
+		}
+
+		VkCommandBuffer command_buffer = this->open_batch->command_buffer;
+
+		VkMemoryBarrier barrier = {};
+
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+
+		vkCmdPipelineBarrier(
+			command_buffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			0,
+			1,
+			&barrier,
+			0,
+			nullptr,
+			0,
+			nullptr
+		);
+
+		if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
+			return std::nullopt;
+		}
+
+		if (!this->ring->Flush()) {
+			return std::nullopt;
+		}
+
+		VkSubmitInfo submit_info = {};
+
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.commandBufferCount = 1;
+		submit_info.pCommandBuffers = &command_buffer;
+
+		VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+		if (UsesTransferQueue()) {
+			VkCommandBuffer transfer_command_buffer = this->open_batch->transfer_command_buffer;
+			if (vkEndCommandBuffer(transfer_command_buffer) != VK_SUCCESS) {
+				return std::nullopt;
+			}
+
+			VkSubmitInfo transfer_submit_info = {};
+
+			transfer_submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			transfer_submit_info.commandBufferCount = 1;
+			transfer_submit_info.pCommandBuffers = &transfer_command_buffer;
+			transfer_submit_info.signalSemaphoreCount = 1;
+			transfer_submit_info.pSignalSemaphores = &this->open_batch->semaphore;
+
+			if (vkQueueSubmit(
+				this->device.GetTransferQueue(),
+				1,
+				&transfer_submit_info,
+				VK_NULL_HANDLE
+			) != VK_SUCCESS) {
+				return std::nullopt;
+			}
+
+			submit_info.waitSemaphoreCount = 1;
+			submit_info.pWaitSemaphores = &this->open_batch->semaphore;
+			submit_info.pWaitDstStageMask = &wait_stage;
+		}
+
+		if (vkQueueSubmit(
+			this->device.GetGraphicsQueue(),
+			1,
+			&submit_info,
+			this->open_batch->fence
+		) != VK_SUCCESS) {
+			return std::nullopt;
+		}
+
+		this->open_batch->ring_end = this->head;
+		this->submitted_token = this->open_batch->token;
+		this->in_flight.push_back(std::move(this->open_batch));
+
+		if (!BeginBatch()) {
+			return std::nullopt;
+		}
+
+		return this->submitted_token;
+	}
+
+	bool Uploader::IsComplete(UploadToken token) {
+		Retire();
+
+		return token <= this->completed_token;
+	}
+
+	bool Uploader::Wait(UploadToken token) {
+		if (token >= GetToken()) {
+			if (!Flush().has_value()) {
+				return false;
+			}
+
+			token = std::min(token, this->submitted_token);
+		}
+
+		while (
+			!this->in_flight.empty() &&
+			this->in_flight.front()->token <= token
+		) {
+			if (vkWaitForFences(
+				this->device.GetDevice(),
+				1,
+				&this->in_flight.front()->fence,
+				VK_TRUE,
+				UINT64_MAX
+			) != VK_SUCCESS) {
+				return false;
+			}
+
+			Retire();
+		}
+
+		return token <= this->completed_token;
+	}
+
+	bool Uploader::WaitIdle() {
+		return Wait(GetToken());
+	}
+
+
+	bool Uploader::CreateCommandPool() {
+		QueueFamiliyIndices indices = this->device.GetFamilyIndices(this->device.GetPhysicalDevice());
+
+		this->graphics_family = indices.graphics_index;
+		this->transfer_family = indices.transfer_index;
+
+		VkCommandPoolCreateInfo pool_info = {};
+
+		pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		pool_info.queueFamilyIndex = indices.graphics_index;
+		pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+		if (vkCreateCommandPool(
+			this->device.GetDevice(),
+			&pool_info,
+			nullptr,
+			&this->command_pool
+		) != VK_SUCCESS) {
+			return false;
+		}
+
+		return true;
+	}
+
+	void Uploader::DestroyCommandPool() {
+		if (this->command_pool == VK_NULL_HANDLE) {
+			return;
+		}
+
+		vkDestroyCommandPool(
+			this->device.GetDevice(),
+			this->command_pool,
+			nullptr
+		);
+	}
+
+
+	bool Uploader::CreateRing() {
+		this->ring = std::make_unique<Buffer>(
+			this->device,
+			1,
+			this->capacity,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		);
+		if (!this->ring->success) {
+			return false;
+		}
+
+		if (!this->ring->Map()) {
+			return false;
+		}
+
+		return true;
+	}
+
+
+	bool Uploader::UsesTransferQueue() const {
+		return this->device.HasTransferQueue();
+	}
+
+	void Uploader::TransferOwnership(
+		const VkBufferMemoryBarrier* buffer_barrier,
+		const VkImageMemoryBarrier* image_barrier
+	) {
+		// The release half runs on the transfer queue and the acquire half
+		// on graphics, the batch semaphore orders the two.
+		VkBufferMemoryBarrier buffer_release = {};
+		VkImageMemoryBarrier image_release = {};
+
+		if (buffer_barrier != nullptr) {
+			buffer_release = *buffer_barrier;
+			buffer_release.srcQueueFamilyIndex = this->transfer_family;
+			buffer_release.dstQueueFamilyIndex = this->graphics_family;
+			buffer_release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			buffer_release.dstAccessMask = 0;
+		}
+
+		if (image_barrier != nullptr) {
+			image_release = *image_barrier;
+			image_release.srcQueueFamilyIndex = this->transfer_family;
+			image_release.dstQueueFamilyIndex = this->graphics_family;
+			image_release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			image_release.dstAccessMask = 0;
+		}
+
+		vkCmdPipelineBarrier(
+			this->open_batch->transfer_command_buffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0,
+			0,
+			nullptr,
+			buffer_barrier != nullptr ? 1 : 0,
+			&buffer_release,
+			image_barrier != nullptr ? 1 : 0,
+			&image_release
+		);
+
+		VkBufferMemoryBarrier buffer_acquire = buffer_release;
+		buffer_acquire.srcAccessMask = 0;
+		buffer_acquire.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+		VkImageMemoryBarrier image_acquire = image_release;
+		image_acquire.srcAccessMask = 0;
+		image_acquire.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+		vkCmdPipelineBarrier(
+			this->open_batch->command_buffer,
+			VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			0,
+			0,
+			nullptr,
+			buffer_barrier != nullptr ? 1 : 0,
+			&buffer_acquire,
+			image_barrier != nullptr ? 1 : 0,
+			&image_acquire
+		);
+	}
+
+
+	bool Uploader::BeginBatch() {
+		std::unique_ptr<Batch> batch = nullptr;
+
+		if (!this->free_batches.empty()) {
+			batch = std::move(this->free_batches.back());
+			this->free_batches.pop_back();
+
+			if (vkResetFences(
+				this->device.GetDevice(),
+				1,
+				&batch->fence
+			) != VK_SUCCESS) {
+				return false;
+			}
+
+			if (vkResetCommandBuffer(
+				batch->command_buffer,
+				0
+			) != VK_SUCCESS) {
+				return false;
+			}
+
+			if (
+				batch->transfer_command_buffer != VK_NULL_HANDLE &&
+				vkResetCommandBuffer(
+					batch->transfer_command_buffer,
+					0
+				) != VK_SUCCESS
+			) {
+				return false;
+			}
+		} else {
+			batch = std::make_unique<Batch>();
+
+			VkCommandBufferAllocateInfo allocation_info = {};
+
+			allocation_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocation_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocation_info.commandPool = this->command_pool;
+			allocation_info.commandBufferCount = 1;
+
+			if (vkAllocateCommandBuffers(
+				this->device.GetDevice(),
+				&allocation_info,
+				&batch->command_buffer
+			) != VK_SUCCESS) {
+				return false;
+			}
+
+			if (UsesTransferQueue()) {
+				allocation_info.commandPool = this->device.GetTransferCommandPool();
+
+				if (vkAllocateCommandBuffers(
+					this->device.GetDevice(),
+					&allocation_info,
+					&batch->transfer_command_buffer
+				) != VK_SUCCESS) {
+					return false;
+				}
+
+				VkSemaphoreCreateInfo semaphore_info = {};
+				semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+				if (vkCreateSemaphore(
+					this->device.GetDevice(),
+					&semaphore_info,
+					nullptr,
+					&batch->semaphore
+				) != VK_SUCCESS) {
+					return false;
+				}
+			}
+
+			VkFenceCreateInfo fence_info = {};
+			fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+			if (vkCreateFence(
+				this->device.GetDevice(),
+				&fence_info,
+				nullptr,
+				&batch->fence
+			) != VK_SUCCESS) {
+				return false;
+			}
+		}
+
+		VkCommandBufferBeginInfo begin_info = {};
+		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		if (vkBeginCommandBuffer(
+			batch->command_buffer,
+			&begin_info
+		) != VK_SUCCESS) {
+			return false;
+		}
+
+		if (
+			batch->transfer_command_buffer != VK_NULL_HANDLE &&
+			vkBeginCommandBuffer(
+				batch->transfer_command_buffer,
+				&begin_info
+			) != VK_SUCCESS
+		) {
+			return false;
+		}
+
+		batch->token = this->submitted_token + 1;
+		batch->ring_end = 0;
+
+		this->open_batch = std::move(batch);
+		this->open_batch_used = false;
+
+		return true;
+	}
+
+	void Uploader::Retire() {
+		while (!this->in_flight.empty()) {
+			std::unique_ptr<Batch>& batch = this->in_flight.front();
+
+			if (vkGetFenceStatus(
+				this->device.GetDevice(),
+				batch->fence
+			) != VK_SUCCESS) {
+				break;
+			}
+
+			this->tail = batch->ring_end;
+			this->completed_token = batch->token;
+			batch->temporary_buffers.clear();
+
+			this->free_batches.push_back(std::move(batch));
+			this->in_flight.pop_front();
+		}
+
+		if (this->in_flight.empty() && !this->open_batch_used) {
+			this->head = 0;
+			this->tail = 0;
+		}
+	}
+
+
+	std::optional<VkDeviceSize> Uploader::AllocateRing(VkDeviceSize size) {
+		size = (size + RING_ALIGNMENT - 1) & ~(RING_ALIGNMENT - 1);
+		if (size >= this->capacity) {
+			return std::nullopt;
+		}
+
+		while (true) {
+			Retire();
+
+			VkDeviceSize offset = 0;
+			if (FitsRing(size, offset)) {
+				this->head = offset + size;
+				return offset;
+			}
+
+			if (this->in_flight.empty()) {
+				if (!this->open_batch_used) {
+					return std::nullopt;
+				}
+
+				if (!Flush().has_value()) {
+					return std::nullopt;
+				}
+
+				continue;
+			}
+
+			if (vkWaitForFences(
+				this->device.GetDevice(),
+				1,
+				&this->in_flight.front()->fence,
+				VK_TRUE,
+				UINT64_MAX
+			) != VK_SUCCESS) {
+				return std::nullopt;
+			}
+		}
+	}
+
+	bool Uploader::FitsRing(VkDeviceSize size, VkDeviceSize& offset) const {
+		// head == tail always means empty, so head is never allowed to catch
+		// up with tail from behind.
+		if (this->head >= this->tail) {
+			if (this->capacity - this->head >= size) {
+				offset = this->head;
+				return true;
+			}
+
+			if (this->tail > size) {
+				offset = 0;
+				return true;
+			}
+
+			return false;
+		}
+
+		if (this->tail - this->head > size) {
+			offset = this->head;
+			return true;
+		}
+
+		return false;
+	}
+
+	std::optional<VkBuffer> Uploader::Stage(
+		const void* data,
+		VkDeviceSize size,
+		VkDeviceSize& offset
+	) {
+		if (size > this->capacity / 2) {
+			std::unique_ptr<Buffer> staging_buffer = std::make_unique<Buffer>(
+				this->device,
+				size,
+				1,
+				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+			);
+			if (!staging_buffer->success) {
+				return std::nullopt;
+			}
+
+			if (!staging_buffer->Map()) {
+				return std::nullopt;
+			}
+
+			staging_buffer->Write((void*)data);
+
+			offset = 0;
+
+			VkBuffer buffer = staging_buffer->GetBuffer();
+			this->open_batch->temporary_buffers.push_back(std::move(staging_buffer));
+
+			return buffer;
+		}
+
+		std::optional<VkDeviceSize> ring_offset = AllocateRing(size);
+		if (!ring_offset.has_value()) {
+			return std::nullopt;
+		}
+
+		offset = ring_offset.value();
+
+		memcpy(
+			static_cast<char*>(this->ring->GetMappedMemory()) + offset,
+			data,
+			size
+		);
+
+		return this->ring->GetBuffer();
+	}
+}
\ No newline at end of file
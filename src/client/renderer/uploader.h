@@ -0,0 +1,116 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <optional>
+
+#include <vulkan/vulkan.h>
+
+#include "device.h"
+#include "buffer.h"
+
+namespace yib {
+	typedef uint64_t UploadToken;
+
+	class Uploader {
+	public:
+		Uploader(
+			Device& device,
+			VkDeviceSize capacity = 32 * 1024 * 1024
+		);
+		~Uploader();
+
+		Uploader(const Uploader&) = delete;
+		Uploader& operator=(const Uploader&) = delete;
+
+		// Copies the data into the staging ring and records a transfer into
+		// the open batch. Nothing reaches the gpu until the batch is flushed.
+		std::optional<UploadToken> UploadBuffer(
+			const void* data,
+			VkDeviceSize size,
+			VkBuffer destination,
+			VkDeviceSize destination_offset = 0
+		);
+		// The image has to be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL when
+		// the copy executes and is still in that layout afterwards, owned by
+		// the graphics queue.
+		std::optional<UploadToken> UploadImage(
+			const void* data,
+			VkDeviceSize size,
+			VkImage destination,
+			uint32_t width,
+			uint32_t height,
+			uint32_t layer_count,
+			uint32_t mip_levels = 1
+		);
+
+		// Commands recorded here run on the transfer queue when there is one,
+		// before the ownership of uploaded resources moves to graphics.
+		VkCommandBuffer GetTransferCommandBuffer();
+		// Commands recorded here run on the graphics queue after every
+		// transfer of the batch has been acquired.
+		VkCommandBuffer GetCommandBuffer();
+		UploadToken GetToken() const;
+
+		std::optional<UploadToken> Flush();
+		bool IsComplete(UploadToken token);
+		bool Wait(UploadToken token);
+		bool WaitIdle();
+
+		bool success;
+	private:
+		struct Batch {
+			UploadToken token = 0;
+			VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+			VkCommandBuffer transfer_command_buffer = VK_NULL_HANDLE;
+			VkSemaphore semaphore = VK_NULL_HANDLE;
+			VkFence fence = VK_NULL_HANDLE;
+			VkDeviceSize ring_end = 0;
+			std::vector<std::unique_ptr<Buffer>> temporary_buffers = {};
+		};
+
+		bool CreateCommandPool();
+		void DestroyCommandPool();
+
+		bool CreateRing();
+
+		bool UsesTransferQueue() const;
+		void TransferOwnership(
+			const VkBufferMemoryBarrier* buffer_barrier,
+			const VkImageMemoryBarrier* image_barrier
+		);
+
+		bool BeginBatch();
+		void Retire();
+
+		std::optional<VkDeviceSize> AllocateRing(VkDeviceSize size);
+		bool FitsRing(VkDeviceSize size, VkDeviceSize& offset) const;
+		std::optional<VkBuffer> Stage(
+			const void* data,
+			VkDeviceSize size,
+			VkDeviceSize& offset
+		);
+
+		static constexpr VkDeviceSize RING_ALIGNMENT = 16;
+
+		Device& device;
+
+		VkCommandPool command_pool = VK_NULL_HANDLE;
+		uint32_t graphics_family = 0;
+		uint32_t transfer_family = 0;
+
+		VkDeviceSize capacity;
+		VkDeviceSize head = 0;
+		VkDeviceSize tail = 0;
+		std::unique_ptr<Buffer> ring;
+
+		UploadToken submitted_token = 0;
+		UploadToken completed_token = 0;
+		std::unique_ptr<Batch> open_batch;
+		bool open_batch_used = false;
+		std::deque<std::unique_ptr<Batch>> in_flight = {};
+		std::vector<std::unique_ptr<Batch>> free_batches = {};
+	};
+}
\ No newline at end of file
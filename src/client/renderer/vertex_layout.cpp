@@ -0,0 +1,194 @@
+#include "vertex_layout.h"
+
+#include <cmath>
+#include <cstring>
+
+#include <glm/gtc/packing.hpp>
+
+namespace yib {
+	VertexLayout VertexLayout::Compact() {
+		VertexLayout layout = {};
+
+		layout.position_format = VertexPositionFormat::UNORM16;
+		layout.octahedral_normals = true;
+		layout.half_uvs = true;
+		layout.separate_positions = true;
+
+		return layout;
+	}
+
+
+	uint32_t VertexLayout::GetPositionSize() const {
+		// Three component 16 bit formats are rarely supported for vertex
+		// input, so the quantized ones carry an unused fourth component.
+		switch (this->position_format) {
+		case VertexPositionFormat::HALF:
+		case VertexPositionFormat::UNORM16:
+			return sizeof(uint16_t) * 4;
+		default:
+			return sizeof(float) * 3;
+		}
+	}
+
+	uint32_t VertexLayout::GetNormalSize() const {
+		return this->octahedral_normals ? sizeof(uint16_t) * 2 : sizeof(float) * 3;
+	}
+
+	uint32_t VertexLayout::GetUvSize() const {
+		return this->half_uvs ? sizeof(uint16_t) * 2 : sizeof(float) * 2;
+	}
+
+	uint32_t VertexLayout::GetPositionStride() const {
+		if (this->separate_positions) {
+			return GetPositionSize();
+		}
+
+		return GetPositionSize() + GetNormalSize() + GetUvSize();
+	}
+
+	uint32_t VertexLayout::GetAttributeStride() const {
+		if (!this->separate_positions) {
+			return 0;
+		}
+
+		return GetNormalSize() + GetUvSize();
+	}
+
+
+	std::vector<VkVertexInputBindingDescription> VertexLayout::GetBindingDescriptions() const {
+		std::vector<VkVertexInputBindingDescription> binding_descriptions(1);
+
+		binding_descriptions.at(0).binding = POSITION_BINDING;
+		binding_descriptions.at(0).stride = GetPositionStride();
+		binding_descriptions.at(0).inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		if (this->separate_positions) {
+			VkVertexInputBindingDescription attribute_binding = {};
+
+			attribute_binding.binding = ATTRIBUTE_BINDING;
+			attribute_binding.stride = GetAttributeStride();
+			attribute_binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+			binding_descriptions.push_back(attribute_binding);
+		}
+
+		return binding_descriptions;
+	}
+
+	std::vector<VkVertexInputAttributeDescription> VertexLayout::GetAttributeDescriptions() const {
+		std::vector<VkVertexInputAttributeDescription> attribute_descriptions(3);
+
+		uint32_t attribute_binding = this->separate_positions ? ATTRIBUTE_BINDING : POSITION_BINDING;
+		uint32_t attribute_offset = this->separate_positions ? 0 : GetPositionSize();
+
+		attribute_descriptions.at(0).binding = POSITION_BINDING;
+		attribute_descriptions.at(0).location = 0;
+		attribute_descriptions.at(0).format = GetPositionFormat();
+		attribute_descriptions.at(0).offset = 0;
+
+		attribute_descriptions.at(1).binding = attribute_binding;
+		attribute_descriptions.at(1).location = 1;
+		attribute_descriptions.at(1).format = this->octahedral_normals ? VK_FORMAT_R16G16_SNORM : VK_FORMAT_R32G32B32_SFLOAT;
+		attribute_descriptions.at(1).offset = attribute_offset;
+
+		attribute_descriptions.at(2).binding = attribute_binding;
+		attribute_descriptions.at(2).location = 2;
+		attribute_descriptions.at(2).format = this->half_uvs ? VK_FORMAT_R16G16_SFLOAT : VK_FORMAT_R32G32_SFLOAT;
+		attribute_descriptions.at(2).offset = attribute_offset + GetNormalSize();
+
+		return attribute_descriptions;
+	}
+
+	std::vector<VkVertexInputBindingDescription> VertexLayout::GetPositionBindingDescriptions() const {
+		std::vector<VkVertexInputBindingDescription> binding_descriptions = GetBindingDescriptions();
+		binding_descriptions.resize(1);
+
+		return binding_descriptions;
+	}
+
+	std::vector<VkVertexInputAttributeDescription> VertexLayout::GetPositionAttributeDescriptions() const {
+		std::vector<VkVertexInputAttributeDescription> attribute_descriptions = GetAttributeDescriptions();
+		attribute_descriptions.resize(1);
+
+		return attribute_descriptions;
+	}
+
+
+	void VertexLayout::Pack(
+		const glm::vec3& position,
+		const glm::vec3& normal,
+		const glm::vec2& uv,
+		const VertexDecode& decode,
+		uint8_t* position_data,
+		uint8_t* attribute_data
+	) const {
+		glm::vec3 quantized = (position - decode.position_offset) / decode.position_scale;
+
+		if (this->position_format == VertexPositionFormat::UNORM16) {
+			uint64_t packed = glm::packUnorm4x16(glm::vec4(quantized, 0.0f));
+			memcpy(position_data, &packed, sizeof(packed));
+		} else if (this->position_format == VertexPositionFormat::HALF) {
+			uint64_t packed = glm::packHalf4x16(glm::vec4(quantized, 0.0f));
+			memcpy(position_data, &packed, sizeof(packed));
+		} else {
+			memcpy(position_data, &quantized, sizeof(quantized));
+		}
+
+		if (this->octahedral_normals) {
+			uint32_t packed = EncodeOctahedral(normal);
+			memcpy(attribute_data, &packed, sizeof(packed));
+		} else {
+			memcpy(attribute_data, &normal, sizeof(normal));
+		}
+
+		attribute_data += GetNormalSize();
+
+		if (this->half_uvs) {
+			uint32_t packed = glm::packHalf2x16(uv);
+			memcpy(attribute_data, &packed, sizeof(packed));
+		} else {
+			memcpy(attribute_data, &uv, sizeof(uv));
+		}
+	}
+
+	bool VertexLayout::operator==(const VertexLayout& other) const {
+		return this->position_format == other.position_format &&
+			this->octahedral_normals == other.octahedral_normals &&
+			this->half_uvs == other.half_uvs &&
+			this->separate_positions == other.separate_positions;
+	}
+
+
+	VkFormat VertexLayout::GetPositionFormat() const {
+		switch (this->position_format) {
+		case VertexPositionFormat::HALF:
+			return VK_FORMAT_R16G16B16A16_SFLOAT;
+		case VertexPositionFormat::UNORM16:
+			return VK_FORMAT_R16G16B16A16_UNORM;
+		default:
+			return VK_FORMAT_R32G32B32_SFLOAT;
+		}
+	}
+
+	// Projects the normal onto an octahedron and unfolds the lower half
+	// over the upper one, decoded in simple.vert.
+	uint32_t VertexLayout::EncodeOctahedral(const glm::vec3& normal) {
+		float length = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+		if (length == 0.0f) {
+			return glm::packSnorm2x16(glm::vec2(0.0f, 0.0f));
+		}
+
+		float x = normal.x / length;
+		float y = normal.y / length;
+
+		if (normal.z < 0.0f) {
+			float folded_x = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			float folded_y = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+
+			x = folded_x;
+			y = folded_y;
+		}
+
+		return glm::packSnorm2x16(glm::vec2(x, y));
+	}
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+namespace yib {
+	enum class VertexPositionFormat {
+		FLOAT,
+		// Both quantized formats store positions relative to the mesh
+		// bounds and are expanded through VertexDecode.
+		HALF,
+		UNORM16
+	};
+
+	// Pushed per draw so every mesh can use its own bounds.
+	struct VertexDecode {
+		glm::vec3 position_scale{ 1.0f };
+		uint32_t octahedral_normals = 0;
+		glm::vec3 position_offset{ 0.0f };
+		uint32_t padding = 0;
+	};
+
+	// Describes how Model packs its vertices and how pipelines read them.
+	// A pipeline can only draw models built with the same layout.
+	struct VertexLayout {
+		VertexPositionFormat position_format = VertexPositionFormat::FLOAT;
+		bool octahedral_normals = false;
+		bool half_uvs = false;
+		// Positions go into their own stream so depth only passes fetch
+		// nothing else.
+		bool separate_positions = false;
+
+		// Binding 1 is taken by the instance data.
+		static const uint32_t POSITION_BINDING = 0;
+		static const uint32_t ATTRIBUTE_BINDING = 2;
+
+		// 16 bytes per vertex instead of 32, 8 of them in the position
+		// stream.
+		static VertexLayout Compact();
+
+		uint32_t GetPositionSize() const;
+		uint32_t GetNormalSize() const;
+		uint32_t GetUvSize() const;
+		// Interleaved layouts keep everything in the position stream and
+		// have no attribute stream.
+		uint32_t GetPositionStride() const;
+		uint32_t GetAttributeStride() const;
+
+		std::vector<VkVertexInputBindingDescription> GetBindingDescriptions() const;
+		std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions() const;
+		// Only valid with separate_positions.
+		std::vector<VkVertexInputBindingDescription> GetPositionBindingDescriptions() const;
+		std::vector<VkVertexInputAttributeDescription> GetPositionAttributeDescriptions() const;
+
+		// Writes one vertex, position into the position stream and the rest
+		// into attribute, which may point right behind position.
+		void Pack(
+			const glm::vec3& position,
+			const glm::vec3& normal,
+			const glm::vec2& uv,
+			const VertexDecode& decode,
+			uint8_t* position_data,
+			uint8_t* attribute_data
+		) const;
+
+		bool operator==(const VertexLayout& other) const;
+	private:
+		VkFormat GetPositionFormat() const;
+
+		static uint32_t EncodeOctahedral(const glm::vec3& normal);
+	};
+}
\ No newline at end of file
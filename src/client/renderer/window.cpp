@@ -40,6 +40,13 @@ namespace yib {
 	}
 
 	void Window::Run() {
+		// Nothing is rendered while minimized, so there is no reason to
+		// spin until the window is restored.
+		if (IsMinimized()) {
+			glfwWaitEvents();
+			return;
+		}
+
 		glfwPollEvents();
 	}
 
@@ -55,6 +62,10 @@ namespace yib {
 		return this->resized;
 	}
 
+	bool Window::IsMinimized() const {
+		return this->width == 0 || this->height == 0;
+	}
+
 	uint32_t Window::GetWidth() const {
 		return this->width;
 	}
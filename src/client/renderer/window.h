@@ -15,11 +15,13 @@ namespace yib {
 		);
 		~Window();
 
+		// Blocks until the next event while minimized.
 		void Run();
 		bool Running();
 
 		void ResetResized();
 		bool GetResized() const;
+		bool IsMinimized() const;
 		uint32_t GetWidth() const;
 		uint32_t GetHeight() const;
 
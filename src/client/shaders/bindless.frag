@@ -0,0 +1,13 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout (set = 1, binding = 0) uniform sampler2D textures[];
+
+layout (location = 0) in vec2 fragUV;
+layout (location = 1) flat in uint fragTextureIndex;
+
+layout (location = 0) out vec4 color;
+
+void main() {
+    color = vec4(texture(textures[nonuniformEXT(fragTextureIndex)], fragUV).rgb, 1.0);
+}
\ No newline at end of file
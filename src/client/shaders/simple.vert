@@ -1,24 +1,46 @@
 #version 450
 
-layout (push_constant) uniform PushContant {
-    mat4 model_matrix;
-} push_constant;
-
 layout (set = 0, binding = 0) uniform UBO {
     mat4 projection_view_matrix;
 } ubo;
 
+// Matches VertexDecode, quantized positions are relative to the mesh
+// bounds.
+layout (push_constant) uniform Decode {
+    vec3 position_scale;
+    uint octahedral_normals;
+    vec3 position_offset;
+} decode;
+
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 uv;
+layout (location = 3) in mat4 model_matrix;
+layout (location = 7) in uint texture_index;
 
 layout (location = 0) out vec2 fragUV;
+layout (location = 1) flat out uint fragTextureIndex;
+layout (location = 2) out vec3 fragNormal;
+
+vec3 DecodeOctahedral(vec2 encoded) {
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-normal.z, 0.0);
+
+    normal.x += normal.x >= 0.0 ? -fold : fold;
+    normal.y += normal.y >= 0.0 ? -fold : fold;
+
+    return normalize(normal);
+}
 
 void main() {
+    vec3 object_normal = decode.octahedral_normals != 0 ? DecodeOctahedral(normal.xy) : normal;
+
     fragUV =  uv;
+    fragTextureIndex = texture_index;
+    fragNormal = mat3(model_matrix) * object_normal;
 
-    gl_Position = ubo.projection_view_matrix * push_constant.model_matrix * vec4(
-        position,
+    gl_Position = ubo.projection_view_matrix * model_matrix * vec4(
+        position * decode.position_scale + decode.position_offset,
         1.0
     );
 }
\ No newline at end of file
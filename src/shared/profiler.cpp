@@ -0,0 +1,225 @@
+#include "profiler.h"
+
+#include <chrono>
+#include <string>
+#include <cstdio>
+
+#include "file.h"
+
+namespace yib {
+	std::atomic<bool> Profiler::recording = false;
+	std::atomic<uint64_t> Profiler::frame_count = 0;
+
+	std::mutex Profiler::buffers_mutex;
+	std::vector<std::unique_ptr<Profiler::ThreadBuffer>> Profiler::buffers = {};
+
+	Profiler::Scope::Scope(const char* name) : name(name), start_time(0) {
+		if (!Profiler::IsRecording()) {
+			return;
+		}
+
+		this->start_time = Profiler::GetTime();
+	}
+
+	Profiler::Scope::~Scope() {
+		// Zones that began before recording started are dropped.
+		if (this->start_time == 0 || !Profiler::IsRecording()) {
+			return;
+		}
+
+		Event event = {};
+		event.name = this->name;
+		event.start_time = this->start_time;
+		event.duration = Profiler::GetTime() - this->start_time;
+		event.phase = 'X';
+
+		Profiler::Record(event);
+	}
+
+
+	Profiler::ThreadBuffer::~ThreadBuffer() {
+		Chunk* chunk = this->head;
+
+		while (chunk != nullptr) {
+			Chunk* next = chunk->next.load(std::memory_order_relaxed);
+			delete chunk;
+			chunk = next;
+		}
+	}
+
+
+	void Profiler::Start() {
+		recording.store(true, std::memory_order_relaxed);
+	}
+
+	void Profiler::Stop() {
+		recording.store(false, std::memory_order_relaxed);
+	}
+
+	bool Profiler::IsRecording() {
+		return recording.load(std::memory_order_relaxed);
+	}
+
+	void Profiler::MarkFrame() {
+		if (!IsRecording()) {
+			return;
+		}
+
+		Event event = {};
+		event.name = "frame";
+		event.start_time = GetTime();
+		event.value = frame_count.fetch_add(1, std::memory_order_relaxed);
+		event.phase = 'i';
+
+		Record(event);
+	}
+
+	void Profiler::Counter(
+		const char* name,
+		uint64_t value
+	) {
+		if (!IsRecording()) {
+			return;
+		}
+
+		Event event = {};
+		event.name = name;
+		event.start_time = GetTime();
+		event.value = value;
+		event.phase = 'C';
+
+		Record(event);
+	}
+
+	bool Profiler::WriteTrace(const char* path) {
+		std::unique_lock<std::mutex> lock(buffers_mutex);
+
+		std::string trace = "{\"traceEvents\":[\n";
+		bool first = true;
+
+		char line[512];
+
+		for (const std::unique_ptr<ThreadBuffer>& buffer : buffers) {
+			int length = snprintf(
+				line,
+				sizeof(line),
+				"%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}",
+				first ? "" : ",\n",
+				buffer->thread_id,
+				buffer->thread_id
+			);
+			trace.append(line, length);
+			first = false;
+
+			for (
+				Chunk* chunk = buffer->head;
+				chunk != nullptr;
+				chunk = chunk->next.load(std::memory_order_acquire)
+			) {
+				uint32_t count = chunk->count.load(std::memory_order_acquire);
+
+				for (uint32_t i = 0; i < count; i++) {
+					const Event& event = chunk->events.at(i);
+
+					// Chrome traces count in microseconds. Names come from
+					// string literals and function names, which need no
+					// escaping.
+					if (event.phase == 'i') {
+						length = snprintf(
+							line,
+							sizeof(line),
+							",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"args\":{\"frame\":%llu}}",
+							event.name,
+							buffer->thread_id,
+							event.start_time / 1000.0,
+							static_cast<unsigned long long>(event.value)
+						);
+					} else if (event.phase == 'C') {
+						length = snprintf(
+							line,
+							sizeof(line),
+							",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"args\":{\"value\":%llu}}",
+							event.name,
+							buffer->thread_id,
+							event.start_time / 1000.0,
+							static_cast<unsigned long long>(event.value)
+						);
+					} else {
+						length = snprintf(
+							line,
+							sizeof(line),
+							",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+							event.name,
+							buffer->thread_id,
+							event.start_time / 1000.0,
+							event.duration / 1000.0
+						);
+					}
+
+					if (length < 0 || length >= static_cast<int>(sizeof(line))) {
+						continue;
+					}
+
+					trace.append(line, length);
+				}
+			}
+		}
+
+		trace.append("\n]}\n");
+
+		return File::Write(
+			path,
+			std::vector<char>(trace.begin(), trace.end())
+		);
+	}
+
+
+	uint64_t Profiler::GetTime() {
+		static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+		// Offset by one so a recorded zone never starts at zero.
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - epoch
+		).count() + 1;
+	}
+
+	Profiler::ThreadBuffer& Profiler::GetThreadBuffer() {
+		thread_local ThreadBuffer* thread_buffer = nullptr;
+
+		if (thread_buffer == nullptr) {
+			std::unique_ptr<ThreadBuffer> buffer = std::make_unique<ThreadBuffer>();
+
+			buffer->head = new Chunk();
+			buffer->tail = buffer->head;
+
+			std::unique_lock<std::mutex> lock(buffers_mutex);
+
+			buffer->thread_id = buffers.size();
+			thread_buffer = buffer.get();
+
+			buffers.push_back(std::move(buffer));
+		}
+
+		return *thread_buffer;
+	}
+
+	void Profiler::Record(const Event& event) {
+		ThreadBuffer& buffer = GetThreadBuffer();
+
+		Chunk* chunk = buffer.tail;
+		uint32_t count = chunk->count.load(std::memory_order_relaxed);
+
+		if (count == CHUNK_SIZE) {
+			Chunk* next = new Chunk();
+
+			chunk->next.store(next, std::memory_order_release);
+			buffer.tail = next;
+
+			chunk = next;
+			count = 0;
+		}
+
+		chunk->events.at(count) = event;
+		chunk->count.store(count + 1, std::memory_order_release);
+	}
+}
\ No newline at end of file
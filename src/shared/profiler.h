@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+// Zones and frame markers only exist when YIB_ENABLE_PROFILER is defined,
+// otherwise the macros expand to nothing and cost nothing.
+#ifdef YIB_ENABLE_PROFILER
+#define YIB_PROFILE_CONCAT_INNER(a, b) a##b
+#define YIB_PROFILE_CONCAT(a, b) YIB_PROFILE_CONCAT_INNER(a, b)
+#define YIB_PROFILE_ZONE(name) ::yib::Profiler::Scope YIB_PROFILE_CONCAT(profile_zone_, __COUNTER__)(name)
+#define YIB_PROFILE_FUNCTION() YIB_PROFILE_ZONE(__func__)
+#define YIB_PROFILE_FRAME() ::yib::Profiler::MarkFrame()
+#define YIB_PROFILE_COUNTER(name, value) ::yib::Profiler::Counter(name, value)
+#else
+#define YIB_PROFILE_ZONE(name)
+#define YIB_PROFILE_FUNCTION()
+#define YIB_PROFILE_FRAME()
+#define YIB_PROFILE_COUNTER(name, value)
+#endif
+
+namespace yib {
+	// Records cpu zones into per thread buffers and exports them as a Chrome
+	// trace. Only the owning thread appends to a buffer, so recording takes
+	// no locks; a lock is only taken once per thread to register its buffer.
+	class Profiler {
+	public:
+		class Scope {
+		public:
+			// The name has to outlive the profiler, a string literal.
+			Scope(const char* name);
+			~Scope();
+
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+		private:
+			const char* name;
+			uint64_t start_time;
+		};
+
+		static constexpr bool IsCompiledIn() {
+#ifdef YIB_ENABLE_PROFILER
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		static void Start();
+		static void Stop();
+		static bool IsRecording();
+
+		static void MarkFrame();
+		// The name has to outlive the profiler, a string literal.
+		static void Counter(
+			const char* name,
+			uint64_t value
+		);
+
+		// Has to be called after Stop, once no thread is recording anymore.
+		static bool WriteTrace(const char* path);
+	private:
+		struct Event {
+			const char* name = nullptr;
+			// Nanoseconds since the profiler's epoch.
+			uint64_t start_time = 0;
+			uint64_t duration = 0;
+			// Frame number of a marker or the value of a counter.
+			uint64_t value = 0;
+			// 'X' for zones, 'i' for frame markers and 'C' for counters.
+			char phase = 'X';
+		};
+
+		static constexpr uint32_t CHUNK_SIZE = 4096;
+
+		// Chunks are only ever appended, a reader sees every event below
+		// the count it loaded.
+		struct Chunk {
+			std::array<Event, CHUNK_SIZE> events = {};
+			std::atomic<uint32_t> count = 0;
+			std::atomic<Chunk*> next = nullptr;
+		};
+
+		struct ThreadBuffer {
+			uint32_t thread_id = 0;
+			Chunk* head = nullptr;
+			Chunk* tail = nullptr;
+
+			~ThreadBuffer();
+		};
+
+		static uint64_t GetTime();
+		static ThreadBuffer& GetThreadBuffer();
+		static void Record(const Event& event);
+
+		static std::atomic<bool> recording;
+		static std::atomic<uint64_t> frame_count;
+
+		static std::mutex buffers_mutex;
+		static std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace yib {
+	ThreadPool::ThreadPool(uint32_t thread_count) {
+		if (thread_count == 0) {
+			thread_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+		}
+
+		for (uint32_t i = 0; i < thread_count; i++) {
+			this->threads.emplace_back(&ThreadPool::Work, this);
+		}
+	}
+
+	ThreadPool::~ThreadPool() {
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->stopping = true;
+		}
+
+		this->task_condition.notify_all();
+
+		for (std::thread& thread : this->threads) {
+			thread.join();
+		}
+	}
+
+
+	void ThreadPool::Submit(std::function<void()> task) {
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->tasks.push(std::move(task));
+		}
+
+		this->task_condition.notify_one();
+	}
+
+	void ThreadPool::Wait() {
+		std::unique_lock<std::mutex> lock(this->mutex);
+
+		this->idle_condition.wait(lock, [this] {
+			return this->tasks.empty() && this->active == 0;
+		});
+	}
+
+	uint32_t ThreadPool::GetThreadCount() const {
+		return this->threads.size();
+	}
+
+
+	void ThreadPool::Work() {
+		while (true) {
+			std::function<void()> task;
+
+			{
+				std::unique_lock<std::mutex> lock(this->mutex);
+
+				this->task_condition.wait(lock, [this] {
+					return this->stopping || !this->tasks.empty();
+				});
+
+				// Queued tasks are still drained on shutdown so nothing that
+				// was submitted is silently dropped.
+				if (this->tasks.empty()) {
+					return;
+				}
+
+				task = std::move(this->tasks.front());
+				this->tasks.pop();
+				this->active++;
+			}
+
+			task();
+
+			{
+				std::unique_lock<std::mutex> lock(this->mutex);
+				this->active--;
+			}
+
+			this->idle_condition.notify_all();
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <queue>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <condition_variable>
+
+namespace yib {
+	class ThreadPool {
+	public:
+		ThreadPool(uint32_t thread_count = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		void Submit(std::function<void()> task);
+		void Wait();
+
+		uint32_t GetThreadCount() const;
+	private:
+		void Work();
+
+		std::vector<std::thread> threads = {};
+		std::queue<std::function<void()>> tasks = {};
+
+		std::mutex mutex;
+		std::condition_variable task_condition;
+		std::condition_variable idle_condition;
+
+		uint32_t active = 0;
+		bool stopping = false;
+	};
+}
\ No newline at end of file